@@ -28,76 +28,1076 @@
 
 #include "raymath.h"
 
+#include "rlgl.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#if defined(_WIN32)
+    #define GetCpuCount() atoi(getenv("NUMBER_OF_PROCESSORS") ? getenv("NUMBER_OF_PROCESSORS") : "1")
+#else
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #define GetCpuCount() (int)sysconf(_SC_NPROCESSORS_ONLN)
+    #define CACHE_MMAP      //cache blobs are mapped read only instead of copied into the heap
+#endif
+
+//batch collision kernels test 8 (AVX) or 4 (SSE2) pairs at once when the compiler targets them, scalar otherwise
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define COLLISION_SSE2
+#endif
+#if defined(__AVX__)
+    #include <immintrin.h>
+    #define COLLISION_AVX
+#endif
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+//gameplay tuning, shared by the windowed game and the headless simulation
+enum {
+    MaxPlayerTankBullets = 20,
+    MaxPlayerMGBullets = 70,
+    MaxEnemyTankBullets = 30,
+    MaxEnemyMGBullets = 70,
+    PlayerTankDelay = 1,
+    MaxNumberOfSpecialBullets = 30,
+    MaxNumberOfBattleShipTankBullets = 30,
+    MaxPlayerMainGunAmmo = 50,
+    MaxPlayerMGAmmo = 300,
+    HealthBoost = 75,
+    MainGunAmmoBoost = 30,
+    MGAmmoBoost = 60,
+    MaxBattleshipHealth = 500,
+    SpecialBulletDamage = 50,
+    EnemyTankDamage = 10,
+    PlayerDamage = 45,
+    PlayerMGDamage = 15,
+    PlayerHealth = 150,
+    MaxSoundEventsPerStep = 64,
+    MaxAssetRequests = 64,
+    MaxLoaderWorkers = 16,
+    MaxResources = 64,
+    MaxVoices = 32,
+    MaxActiveVoices = 12,
+    MaxJobWorkers = 16,
+    MaxJobTasks = 16,
+    MaxJobDependents = 4,
+    MaxJobChunks = 64,                      //most pieces one task's items are split into
+    MaxQueuedJobs = MaxJobTasks*MaxJobChunks,
+    MaxModelLods = 4,                       //detail levels per model, level 0 is the source mesh
+    FlowDirectionCount = 8,                 //moves out of a nav cell, a flow field stores this count where there is no way on
+    MaxBvhLeafTriangles = 4,                //a BVH node with more triangles than this is split
+    BvhSplitBins = 12,                      //candidate split planes per axis when building a BVH
+    MaxBvhDepth = 48,                       //deepest BVH node, also bounds the traversal stacks
+    MaxStaticChunkVertices = 65535,         //most vertices a baked chunk holds with 16 bit indices
+    MaxObjMaterials = 16,                   //materials read from an .obj file's .mtl, more are drawn with the first one
+    MaxRewindSnapshots = 10,                //seconds of play the rewind ring keeps, one snapshot per simulated second
+    MaxBatchCandidates = 32                 //grid query items gathered before they go through a batch collision test
+};
+
+#define SIM_TICK_RATE 60                    //default simulation steps per second, --tick-rate changes it
+
+#define PROFILER_HISTORY 240                //frames kept for the overlay's rolling statistics
+
+#define LEVEL_MAGIC "TLTL"
+#define LEVEL_VERSION 1
+#define DEFAULT_LEVEL_FILE "The Last Tank/Level1.lvl"
+
+#define ASSET_CACHE_DIR "The Last Tank/cache"   //converted meshes and textures, rebuilt when the source file changes
+#define ASSET_CACHE_VERSION 2
+#define MESH_CACHE_MAGIC "TLTM"
+#define TEXTURE_CACHE_MAGIC "TLTX"
+#define BVH_CACHE_MAGIC "TLTB"
+
+#define REPLAY_MAGIC "TLTR"
+#define REPLAY_VERSION 1
+#define REPLAY_HEADER_SIZE 16               //magic, version, tick count, run count
+#define REPLAY_RUN_SIZE 6                   //buttons, run length, dt bits
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+//uniform grid over the XZ plane holding all static collision boxes (walls and buildings)
+typedef struct StaticGrid {
+    BoundingBox *boxes;     //copy of every static box, indexed by cellItems
+    int boxCount;
+    float originX;          //world x/z of the grid's min corner
+    float originZ;
+    float cellSize;
+    int cellsX;
+    int cellsZ;
+    int *cellStart;         //cellsX*cellsZ + 1 offsets into cellItems
+    int *cellItems;         //box indices bucketed by cell
+    float *itemMinX;        //bounds of every cellItems entry, packed so a cell's boxes are tested in one batch
+    float *itemMinY;
+    float *itemMinZ;
+    float *itemMaxX;
+    float *itemMaxY;
+    float *itemMaxZ;
+} StaticGrid;
+
+//node of a bounding volume hierarchy over triangles, the two children of an inner node sit next to each other
+typedef struct BvhNode {
+    BoundingBox bounds;
+    int first;              //left child of an inner node, first triangle of a leaf
+    int triangleCount;      //0 for an inner node
+} BvhNode;
+
+//triangles of a mesh sorted into a BVH in the mesh's model space, node 0 is the root
+typedef struct TriangleBvh {
+    BvhNode *nodes;
+    int nodeCount;
+    Vector3 *vertices;      //three corners per triangle, ordered so each leaf's triangles are contiguous
+    int triangleCount;
+} TriangleBvh;
+
+//every kind of projectile in the game, each with its own slot budget
+typedef enum Proj_Type{
+    PLAYER_TANK_BULLET,
+    PLAYER_MG_BULLET,
+    ENEMY_TANK_BULLET,
+    ENEMY_MG_BULLET,
+    BATTLESHIP_TANK_BULLET,
+    BATTLESHIP_SPECIAL_BULLET,
+    PROJECTILE_TYPE_COUNT
+} ProjectileType;
+
+typedef enum F_Type{
+    PLAYER_FACTION,
+    ENEMY_FACTION
+} Faction;
+
+//what a bullet's path ran into first during a tick
+typedef enum H_Type{
+    PROJECTILE_HIT_NONE,
+    PROJECTILE_HIT_STATIC,
+    PROJECTILE_HIT_PLAYER,
+    PROJECTILE_HIT_BATTLESHIP,
+    PROJECTILE_HIT_ENEMY_TANK,
+    PROJECTILE_HIT_ENEMY_APC
+} ProjectileHitKind;
+
+//all projectiles stored as structure-of-arrays, with a dense list of live slots
+typedef struct Projectiles {
+    int capacity;
+    int typeFirst[PROJECTILE_TYPE_COUNT];   //slots [typeFirst, typeFirst + typeCapacity) belong to a type
+    int typeCapacity[PROJECTILE_TYPE_COUNT];
+    float typeSpeed[PROJECTILE_TYPE_COUNT];
+    float typeRange[PROJECTILE_TYPE_COUNT];
+    
+    //per slot data
+    float *posX;
+    float *posY;
+    float *posZ;
+    float *prevX;           //position at the start of the tick, the bullet's path is swept from here to pos
+    float *prevZ;
+    float *velX;            //distance moved per second along x
+    float *velZ;            //distance moved per second along z
+    float *yaw;
+    float *maxRange;
+    int *damage;
+    int *owner;             //index of the firing enemy, -1 for player and battleship
+    unsigned char *type;
+    unsigned char *faction;
+    bool *IsFired;
+    
+    //live and free slots
+    int *live;              //dense list of fired slots
+    float *liveX;           //sphere around each live slot's path this tick, packed in live list order for the batch tests
+    float *liveY;
+    float *liveZ;
+    float *liveRadius;
+    unsigned char *liveHits;    //scratch hit mask of the last batch test, one per live list entry
+    float *liveHitTime;     //earliest impact found along each live slot's path, as a fraction of the tick
+    unsigned char *liveHitKind;
+    int *liveHitIndex;      //enemy hit, for the enemy kinds
+    int *livePos;           //slot -> index into live while fired, next free slot of the same type while free
+    int liveCount;
+    int freeHead[PROJECTILE_TYPE_COUNT];    //first free slot of each type, -1 when the pool is exhausted
+} Projectiles;
+
+//everything that moves and gets hit tested, each kind has its own range of grid entries
+typedef enum D_Kind{
+    DYNAMIC_ENEMY_TANK,
+    DYNAMIC_ENEMY_APC,
+    DYNAMIC_PICKUP,
+    DYNAMIC_PROJECTILE,
+    DYNAMIC_KIND_COUNT
+} DynamicKind;
+
+//spatial hash over the XZ plane for moving items, an item is linked into the bucket of the cell its center is in
+//and only relinked when it changes cells, items are updated where they spawn, move or die instead of being rebuilt every step
+typedef struct DynamicGrid {
+    float cellSize;
+    float inverseCellSize;
+    int bucketMask;         //bucket count - 1, the count is a power of two
+    int *bucketHead;        //first entry of each bucket, -1 when empty
+    int kindFirst[DYNAMIC_KIND_COUNT];      //entries [kindFirst, kindFirst + kindCapacity) belong to a kind, one per item index
+    int kindCapacity[DYNAMIC_KIND_COUNT];
+    float kindRadius[DYNAMIC_KIND_COUNT];   //largest radius inserted for each kind, queries are grown by it
+    int entryCount;
+    int *entryNext;         //neighbours in the bucket's list, -1 at the ends
+    int *entryPrev;
+    int *entryCellX;
+    int *entryCellZ;
+    int *entryBucket;       //-1 while the item is not in the grid
+} DynamicGrid;
+
+//cells a neighbourhood query still has to visit, walked with NextDynamicGridItem
+typedef struct DynamicGridQuery {
+    const DynamicGrid *grid;
+    DynamicKind kind;
+    int x0, x1, z0, z1;
+    int x, z;               //cell being walked
+    int entry;              //next entry of its bucket
+} DynamicGridQuery;
+
+//where enemies can drive, the static boxes and the battleship grown by an enemy's radius and rasterized on the XZ plane
+typedef struct NavGrid {
+    float originX;          //world x/z of the grid's min corner
+    float originZ;
+    float cellSize;
+    int cellsX;
+    int cellsZ;
+    bool *IsBlocked;        //cellsX*cellsZ, blocked when the cell's center is inside a grown box
+} NavGrid;
+
+//the way to the player from every nav cell, shared by all enemies and only rebuilt when the player enters another cell
+typedef struct FlowField {
+    int targetCell;         //nav cell the field leads to, -1 when the target is off the grid
+    int *cost;              //path cost to the target, 2 per straight and 3 per diagonal step, -1 where it can't be reached
+    unsigned char *direction;   //index into flowSteps, FlowDirectionCount where there is no way on
+} FlowField;
+
+//sphere enclosing a model in its own space, precomputed once for culling
+typedef struct BoundingSphere {
+    Vector3 center;
+    float radius;
+} BoundingSphere;
+
+//six planes (xyz = inward normal, w = distance) of the camera's view volume, plus this frame's cull statistics
+typedef struct Frustum {
+    Vector4 planes[6];
+    int tested;
+    int visible;
+} Frustum;
+
+//per frame list of transforms for every instance of one model, drawn with one DrawMeshInstanced per mesh
+typedef struct InstanceBatch {
+    Model model;            //shared meshes, not owned by the batch
+    BoundingSphere bounds;  //model space bounds of all meshes
+    Material *materials;    //copies of the model's materials using the instancing shader
+    Matrix *transforms;
+    int count;
+    int capacity;
+    bool IsInstanced;       //false when the instancing shader failed to load, falls back to one DrawMesh per instance
+} InstanceBatch;
+
+//part of a static batch, the meshes of one material from every instance in one chunk of the level merged together
+typedef struct StaticChunk {
+    Mesh mesh;              //owned, vertices already in world space
+    int material;           //index into the batch model's materials
+    BoundingBox bounds;     //world space, for culling
+} StaticChunk;
+
+//instances of a model that never move, baked once at load time so each chunk is a single draw call
+//meshes too big for a chunk's 16 bit indices are left out of the chunks and drawn instanced at every position instead
+typedef struct StaticBatch {
+    Model model;            //only its materials are used, not owned
+    StaticChunk *chunks;
+    int chunkCount;
+    Model oversized;        //the model's meshes over MaxStaticChunkVertices sharing their buffers, meshCount is 0 when there are none
+    InstanceBatch oversizedBatch;
+    Vector3 *positions;     //every instance, only kept for the oversized meshes
+    int positionCount;
+} StaticBatch;
+
+//where a static instance lands when baking, instances are sorted by chunk
+typedef struct StaticInstance {
+    int chunkX;
+    int chunkZ;
+    int index;
+} StaticInstance;
+typedef enum E_Type{
+    TANK,
+    APC
+} EnemyType;
+
+typedef enum P_Type{
+    HEALTH,
+    MAINGUN,
+    MG
+} PickupType;
+
+//enemy data
+typedef struct enemyTank {
+    EnemyType enemyType;
+    float enemyModelYaw;        //angle the model is drawn turned by
+    float enemyPrevModelYaw;    //same before the last step, drawing blends between the two
+    Vector3 enemyPos;
+    Vector3 enemyPrevPos;       //same before the last step, drawing blends between the two
+    Vector3 enemyDir;
+    float enemyYaw;
+    float enemyRange;
+    float enemyMoveSpeed;       //world units per second while closing in on the player
+    float enemyToPlayerAngle;
+    float enemyTankFireRate;
+    float enemyTimeTillLastShot;
+    int enemyHealth;
+    int enemyDamage;
+    bool IsEnemyAlive;
+    bool CanTankFire;
+    bool WantsToFire;       //set by the AI job, the shot is spawned after all enemies are updated
+    bool IsPlayerInSight;   //no wall, building or battleship between the enemy and the player
+    int sightEnemyCell;     //nav cells of the enemy and the player when IsPlayerInSight was worked out, -2 before the first time
+    int sightPlayerCell;
+}EnemyTank;
+
+//pickups
+typedef struct pickup{
+    PickupType pickupType;
+    Vector3 pickupPos;
+    float pickupYaw;
+    float pickupPrevYaw;        //yaw before the last step
+    bool IsPickedUp;
+    float pickupRotSpeed;       //degrees per second
+} Pickup;
+
+//data structure for holding type and position of pickups
+typedef struct p_Data{
+    PickupType type;
+    Vector3 pos;
+}PickupData;
+
+//placement lists of a level file, each stored as one contiguous array
+typedef enum L_Section{
+    LEVEL_VERTICAL_WALLS,
+    LEVEL_HORIZONTAL_WALLS,
+    LEVEL_BUILDINGS,
+    LEVEL_ENEMY_TANKS,
+    LEVEL_ENEMY_APCS,
+    LEVEL_PICKUPS,
+    LEVEL_BATTLESHIP_GUNS,
+    LEVEL_BATTLESHIP_SPECIAL_GUNS,
+    LEVEL_SECTION_COUNT
+} LevelSection;
+
+//start of a compiled level, every section is a raw array at a byte offset from the start of the file
+typedef struct LevelFileHeader {
+    char magic[4];
+    unsigned int version;
+    unsigned int vectorSize;        //sizeof(Vector3) and sizeof(PickupData) the file was written with
+    unsigned int pickupSize;
+    Vector3 playerStart;
+    Vector3 levelModelPos;
+    Vector3 battleshipPos;
+    unsigned int sectionOffset[LEVEL_SECTION_COUNT];
+    unsigned int sectionCount[LEVEL_SECTION_COUNT];
+} LevelFileHeader;
+
+//start of a cached model, followed by the material colors, the mesh to material table and every mesh
+typedef struct MeshCacheHeader {
+    char magic[4];
+    unsigned int version;
+    unsigned long long sourceHash;  //FNV-1a of the .obj the cache was built from
+    int meshCount;
+    int materialCount;
+} MeshCacheHeader;
+
+//start of a cached BVH, followed by nodeCount nodes and three corners for every triangle
+typedef struct BvhCacheHeader {
+    char magic[4];
+    unsigned int version;
+    unsigned long long sourceHash;  //FNV-1a of the .obj the tree was built from
+    int nodeCount;
+    int triangleCount;
+} BvhCacheHeader;
+
+//followed by vertices, texcoords and normals for vertexCount vertices, then indexCount 16 bit indices padded to 4 bytes
+typedef struct MeshCacheEntry {
+    int vertexCount;
+    int triangleCount;
+    int indexCount;
+} MeshCacheEntry;
+
+//a model and simplified copies of it, drawn at the level that suits how big an instance is on screen
+typedef struct ModelLod {
+    Model levels[MaxModelLods];     //level 0 is the source model, the rest are owned
+    int levelCount;
+} ModelLod;
+
+//one simplified level, read from its cache or simplified from the source on a job worker, uploaded on the main thread
+typedef struct LodRequest {
+    Model source;
+    const char *fileName;           //source .obj, names the cache
+    unsigned long long sourceHash;  //of the source .obj
+    int level;
+    Model model;                    //CPU side result
+    bool IsBuilt;
+} LodRequest;
+
+//a vertex while simplifying, welded by position only so texture seams don't stop edges collapsing
+typedef struct SimplifyVertex {
+    Vector3 pos;
+    double quadric[10];             //symmetric 4x4 plane error matrix, upper triangle
+    int refStart;                   //this vertex's triangles in the refs array
+    int refCount;
+    bool IsBorder;
+} SimplifyVertex;
+
+//a triangle while simplifying, corners keep the texcoords and normals they were loaded with
+typedef struct SimplifyTriangle {
+    int v[3];
+    float texcoords[3][2];
+    float normals[3][3];
+    double error[4];                //cost of collapsing each edge, [3] is the cheapest
+    Vector3 normal;
+    bool IsDeleted;
+    bool IsDirty;                   //touched by a collapse this pass, waits for the next one
+} SimplifyTriangle;
+
+//a triangle using a vertex, and which of its corners the vertex is
+typedef struct SimplifyRef {
+    int triangle;
+    int corner;
+} SimplifyRef;
+
+//quadric edge collapse state for one mesh
+typedef struct Simplifier {
+    SimplifyVertex *vertices;
+    int vertexCount;
+    SimplifyTriangle *triangles;
+    int triangleCount;
+    SimplifyRef *refs;
+    int refCount;
+    int refCapacity;
+} Simplifier;
+
+//followed by dataSize bytes of pixels, all mipmap levels in the texture's final GPU format
+typedef struct TextureCacheHeader {
+    char magic[4];
+    unsigned int version;
+    unsigned long long sourceHash;  //FNV-1a of the image file the cache was built from
+    int width;
+    int height;
+    int mipmaps;
+    int format;
+    int dataSize;
+} TextureCacheHeader;
+
+typedef enum A_Type{
+    ASSET_MODEL,
+    ASSET_TEXTURE,
+    ASSET_SOUND,
+    ASSET_STREAM
+} AssetType;
+
+typedef int ResourceHandle;         //index into a ResourceManager, -1 if nothing was loaded
+
+//one loaded file, shared by everything that asks for the same path and options or turns out to hold the same bytes
+typedef struct Resource {
+    AssetType type;
+    char fileName[256];
+    bool useMipmaps;                //textures are keyed by their options as well as their path
+    bool allowCompression;
+    unsigned long long contentHash; //of the source file, 0 until loaded
+    int refCount;
+    int owner;                      //resource holding the GPU object, itself unless the contents matched another one
+    int byteSize;                   //GPU or audio memory owned, 0 when shared
+    Model model;                    //models that share meshes still get their own materials
+    Texture2D texture;
+    Sound sound;
+    Music stream;                   //only a small decode buffer is resident, the samples stay on disk
+} Resource;
+
+//everything loaded from disk, released per handle or all at once at shutdown
+typedef struct ResourceManager {
+    Resource resources[MaxResources];
+    int resourceCount;
+} ResourceManager;
+
+//one file for the asset loader, decoded on a worker then uploaded into its resource on the main thread
+typedef struct AssetRequest {
+    AssetType type;
+    const char *fileName;
+    ResourceHandle handle;
+    bool useMipmaps;                //textures only
+    bool allowCompression;
+    
+    //decode results, written by the worker before it publishes the request
+    unsigned long long sourceHash;
+    Model model;
+    bool IsModelDecoded;
+    unsigned char *textureData;
+    int textureDataSize;
+    bool IsTextureConverted;
+    Wave wave;
+} AssetRequest;
+
+//where a queued asset is copied once loading is done, several targets can point at one resource
+typedef struct AssetTarget {
+    ResourceHandle handle;
+    void *target;                   //Model, Texture2D, Sound or Music
+} AssetTarget;
+
+//decodes files on a worker pool while the main thread draws the loading screen and does the GPU and audio uploads
+typedef struct AssetLoader {
+    ResourceManager *resources;
+    AssetTarget targets[MaxAssetRequests];
+    int targetCount;
+    AssetRequest requests[MaxAssetRequests];
+    int requestCount;
+    pthread_t workers[MaxLoaderWorkers];
+    int workerCount;
+    pthread_mutex_t lock;
+    int nextDecode;                         //next request a worker takes
+    int decodedOrder[MaxAssetRequests];     //decoded requests in the order they finished
+    int decodedCount;
+    int uploadedCount;                      //front of decodedOrder the main thread has uploaded
+} AssetLoader;
+
+//one map, all arrays point into data which holds the compiled file
+typedef struct Level {
+    unsigned char *data;
+    int dataSize;
+    Vector3 playerStart;
+    Vector3 levelModelPos;
+    Vector3 battleshipPos;
+    const Vector3 *verticalWalls;
+    const Vector3 *horizontalWalls;
+    const Vector3 *buildings;
+    const Vector3 *enemyTanks;
+    const Vector3 *enemyAPCs;
+    const PickupData *pickups;
+    const Vector3 *battleshipGuns;            //relative to battleshipPos
+    const Vector3 *battleshipSpecialGuns;
+    int verticalWallCount;
+    int horizontalWallCount;
+    int buildingCount;
+    int enemyTankCount;
+    int enemyAPCCount;
+    int pickupCount;
+    int battleshipGunCount;
+    int battleshipSpecialGunCount;
+} Level;
+
+//every sound the simulation can ask for, played by the windowed game and ignored when headless
+typedef enum S_Type{
+    PLAYER_TANK_GUN_SOUND,
+    PLAYER_MG_SOUND,
+    ENEMY_DIE_SOUND,
+    ENEMY_HIT_SOUND,
+    ENEMY_TANK_GUN_SOUND,
+    HEALTH_PICKUP_SOUND,
+    SOUND_TYPE_COUNT
+} SoundType;
+
+typedef struct SoundEvent {
+    SoundType sound;
+    Vector3 pos;
+} SoundEvent;
+
+//how one sound type is mixed, indexed by SoundType
+typedef struct SoundSettings {
+    int maxVoices;          //copies that can overlap, the oldest one restarts past this
+    int priority;           //higher keeps its voice when more sounds want to play than MaxActiveVoices
+    float audibleRange;     //distance from the player where the sound has faded out completely
+    bool IsStreamed;        //long or rare sounds play from disk through one music stream instead of staying decoded in memory
+} SoundSettings;
+
+//fixed pool of sound aliases, each sound type owns maxVoices of them so triggering a sound never allocates
+//streamed types get a single voice that plays their music stream
+typedef struct VoiceManager {
+    Sound voices[MaxVoices];
+    Music streams[SOUND_TYPE_COUNT];
+    SoundType voiceType[MaxVoices];
+    double voiceStartTime[MaxVoices];
+    float voiceGain[MaxVoices];
+    int voiceCount;
+    int firstVoice[SOUND_TYPE_COUNT];
+    int playedCount;        //since startup, for tuning the settings
+    int droppedCount;
+} VoiceManager;
+
+//buttons held during one simulation step, fire tank and restart are only set on the step they are pressed
+typedef enum {
+    INPUT_TURN_RIGHT = 1 << 0,
+    INPUT_TURN_LEFT = 1 << 1,
+    INPUT_FORWARD = 1 << 2,
+    INPUT_BACKWARD = 1 << 3,
+    INPUT_FIRE_TANK = 1 << 4,
+    INPUT_FIRE_MG = 1 << 5,
+    INPUT_RESTART = 1 << 6
+} InputBits;
+
+typedef struct InputFrame {
+    unsigned int buttons;
+} InputFrame;
+
+//static level data the simulation collides against, built once and shared by every match
+typedef struct World {
+    const Level *level;
+    StaticGrid staticGrid;
+    NavGrid navGrid;
+    long long *flowFieldHeap;           //UpdateFlowField's open cells, scratch kept out of GameState so snapshots don't copy it
+    BoundingBox battleshipBox;          //bounds of the hull, the cheap test before its triangles
+    const TriangleBvh *battleshipBvh;   //the hull's triangles, shared by every level
+    Matrix battleshipToModel;           //world space into the BVH's model space
+    Vector3 battleship_Pos;
+} World;
+
+//bump allocator over the block a GameState lives in
+typedef struct GameMemory {
+    unsigned char *base;    //NULL while only adding up how big the block has to be
+    int size;
+    int used;
+} GameMemory;
+
+//everything SimStep reads and writes, no window, audio or GPU resources
+//it sits at the front of one block holding every array it points into, so the block is a complete, copyable snapshot
+typedef struct GameState {
+    const World *world;
+    int memorySize;                 //bytes in the block, from this struct to the end of its last array
+    const unsigned char *matchStart;    //snapshot of the block at the start of the match, restarting restores it
+    
+    //player attributes
+    Vector3 playerPos;
+    float playerYaw;
+    Vector3 prevPlayerPos;          //player placement before the last step, drawing blends between the two
+    float prevPlayerYaw;
+    int CurrentPlayerHealth;
+    int CurrentMainGunAmmo;
+    int CurrentMGAmmo;
+    float playerTankGunTime;
+    float playerMGTime;
+    bool CanPlayerFireTank;
+    bool CanPlayerFireMG;
+    
+    //sized by the level
+    EnemyTank *enemyTanks;
+    EnemyTank *enemyAPCs;
+    Pickup *AllPickups;
+    int enemyTankCount;
+    int enemyAPCCount;
+    int pickupCount;
+    
+    //enemy boss
+    int CurrentBattleshipHealth;
+    bool CanBattleshipFire;
+    float battleshipFireTime;
+    
+    Projectiles projectiles;
+    DynamicGrid dynamicGrid;        //living enemies, pickups left and live bullets by position
+    FlowField flowField;            //the way to the player for every enemy
+    
+    //gameScreen related stuff
+    bool ToRestartGame;
+    bool IsPlayerDead;
+    bool IsGameFinished;
+    
+    SoundEvent soundEvents[MaxSoundEventsPerStep];  //sounds raised by the last SimStep, in order
+    int soundEventCount;
+    unsigned int tick;
+} GameState;
+
+//the last seconds of play as GameState snapshots, the oldest is overwritten once it is full
+typedef struct SnapshotRing {
+    unsigned char *snapshots;   //capacity snapshots of snapshotSize bytes
+    int snapshotSize;
+    int capacity;
+    int count;
+    int newest;                 //slot of the latest snapshot, -1 before the first
+} SnapshotRing;
+
+//what every SimStep job works on
+typedef struct SimJobData {
+    GameState *state;
+    float dt;
+} SimJobData;
+
+//one line of an input script, buttons are held for ticks steps with edge buttons only on the first one
+typedef struct ScriptLine {
+    int ticks;
+    unsigned int buttons;
+} ScriptLine;
+
+//timed sections of a frame, a phase may be entered several times per frame and its times add up
+typedef enum Profile_Phase{
+    PROFILE_INPUT,
+    PROFILE_ENEMY_AI,
+    PROFILE_BATTLESHIP,
+    PROFILE_BULLET_MOVE,
+    PROFILE_BULLET_VS_ENEMY,
+    PROFILE_BULLET_VS_PLAYER,
+    PROFILE_BULLET_VS_STATIC,
+    PROFILE_PICKUPS,
+    PROFILE_RULES,
+    PROFILE_UPDATE,
+    PROFILE_DRAW,
+    PROFILE_LOAD,           //startup work run on the job system, kept apart from the per frame phases
+    PROFILE_FRAME,
+    PROFILE_PHASE_COUNT
+} ProfilePhase;
+
+//per phase milliseconds of the current frame and the last PROFILER_HISTORY frames
+typedef struct Profiler {
+    double phaseStart[PROFILE_PHASE_COUNT];
+    float current[PROFILE_PHASE_COUNT];
+    float history[PROFILE_PHASE_COUNT][PROFILER_HISTORY];
+    int historyNext;
+    int historyCount;
+    int frame;
+    FILE *csv;              //one row per frame when a CSV dump was asked for
+    bool IsEnabled;
+} Profiler;
+
+//runs items [first, last) of a task
+typedef void (*JobFunction)(void *data, int first, int last);
+
+//one node of a job graph, its items are split into chunks once every task it depends on has finished
+typedef struct JobTask {
+    JobFunction function;
+    void *data;
+    const int *itemCount;                   //read when the task becomes ready, NULL runs the function once
+    int grainSize;                          //fewest items per chunk, 0 keeps the task in one chunk
+    ProfilePhase phase;                     //the task's time from ready to done is added to this phase
+    int dependents[MaxJobDependents];
+    int dependentCount;
+    int pendingDependencies;
+    int pendingChunks;
+    double readyTime;
+} JobTask;
+
+//tasks can only depend on tasks added before them, so the graph can't have cycles
+typedef struct JobGraph {
+    JobTask tasks[MaxJobTasks];
+    int taskCount;
+} JobGraph;
+
+typedef struct Job {
+    int task;
+    int first;
+    int last;
+} Job;
+
+//a worker pushes and pops its own jobs at the tail, idle workers steal the oldest ones from the head
+typedef struct JobDeque {
+    Job jobs[MaxQueuedJobs];
+    int head;
+    int tail;
+    pthread_mutex_t lock;
+} JobDeque;
+
+typedef struct JobSystem JobSystem;
+
+typedef struct JobWorker {
+    JobSystem *system;
+    int index;
+} JobWorker;
+
+//worker 0 is the thread running the graph, the others sleep until jobs are queued
+struct JobSystem {
+    pthread_t threads[MaxJobWorkers];
+    JobWorker workers[MaxJobWorkers];
+    JobDeque deques[MaxJobWorkers];
+    int workerCount;                        //deques, fixed before any thread starts
+    int threadCount;
+    pthread_mutex_t lock;                   //guards everything below and the running graph's counters
+    pthread_cond_t wake;
+    JobGraph *graph;
+    int pendingTasks;
+    int queuedJobs;
+    bool IsShuttingDown;
+};
+
+//per tick input and timestep of a recorded session, expanded in memory and run-length encoded on disk
+typedef struct Replay {
+    unsigned char *buttons;
+    float *dt;
+    int tickCount;
+    int capacity;
+} Replay;
+
+//----------------------------------------------------------------------------------
+// Global Variables Definition
+//----------------------------------------------------------------------------------
+static const float PlayerMoveSpeed = 15.0f;     //world units per second
+static const float PlayerTurnSpeed = 150.0f;    //degrees per second
+static const float EnemyTurnSpeed = 60.0f;      //degrees per second
+static const float MaxFrameTime = 0.25f;        //longest frame the simulation catches up on, a longer stall slows the game instead
+static const float PlayerMGDelay = 0.1f;
+static const float ProjectileRadius = 1.0f;     //collision sphere of every bullet
+static const float BattleshipFireRate = 1;
+static const float BattleshipYaw = 180.0f;      //degrees the battleship model is turned by, for drawing and collision alike
+static const float EnemyPursuitRange = 60.0f;   //enemies farther from the player hold their ground
+static const int flowSteps[FlowDirectionCount + 1][3] = {{1, 0, 2}, {-1, 0, 2}, {0, 1, 2}, {0, -1, 2},     //x, z and cost of each move out of a nav cell
+                                                         {1, 1, 3}, {1, -1, 3}, {-1, 1, 3}, {-1, -1, 3}, {0, 0, 0}};
+static const float LodTriangleRatios[MaxModelLods] = {1.0f, 0.5f, 0.25f, 0.1f};    //share of the source triangles each level keeps
+static const float LodScreenSizes[MaxModelLods] = {1.0f, 0.07f, 0.04f, 0.02f};     //a level is used below this share of the screen height
+static const float LodHysteresis = 1.25f;                                           //how far past a switch point an instance has to grow to go back
+
+static const float MinVoiceGain = 0.05f;        //quieter sounds are dropped instead of taking a voice
+static const SoundSettings soundSettings[SOUND_TYPE_COUNT] = {
+    [PLAYER_TANK_GUN_SOUND] = { 3, 3, 150.0f },
+    [PLAYER_MG_SOUND] = { 4, 2, 100.0f },
+    [ENEMY_DIE_SOUND] = { 3, 3, 150.0f },
+    [ENEMY_HIT_SOUND] = { 4, 1, 80.0f },
+    [ENEMY_TANK_GUN_SOUND] = { 4, 2, 120.0f },
+    [HEALTH_PICKUP_SOUND] = { 1, 4, 150.0f, true }     //rare, one play per pickup collected
+};
+
+//QOA made with --compress-audio, the WAV masters only live in the history, a type marked IsStreamed is opened as a music stream instead
+static const char *soundFiles[SOUND_TYPE_COUNT] = {
+    [PLAYER_TANK_GUN_SOUND] = "The Last Tank/TLT_explosion_6.qoa",
+    [PLAYER_MG_SOUND] = "The Last Tank/TLT_machine_gun.qoa",
+    [ENEMY_DIE_SOUND] = "The Last Tank/TLT_explosion_7.qoa",
+    [ENEMY_HIT_SOUND] = "The Last Tank/TLT_hit_1.qoa",
+    [ENEMY_TANK_GUN_SOUND] = "The Last Tank/TLT_explosion_1.qoa",
+    [HEALTH_PICKUP_SOUND] = "The Last Tank/TLT_health.qoa"
+};
+
+static Profiler profiler = { 0 };
+static JobSystem jobs = { 0 };                  //runs the simulation's jobs, every task stays on the calling thread until initialized
+static const char *profilePhaseNames[PROFILE_PHASE_COUNT] = {"input", "enemy ai", "battleship", "bullet move", "bullet vs enemy",
+                                                              "bullet vs player", "bullet vs static", "pickups", "rules",
+                                                              "update", "draw", "load", "frame"};
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration
+//----------------------------------------------------------------------------------
+static StaticGrid LoadStaticGrid(const BoundingBox *boxes, int boxCount, float cellSize);
+static void UnloadStaticGrid(StaticGrid grid);
+static bool CheckCollisionStaticGridSphere(const StaticGrid *grid, Vector3 center, float radius);
+static int CheckCollisionSpheresBatch(const float *x, const float *y, const float *z, const float *radius, int count, Vector3 center, float centerRadius, unsigned char *hits);
+static int CheckCollisionBoxSpheresBatch(BoundingBox box, const float *x, const float *y, const float *z, const float *radius, int count, unsigned char *hits);
+static int CheckCollisionBoxesSphereBatch(const float *minX, const float *minY, const float *minZ, const float *maxX, const float *maxY, const float *maxZ,
+                                          int count, Vector3 center, float radius);
+static Projectiles LoadProjectiles(GameMemory *memory, const int *typeCapacity, const float *typeSpeed, const float *typeRange);
+static int SpawnProjectile(Projectiles *projectiles, ProjectileType type, Vector3 pos, float yaw, int damage, int owner);
+static void KillProjectile(Projectiles *projectiles, int slot);
+static void MoveProjectiles(Projectiles *projectiles, int first, int last, Vector3 playerPos, float dt);
+static void ExpireProjectiles(Projectiles *projectiles);
+static Vector3 GetProjectilePosition(const Projectiles *projectiles, int slot);
+static Vector3 GetProjectileStartPosition(const Projectiles *projectiles, int slot);
+static void RecordProjectileHit(Projectiles *projectiles, int k, float time, ProjectileHitKind kind, int index);
+static float GetSweptSphereHitTime(Vector3 start, Vector3 end, float radius, Vector3 center, float targetRadius);
+static float GetSweptBoxHitTime(Vector3 start, Vector3 end, float radius, BoundingBox box);
+static float GetStaticGridSweptHitTime(const StaticGrid *grid, Vector3 start, Vector3 end, float radius);
+static bool IsStaticGridSegmentClear(const StaticGrid *grid, Vector3 start, Vector3 end);
+static TriangleBvh BuildTriangleBvh(Vector3 *vertices, int triangleCount);
+static void UnloadTriangleBvh(TriangleBvh bvh);
+static bool CheckCollisionTriangleBvhSphere(const TriangleBvh *bvh, Vector3 center, float radius);
+static float GetTriangleBvhSweptHitTime(const TriangleBvh *bvh, Vector3 start, Vector3 end, float radius);
+static DynamicGrid LoadDynamicGrid(GameMemory *memory, const int *kindCapacity, float cellSize);
+static void UpdateDynamicGridItem(DynamicGrid *grid, DynamicKind kind, int index, Vector3 pos, float radius);
+static void RemoveDynamicGridItem(DynamicGrid *grid, DynamicKind kind, int index);
+static DynamicGridQuery QueryDynamicGrid(const DynamicGrid *grid, DynamicKind kind, Vector3 center, float radius);
+static bool NextDynamicGridItem(DynamicGridQuery *query, int *index);
+static NavGrid LoadNavGrid(const BoundingBox *boxes, int boxCount, float cellSize, float agentRadius);
+static void UnloadNavGrid(NavGrid grid);
+static int GetNavCell(const NavGrid *grid, Vector3 pos);
+static FlowField LoadFlowField(GameMemory *memory, const NavGrid *grid);
+static void UpdateFlowField(FlowField *field, const NavGrid *grid, long long *heap, Vector3 target);
+static Vector3 GetFlowFieldDirection(const FlowField *field, const NavGrid *grid, Vector3 pos);
+static InstanceBatch LoadInstanceBatch(Model model, Shader instancingShader, int capacity);
+static void UnloadInstanceBatch(InstanceBatch batch);
+static bool AddVisibleInstance(InstanceBatch *batch, Frustum *frustum, Matrix transform);
+static BoundingSphere GetModelBoundingSphere(Model model);
+static BoundingBox GetTransformedBoundingBox(BoundingBox box, Matrix transform);
+static Frustum GetCameraFrustum(Camera camera, float aspect, float farDistance);
+static bool IsSphereInFrustum(Frustum *frustum, Vector3 center, float radius);
+static bool IsBoxInFrustum(Frustum *frustum, BoundingBox box);
+static void DrawInstanceBatch(InstanceBatch *batch);
+static StaticBatch BakeStaticBatch(Model model, Shader instancingShader, const Vector3 *positions, int count, float chunkSize);
+static void UnloadStaticBatch(StaticBatch batch);
+static void DrawStaticBatch(StaticBatch *batch, Frustum *frustum);
+static BoundingBox LoadObjBounds(const char *fileName);
+static Vector3 *LoadObjTriangles(const char *fileName, int *triangleCount);
+static TriangleBvh LoadTriangleBvh(const char *fileName);
+static void LoadModelLods(ModelLod *lods, const Model *models, const char **fileNames, const unsigned long long *sourceHashes, int count);
+static void UnloadModelLod(ModelLod lod);
+static int SelectModelLod(const ModelLod *lod, int current, float screenSize);
+static float GetProjectedSize(Camera camera, Vector3 center, float radius);
+static bool AddVisibleLodInstance(InstanceBatch *batches, const ModelLod *lod, unsigned char *current, Frustum *frustum, Camera camera, Matrix transform);
+static void ReleaseResource(ResourceManager *resources, ResourceHandle handle);
+static void UnloadResources(ResourceManager *resources);
+static void TraceResources(const ResourceManager *resources);
+static ResourceHandle QueueModel(AssetLoader *loader, const char *fileName, Model *target);
+static ResourceHandle QueueTexture(AssetLoader *loader, const char *fileName, bool useMipmaps, bool allowCompression, Texture2D *target);
+static ResourceHandle QueueSound(AssetLoader *loader, const char *fileName, Sound *target);
+static ResourceHandle QueueSoundStream(AssetLoader *loader, const char *fileName, Music *target);
+static void StartAssetLoader(AssetLoader *loader, int workerCount);
+static bool UpdateAssetLoader(AssetLoader *loader);
+static void DrawLoadingScreen(const AssetLoader *loader);
+static void InitJobSystem(JobSystem *system, int workerCount);
+static void ShutdownJobSystem(JobSystem *system);
+static int AddJobTask(JobGraph *graph, JobFunction function, void *data, const int *itemCount, int grainSize, ProfilePhase phase);
+static void AddJobDependency(JobGraph *graph, int task, int dependsOn);
+static void RunJobGraph(JobSystem *system, JobGraph *graph);
+static Level LoadLevel(const char *fileName);
+static void UnloadLevel(Level level);
+static bool ExportLevel(Level level, const char *fileName);
+static void InitWorld(World *world, const Level *level, BoundingBox verticalWallBounds, BoundingBox horizontalWallBounds, BoundingBox building1Bounds, const TriangleBvh *battleshipBvh);
+static void UnloadWorld(World *world);
+static float GetBattleshipSweptHitTime(const World *world, Vector3 start, Vector3 end, float radius);
+static float GetYawError(float targetYaw, float yaw);
+static bool CheckCollisionBattleshipSphere(const World *world, Vector3 center, float radius);
+static void *PushGameMemory(GameMemory *memory, int size);
+static GameState *InitGameState(GameMemory *memory, const World *world);
+static GameState *LoadGameState(const World *world);
+static void UnloadGameState(GameState *state);
+static void TakeGameSnapshot(const GameState *state, unsigned char *snapshot);
+static void RestoreGameSnapshot(GameState *state, const unsigned char *snapshot);
+static SnapshotRing LoadSnapshotRing(const GameState *state, int capacity);
+static void UnloadSnapshotRing(SnapshotRing ring);
+static void PushSnapshotRing(SnapshotRing *ring, const GameState *state);
+static bool PopSnapshotRing(SnapshotRing *ring, GameState *state);
+static void PushSoundEvent(GameState *state, SoundType sound, Vector3 pos);
+static void InitVoiceManager(VoiceManager *voices, const Sound *sounds, const Music *streams);
+static void UnloadVoiceManager(VoiceManager *voices);
+static void PlaySoundEvents(VoiceManager *voices, const SoundEvent *events, int eventCount, Vector3 listenerPos);
+static void UpdateVoiceManager(VoiceManager *voices);
+static bool CompressAudio(const char *fileName, const char *outputFileName);
+static void SimStep(GameState *state, const InputFrame *input, float dt);
+static InputFrame GetInputFrame(void);
+static unsigned int GetGameStateChecksum(const GameState *state);
+static void UpdateBotInput(const GameState *state, unsigned int *rng, InputFrame *input);
+static int LoadInputScript(const char *fileName, ScriptLine **lines);
+static double GetProfilerTime(void);
+static void BeginProfilePhase(ProfilePhase phase);
+static void EndProfilePhase(ProfilePhase phase);
+static void EndProfilerFrame(void);
+static bool OpenProfilerCsv(const char *fileName);
+static void CloseProfilerCsv(void);
+static void DrawProfilerOverlay(int posX, int posY);
+static void RecordReplayTick(Replay *replay, const InputFrame *input, float dt);
+static bool SaveReplay(const Replay *replay, const char *fileName);
+static Replay LoadReplay(const char *fileName);
+static void UnloadReplay(Replay replay);
+static int RunHeadless(int argc, char *argv[]);
+static int RunCollisionSelfTest(void);
+
 //------------------------------------------------------------------------------------
 // Program main entry point
 //------------------------------------------------------------------------------------
-int main(void)
+int main(int argc, char *argv[])
 {
+    //simulation only runs for build servers, no window or audio device
+    //--selftest checks the batch collision kernels against raylib's tests and exits
+    for(int i = 1; i < argc; i++){
+        if(strcmp(argv[i], "--headless") == 0) return RunHeadless(argc, argv);
+        if(strcmp(argv[i], "--selftest") == 0) return (RunCollisionSelfTest() == 0) ? 0 : 1;
+    }
+    
+    //--compile-level <text> <output> turns an authored level into the binary form and exits
+    //--compress-audio <sound> <output.qoa> does the same for sound assets
+    for(int i = 1; i < argc - 2; i++){
+        if(strcmp(argv[i], "--compile-level") == 0){
+            Level level = LoadLevel(argv[i + 1]);
+            bool IsCompiled = (level.data != NULL) && ExportLevel(level, argv[i + 2]);
+            UnloadLevel(level);
+            return IsCompiled ? 0 : 1;
+        }
+        if(strcmp(argv[i], "--compress-audio") == 0) return CompressAudio(argv[i + 1], argv[i + 2]) ? 0 : 1;
+    }
+    
+    //--record saves this session's input on exit, --replay plays one back instead of reading the keyboard
+    //--profile-csv writes every frame's phase timings to a file
+    //--fps caps the frame rate, 0 draws as fast as possible, --tick-rate sets the simulation steps per second
+    const char *recordFileName = NULL;
+    const char *replayFileName = NULL;
+    const char *profileFileName = NULL;
+    const char *levelFileName = DEFAULT_LEVEL_FILE;
+    int targetFps = 60;
+    int simTickRate = SIM_TICK_RATE;
+    for(int i = 1; i < argc - 1; i++){
+        if(strcmp(argv[i], "--record") == 0) recordFileName = argv[++i];
+        else if(strcmp(argv[i], "--level") == 0) levelFileName = argv[++i];
+        else if(strcmp(argv[i], "--replay") == 0) replayFileName = argv[++i];
+        else if(strcmp(argv[i], "--profile-csv") == 0) profileFileName = argv[++i];
+        else if(strcmp(argv[i], "--fps") == 0) targetFps = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--tick-rate") == 0) simTickRate = atoi(argv[++i]);
+    }
+    if(simTickRate <= 0) simTickRate = SIM_TICK_RATE;
+    
     // Initialization
     //--------------------------------------------------------------------------------------
     const int screenWidth = 1800;
     const int screenHeight = 900;
-    const float playerMoveSpeed = 0.25f;
-    const int MaxPlayerTankBullets = 20;
-    const int MaxPlayerMGBullets = 70;
-    const int MaxEnemyTankBullets = 30;
-    const int MaxEnemyMGBullets = 70;
-    const int PlayerTankDelay = 1;
-    const float PlayerMGDelay = 0.1f;
-    const int MaxNumberOfEnemyTanks = 20;
-    const int MaxNumberOfEnemyAPCs = 15;
-    const int MaxNumberOfSpecialBullets = 30;
-    const int MaxNumberOfBattleShipTankBullets = 30;
-    const int MaxPlayerMainGunAmmo = 50;
-    const int MaxPlayerMGAmmo = 300;
-    const int HealthBoost = 75;
-    const int MainGunAmmoBoost = 30;
-    const int MGAmmoBoost = 60;
-    const int MaxNumberOfPickups = 52;
-    const int VerticalWallCount = 54;
-    const int HorizontalWallCount = 48;
-    const int Building1Count = 40;
-    const int MaxBattleshipHealth = 500;
-    const int SpecialBulletDamage = 50;
-    const float BattleshipFireRate = 1;
+    const float ViewDistance = 150.0f;          //far plane used for culling, independent of the render far plane
     
     Image GameIcon = LoadImage("The Last Tank/GameIcon.png");
     InitWindow(screenWidth, screenHeight, "The Last Tank - A Game By Akshat Maurya");
     SetWindowIcon(GameIcon);
     InitAudioDevice();
     
-    SetTargetFPS(60);               // Set our game to run at 60 frames-per-second
+    SetTargetFPS(targetFps);        // Set our game to run at 60 frames-per-second unless asked otherwise
     //--------------------------------------------------------------------------------------
     
+    //every model, texture and sound is decoded on a worker per core, the main thread only uploads and shows progress
+    Model playerTank, tankBullet, EnemyTankModel, EnemyAPCModel, MGBullet, HealthPickup, MainGunPickup, MGPickup;
+    Model Wall_Horizontal, Wall_Vertical, Building1, LevelModel, BattleShipModel, BigBullet;
+    Texture2D playerTank_tex, bulletTexture, enemyTank_tex, enemyAPC_tex, pickupTexture, building1_tex, level_tex, battleship_tex;
+    Texture2D healthIcon_tex, MainGunIcon_tex, MGIcon_tex, explosionFlipBookTexture;
+    Sound sounds[SOUND_TYPE_COUNT] = { 0 };         //indexed by the sounds the simulation raises
+    Music soundStreams[SOUND_TYPE_COUNT] = { 0 };   //the ones with IsStreamed set
+    
+    ResourceManager resources = { 0 };
+    AssetLoader loader = { .resources = &resources };
+    
     //models
-    Model playerTank = LoadModel("The Last Tank/PlayerTank.obj");                   //setting up and loading model
-    Model tankBullet = LoadModel("The Last Tank/TankBullet.obj");
-    Model EnemyTankModel = LoadModel("The Last Tank/EnemyTank.obj");
-    Model EnemyAPCModel = LoadModel("The Last Tank/EnemyAPC.obj");
-    Model MGBullet = LoadModel("The Last Tank/GunBullet.obj");
-    Model HealthPickup = LoadModel("The Last Tank/HealthPickup.obj");
-    Model MainGunPickup = LoadModel("The Last Tank/MainGunPickup.obj");
-    Model MGPickup = LoadModel("The Last Tank/MGPickup.obj");
-    Model Wall_Horizontal = LoadModel("The Last Tank/HorizontalWallSegment.obj");
-    Model Wall_Vertical = LoadModel("The Last Tank/VerticalWallSegment.obj");
-    Model Building1 = LoadModel("The Last Tank/Building1.obj");
-    Model LevelModel = LoadModel("The Last Tank/Level.obj");
-    Model BattleShipModel = LoadModel("The Last Tank/LandBattleship.obj");
-    Model BigBullet = LoadModel("The Last Tank/BigBullet.obj");
+    QueueModel(&loader, "The Last Tank/PlayerTank.obj", &playerTank);
+    QueueModel(&loader, "The Last Tank/TankBullet.obj", &tankBullet);
+    ResourceHandle enemyTankHandle = QueueModel(&loader, "The Last Tank/EnemyTank.obj", &EnemyTankModel);
+    ResourceHandle enemyAPCHandle = QueueModel(&loader, "The Last Tank/EnemyAPC.obj", &EnemyAPCModel);
+    QueueModel(&loader, "The Last Tank/GunBullet.obj", &MGBullet);
+    QueueModel(&loader, "The Last Tank/HealthPickup.obj", &HealthPickup);
+    QueueModel(&loader, "The Last Tank/MainGunPickup.obj", &MainGunPickup);
+    QueueModel(&loader, "The Last Tank/MGPickup.obj", &MGPickup);
+    QueueModel(&loader, "The Last Tank/HorizontalWallSegment.obj", &Wall_Horizontal);
+    QueueModel(&loader, "The Last Tank/VerticalWallSegment.obj", &Wall_Vertical);
+    QueueModel(&loader, "The Last Tank/Building1.obj", &Building1);
+    QueueModel(&loader, "The Last Tank/Level.obj", &LevelModel);
+    ResourceHandle battleshipHandle = QueueModel(&loader, "The Last Tank/LandBattleship.obj", &BattleShipModel);
+    QueueModel(&loader, "The Last Tank/BigBullet.obj", &BigBullet);
     
     //textures
-    Texture2D playerTank_tex = LoadTexture("The Last Tank/PlayerTank_BaseColor.png");     //loading texture
-    Texture2D bulletTexture = LoadTexture("The Last Tank/Bullets.png");
-    Texture2D enemyTank_tex = LoadTexture("The Last Tank/EnemyTank_BaseColor.png");
-    Texture2D enemyAPC_tex = LoadTexture("The Last Tank/EnemyTank_BaseColor.png");
-    Texture2D pickupTexture = LoadTexture("The Last Tank/Pickups_BaseColor.png");
-    Texture2D building1_tex = LoadTexture("The Last Tank/Building1_BaseColor.png");
-    Texture2D level_tex = LoadTexture("The Last Tank/Level_BaseColor.png");
-    Texture2D battleship_tex = LoadTexture("The Last Tank/LandBattleship_BaseColor.png");
-    Texture2D healthIcon_tex = LoadTexture("The Last Tank/HealthIcon.png");
-    Texture2D MainGunIcon_tex = LoadTexture("The Last Tank/MainAmmoIcon.png");
-    Texture2D MGIcon_tex = LoadTexture("The Last Tank/MGAmmoIcon.png");
-    Texture2D explosionFlipBookTexture = LoadTexture("The Last Tank/Explosion00_5x5.png");
+    QueueTexture(&loader, "The Last Tank/PlayerTank_BaseColor.png", true, true, &playerTank_tex);
+    QueueTexture(&loader, "The Last Tank/Bullets.png", true, true, &bulletTexture);
+    QueueTexture(&loader, "The Last Tank/EnemyTank_BaseColor.png", true, true, &enemyTank_tex);
+    QueueTexture(&loader, "The Last Tank/EnemyTank_BaseColor.png", true, true, &enemyAPC_tex);
+    QueueTexture(&loader, "The Last Tank/Pickups_BaseColor.png", true, true, &pickupTexture);
+    QueueTexture(&loader, "The Last Tank/Building1_BaseColor.png", true, true, &building1_tex);
+    QueueTexture(&loader, "The Last Tank/Level_BaseColor.png", true, true, &level_tex);
+    QueueTexture(&loader, "The Last Tank/LandBattleship_BaseColor.png", true, true, &battleship_tex);
+    QueueTexture(&loader, "The Last Tank/HealthIcon.png", false, false, &healthIcon_tex);
+    QueueTexture(&loader, "The Last Tank/MainAmmoIcon.png", false, false, &MainGunIcon_tex);
+    QueueTexture(&loader, "The Last Tank/MGAmmoIcon.png", false, false, &MGIcon_tex);
+    QueueTexture(&loader, "The Last Tank/Explosion00_5x5.png", false, false, &explosionFlipBookTexture);
+    
+    //audio
+    for(int t = 0; t < SOUND_TYPE_COUNT; t++){
+        if(soundSettings[t].IsStreamed) QueueSoundStream(&loader, soundFiles[t], &soundStreams[t]);
+        else QueueSound(&loader, soundFiles[t], &sounds[t]);
+    }
+    
+    StartAssetLoader(&loader, GetCpuCount());
+    while(!UpdateAssetLoader(&loader)) DrawLoadingScreen(&loader);
+    TraceResources(&resources);
+    
+    //sound triggers go through a fixed pool of voices
+    VoiceManager voices;
+    InitVoiceManager(&voices, sounds, soundStreams);
+    
+    //simulation jobs run on a worker per core
+    InitJobSystem(&jobs, GetCpuCount());
     
     //materials
     playerTank.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture = playerTank_tex; //assigning texture to model
@@ -114,13 +1114,22 @@ int main(void)
     BattleShipModel.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture = battleship_tex;
     BigBullet.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture = bulletTexture;
     
-    //audio
-    Sound PlayerTankGunSound = LoadSound("The Last Tank/TLT_explosion_6.wav");
-    Sound PlayerMGSound = LoadSound("The Last Tank/TLT_machine_gun.wav");
-    Sound EnemyDieSound = LoadSound("The Last Tank/TLT_explosion_7.wav");
-    Sound EnemyHitSound = LoadSound("The Last Tank/TLT_hit_1.wav");
-    Sound EnemyTankGunSound = LoadSound("The Last Tank/TLT_explosion_1.wav");
-    Sound HealthPickupSound = LoadSound("The Last Tank/TLT_health.wav");
+    //level related stuff
+    LevelModel.transform = MatrixRotateY(DEG2RAD * 180);
+    BattleShipModel.transform = MatrixRotateY(DEG2RAD * BattleshipYaw);
+    
+    //simplified copies of the models that are often small on screen, built once and then read from the cache
+    ModelLod modelLods[3];
+    LoadModelLods(modelLods, (Model[]){ EnemyTankModel, EnemyAPCModel, BattleShipModel },
+                  (const char *[]){ "The Last Tank/EnemyTank.obj", "The Last Tank/EnemyAPC.obj", "The Last Tank/LandBattleship.obj" },
+                  (unsigned long long[]){ resources.resources[enemyTankHandle].contentHash, resources.resources[enemyAPCHandle].contentHash,
+                                          resources.resources[battleshipHandle].contentHash }, 3);
+    ModelLod enemyTankLod = modelLods[0], enemyAPCLod = modelLods[1], battleshipLod = modelLods[2];
+    
+    //instancing shader, per instance transforms come in through the instanceTransform attribute
+    Shader instancingShader = LoadShader("The Last Tank/instancing.vs", "The Last Tank/instancing.fs");
+    instancingShader.locs[SHADER_LOC_MATRIX_MVP] = GetShaderLocation(instancingShader, "mvp");
+    instancingShader.locs[SHADER_LOC_MATRIX_MODEL] = GetShaderLocationAttrib(instancingShader, "instanceTransform");
     
     Camera cam = {0};                                             //setting up camera
     cam.position = (Vector3){0.0f, 16.0f, 8.0f};
@@ -129,1288 +1138,5392 @@ int main(void)
     cam.up = (Vector3){0.0f, 1.0f, 0.0f};
     cam.projection = CAMERA_PERSPECTIVE;
     
-    //walls data
-    Vector3 VerticalWallPositions[] = { (Vector3){-25.0f, 0.0f, 1.0f}, (Vector3){-25.0f, 0.0f, -9.0f}, 
-                                                        (Vector3){-25.0f, 0.0f, -19.0f}, (Vector3){-25, 0.0f, -39.0f},
-                                                        (Vector3){-25.0f, 0.0f, -29.0f}, (Vector3){25.0f, 0.0f, -29.0f},
-                                                        (Vector3){25.0f, 0.0f, 1.0f}, (Vector3){25.0f, 0.0f, -9.0f},
-                                                        (Vector3){25.0f, 0.0f, -19.0f}, (Vector3){25.0f, 0.0f, -39.0f},
-                                                        (Vector3){25.0f, 0.0f, -49.0f}, (Vector3){25.0f, 0.0f, -59.0f},
-                                                        (Vector3){25.0f, 0.0f, -69.0f}, (Vector3){25.0f, 0.0f, -79.0f},
-                                                        (Vector3){25.0f, 0.0f, -89.0f}, (Vector3){25.0f, 0.0f, -99.0f},
-                                                        (Vector3){25.0f, 0.0f, -109.0f}, (Vector3){5.0f, 0.0f, -49.0f},
-                                                        (Vector3){-25.0f, 0.0f, -59.0f}, (Vector3){-25.0f, 0.0f, -69.0f},
-                                                        (Vector3){-25.0f, 0.0f, -79.0f}, (Vector3){-25.0f, 0.0f, -89.0f},
-                                                        (Vector3){-25.0f, 0.0f, -99.0f}, (Vector3){5.0f, 0.0f, -109.0f},
-                                                        (Vector3){-25.0f, 0.0f, -119.0f}, (Vector3){-25.0f, 0.0f, -129.0f},
-                                                        (Vector3){-25.0f, 0.0f, -139.0f}, (Vector3){-25.0f, 0.0f, -149.0f},
-                                                        (Vector3){-25.0f, 0.0f, -159.0f}, (Vector3){-25.0f, 0.0f, -169.0f},
-                                                        (Vector3){-25.0f, 0.0f, -179.0f}, (Vector3){55.0f, 0.0f, -119.0f},
-                                                        (Vector3){55.0f, 0.0f, -129.0f}, (Vector3){55.0f, 0.0f, -139.0f},
-                                                        (Vector3){55.0f, 0.0f, -149.0f}, (Vector3){55.0f, 0.0f, -159.0f},
-                                                        (Vector3){55.0f, 0.0f, -169.0f}, (Vector3){55.0f, 0.0f, -179.0f},
-                                                        (Vector3){5.0f, 0.0f, -189.0f}, (Vector3){25.0f, 0.0f, -189.0f}, 
-                                                        (Vector3){75.0f, 0.0f, -199.0f}, (Vector3){75.0f, 0.0f, -209.0f},
-                                                        (Vector3){75.0f, 0.0f, -219.0f}, (Vector3){75.0f, 0.0f, -229.0f},
-                                                        (Vector3){75.0f, 0.0f, -239.0f}, (Vector3){75.0f, 0.0f, -249.0f},
-                                                        (Vector3){75.0f, 0.0f, -259.0f}, (Vector3){-45.0f, 0.0f, -199.0f},
-                                                        (Vector3){-45.0f, 0.0f, -209.0f}, (Vector3){-45.0f, 0.0f, -219.0f},
-                                                        (Vector3){-45.0f, 0.0f, -229.0f}, (Vector3){-45.0f, 0.0f, -239.0f},
-                                                        (Vector3){-45.0f, 0.0f, -249.0f}, (Vector3){-45.0f, 0.0f, -259.0f} };
-    
-    Vector3 HorizontalWallPositions[] = { (Vector3){-20.0f, 0.0f, 6.0f}, (Vector3){-10.0f, 0.0f, 6.0f}, 
-                                                            (Vector3){0.0f, 0.0f, 6.0f}, (Vector3){10.0f, 0.0f, 6.0f},
-                                                            (Vector3){20.0f, 0.0f, 6.0f}, (Vector3){-20.0f, 0.0f, -44.0f},
-                                                            (Vector3){-10.0f, 0.0f, -44.0f}, (Vector3){0.0f, 0.0f, -44.0f},
-                                                            (Vector3){-20.0f, 0.0f, -54.0f}, (Vector3){-10.0f, 0.0f, -54.0f},
-                                                            (Vector3){0.0f, 0.0f, -54.0f}, (Vector3){-20.0f, 0.0f, -104.0f}, 
-                                                            (Vector3){-10.0f, 0.0f, -104.0f}, (Vector3){0.0f, 0.0f, -104.0f},
-                                                            (Vector3){-20.0f, 0.0f, -114.0f}, (Vector3){-10.0f, 0.0f, -114.0f},
-                                                            (Vector3){0.0f, 0.0f, -114.0f}, (Vector3){30.0f, 0.0f, -114.0f},
-                                                            (Vector3){40.0f, 0.0f, -114.0f}, (Vector3){50.0f, 0.0f, -114.0f},
-                                                            (Vector3){-20.0f, 0.0f, -184.0f}, (Vector3){-10.0f, 0.0f, -184.0f},
-                                                            (Vector3){30.0f, 0.0f, -184.0f}, (Vector3){40.0f, 0.0f, -184.0f},
-                                                            (Vector3){50.0f, 0.0f, -184.0f}, (Vector3){-40.0f, 0.0f, -194.0f}, 
-                                                            (Vector3){-30.0f, 0.0f, -194.0f}, (Vector3){-20.0f, 0.0f, -194.0f}, 
-                                                            (Vector3){-10.0f, 0.0f, -194.0f}, (Vector3){0.0f, 0.0f, -194.0f},
-                                                            (Vector3){30.0f, 0.0f, -194.0f}, (Vector3){40.0f, 0.0f, -194.0f},
-                                                            (Vector3){50.0f, 0.0f, -194.0f}, (Vector3){60.0f, 0.0f, -194.0f},
-                                                            (Vector3){70.0f, 0.0f, -194.0f}, (Vector3){-40.0f, 0.0f, -264.0f}, 
-                                                            (Vector3){-30.0f, 0.0f, -264.0f}, (Vector3){-20.0f, 0.0f, -264.0f},
-                                                            (Vector3){-10.0f, 0.0f, -264.0f}, (Vector3){0.0f, 0.0f, -264.0f},
-                                                            (Vector3){10.0f, 0.0f, -264.0f}, (Vector3){20.0f, 0.0f, -264.0f},
-                                                            (Vector3){30.0f, 0.0f, -264.0f}, (Vector3){40.0f, 0.0f, -264.0f},
-                                                            (Vector3){50.0f, 0.0f, -264.0f}, (Vector3){60.0f, 0.0f, -264.0f}, 
-                                                            (Vector3){70.0f, 0.0f, -264.0f}, (Vector3){0.0f, 0.0f, -184.0f} };
-    
-    //walls
-    BoundingBox verticalWalls[VerticalWallCount];
-    BoundingBox horizontalWalls[HorizontalWallCount];
-    
-    //bounding box for land battleship
-    BoundingBox battleshipBox = GetMeshBoundingBox(BattleShipModel.meshes[0]);
-    
-    //setting position of vertical wall pieces
-    for(int i = 0; i < VerticalWallCount; i++){
-        verticalWalls[i] = GetMeshBoundingBox(Wall_Vertical.meshes[0]);
-        verticalWalls[i].min = Vector3Add(verticalWalls[i].min, VerticalWallPositions[i]);
-        verticalWalls[i].max = Vector3Add(verticalWalls[i].max, VerticalWallPositions[i]);
+    //map placements, F5 reloads the file while playing
+    Level level = LoadLevel(levelFileName);
+    if(level.data == NULL){
+        TraceLog(LOG_ERROR, "LEVEL: [%s] Could not load level", levelFileName);
+        return 1;
     }
     
-    //setting position of horizontal wall pieces
-    for(int i = 0; i < HorizontalWallCount; i++){
-        horizontalWalls[i] = GetMeshBoundingBox(Wall_Horizontal.meshes[0]);
-        horizontalWalls[i].min = Vector3Add(horizontalWalls[i].min, HorizontalWallPositions[i]);
-        horizontalWalls[i].max = Vector3Add(horizontalWalls[i].max, HorizontalWallPositions[i]);
-    }
-    
-    //buildings
-    Vector3 Building1_Positions[] = {(Vector3){-13.0f, 0.0f, -1.0f}, (Vector3){15.0f, 0.0f, 0.0f},
-                                     (Vector3){-15.0f, 0.0f, -12.0f}, (Vector3){0.0f, 0.0f, -12.0f},
-                                     (Vector3){16.0f, 0.0f, -12.0f}, (Vector3){-15.0f, 0.0f, -24.0f},
-                                     (Vector3){0.0f, 0.0f, -24.0f}, (Vector3){16.0f, 0.0f, -24.0f}, 
-                                     (Vector3){-8.0f, 0.0f, -35.0f}, (Vector3){-8.0f, 0.0f, -36.0f},
-                                     (Vector3){20.0f, 0.0f, -49.0f}, (Vector3){-13.0f, 0.0f, -69.0f}, 
-                                     (Vector3){0.0f, 0.0f, -72.0f}, (Vector3){16.0f, 0.0f, -72.0f},
-                                     (Vector3){16.0f, 0.0f, -84.0f}, (Vector3){-15.0f, 0.0f, -84.0f},
-                                     (Vector3){-8.0f, 0.0f, -95.0f}, (Vector3){8.0f, 0.0f, -96.0f},
-                                     (Vector3){-13.0f, 0.0f, -123.0f}, (Vector3){3.0f, 0.0f, -132.0f},
-                                     (Vector3){25.0f, 0.0f, -132.0f}, (Vector3){45.0f, 0.0f, -130.0f},
-                                     (Vector3){-11.0f, 0.0f, -144.0f}, (Vector3){-29.0f, 0.0f, -150.0f},
-                                     (Vector3){45.0f, 0.0f, -150.0f}, (Vector3){-12.0f, 0.0f, -163.0f},
-                                     (Vector3){0.0f, 0.0f, -173.0f}, (Vector3){18.0f, 0.0f, -166.0f},
-                                     (Vector3){38.0f, 0.0f, -167.0f}, (Vector3){-13.0f, 0.0f, -1.0f},
-                                     (Vector3){30.0f, 0.0f, -212.0f}, (Vector3){-13.0f, 0.0f, -212.0f},
-                                     (Vector3){3.0f, 0.0f, -212.0f}, (Vector3){25.0f, 0.0f, -220.0f},
-                                     (Vector3){45.0f, 0.0f, -210.0f}, (Vector3){64.0f, 0.0f, -210.0f},
-                                     (Vector3){-30.0f, 0.0f, -226.0f}, (Vector3){-11.0f, 0.0f, -229.0f},
-                                     (Vector3){11.0f, 0.0f, -229.0f}, (Vector3){29.0f, 0.0f, -230.0f},
-                                     (Vector3){46.0f, 0.0f, -226.0f}, (Vector3){-63.0f, 0.0f, -226.0f},};
-    //setting up bounding boxes for buildings
-    BoundingBox building1_BBs[Building1Count];
-    for(int i = 0; i < Building1Count; i++){
-        building1_BBs[i] = GetMeshBoundingBox(Building1.meshes[0]);
-        building1_BBs[i].min = Vector3Add(building1_BBs[i].min, Building1_Positions[i]);
-        building1_BBs[i].max = Vector3Add(building1_BBs[i].max, Building1_Positions[i]);
-    }
-    
-    typedef enum E_Type{
-        TANK,
-        APC
-    } EnemyType;
-    
-    typedef enum P_Type{
-        HEALTH,
-        MAINGUN,
-        MG
-    } PickupType;
-    
-    //bullet data
-    typedef struct BulletType{
-        Model bulletModel;
-        Vector3 bulletPos;
-        Vector3 bulletDir;
-        bool IsBulletFired;
-        float bulletYaw;
-        float bulletSpeed;
-        float maxRange;
-    } Bullet;
-    
-    Bullet playerTankBullets[MaxPlayerTankBullets]; //list of all main gun bullets the player can fire
-    Bullet enemyTankBullets[MaxEnemyTankBullets]; //list of all enemy tank gun bullets
-    Bullet playerMGBullets[MaxPlayerMGBullets];
-    Bullet enemyMGBullets[MaxEnemyMGBullets];
-    Bullet battleshipTankBullets[MaxNumberOfBattleShipTankBullets];
-    Bullet battleshipSpecialBullets[MaxNumberOfSpecialBullets];
-    
-    //initializing all bullets
-    for(int i = 0; i < MaxPlayerTankBullets; i++){
-        playerTankBullets[i].bulletModel = tankBullet;
-        playerTankBullets[i].bulletPos = (Vector3){0.0f, 0.0f, 0.0f};
-        playerTankBullets[i].bulletDir = (Vector3){0.0f, 0.0f, 0.0f};
-        playerTankBullets[i].IsBulletFired = false;
-        playerTankBullets[i].bulletYaw = 0;
-        playerTankBullets[i].bulletSpeed = 1;
-        playerTankBullets[i].maxRange = 100;
-    }
-    
-    for(int i = 0; i < MaxPlayerMGBullets; i++){
-        playerMGBullets[i].bulletModel = MGBullet;
-        playerMGBullets[i].bulletPos = (Vector3){0.0f, 0.0f, 0.0f};
-        playerMGBullets[i].bulletDir = (Vector3){0.0f, 0.0f, 0.0f};
-        playerMGBullets[i].IsBulletFired = false;
-        playerMGBullets[i].bulletYaw = 0;
-        playerMGBullets[i].bulletSpeed = 1;
-        playerMGBullets[i].maxRange = 100;
-    }
-    
-    //initializing enemy tank bullets
-        for(int i = 0; i < MaxEnemyTankBullets; i++){
-        enemyTankBullets[i].bulletModel = tankBullet;
-        enemyTankBullets[i].bulletPos = (Vector3){0.0f, 0.0f, 0.0f};
-        enemyTankBullets[i].bulletDir = (Vector3){0.0f, 0.0f, 0.0f};
-        enemyTankBullets[i].IsBulletFired = false;
-        enemyTankBullets[i].bulletYaw = 0;
-        enemyTankBullets[i].bulletSpeed = 1;
-        enemyTankBullets[i].maxRange = 20;
-    }
-    
-    //initializing enemy mg bullets
-    for(int i = 0; i < MaxEnemyMGBullets; i++){
-        enemyMGBullets[i].bulletModel = MGBullet;
-        enemyMGBullets[i].bulletPos = (Vector3){0.0f, 0.0f, 0.0f};
-        enemyMGBullets[i].bulletDir = (Vector3){0.0f, 0.0f, 0.0f};
-        enemyMGBullets[i].IsBulletFired = false;
-        enemyMGBullets[i].bulletYaw = 0;
-        enemyMGBullets[i].bulletSpeed = 1;
-        enemyMGBullets[i].maxRange = 100;
-    }
-    
-    //initializing battleship tank bullets
-    for(int i = 0; i < MaxNumberOfBattleShipTankBullets; i++){
-        battleshipSpecialBullets[i].bulletModel = BigBullet;
-        battleshipSpecialBullets[i].bulletPos = (Vector3){0.0f, 0.0f, 0.0f};
-        battleshipSpecialBullets[i].bulletDir = (Vector3){0.0f, 0.0f, 0.0f};
-        battleshipSpecialBullets[i].IsBulletFired = false;
-        battleshipSpecialBullets[i].bulletYaw = 0;
-        battleshipSpecialBullets[i].bulletSpeed = 1;
-        battleshipSpecialBullets[i].maxRange = 20;
-    }
-    
-    //initializing battleship special bullets
-    for(int i = 0; i < MaxNumberOfSpecialBullets; i++){
-        battleshipTankBullets[i].bulletModel = tankBullet;
-        battleshipTankBullets[i].bulletPos = (Vector3){0.0f, 0.0f, 0.0f};
-        battleshipTankBullets[i].bulletDir = (Vector3){0.0f, 0.0f, 0.0f};
-        battleshipTankBullets[i].IsBulletFired = false;
-        battleshipTankBullets[i].bulletYaw = 0;
-        battleshipTankBullets[i].bulletSpeed = 1;
-        battleshipTankBullets[i].maxRange = 20;
-    }
-    
-    //enemy data
-    typedef struct enemyTank {
-        EnemyType enemyType;
-        Model enemyModel;
-        Vector3 enemyPos;
-        Vector3 enemyDir;
-        float enemyYaw;
-        float enemyRange;
-        float enemyToPlayerAngle;
-        float enemyTankFireRate;
-        float enemyTimeTillLastShot;
-        int enemyHealth;
-        int enemyDamage;
-        bool IsEnemyAlive;
-        bool CanTankFire;
-    }EnemyTank;
-    
-    EnemyTank enemyTanks[MaxNumberOfEnemyTanks]; //list of all enemy tanks
-    Vector3 enemyTankPositions[] = {(Vector3){22.0f, 0.0f, -66.0f}, (Vector3){9.0f, 0.0f, -77.0f},
-                                    (Vector3){-4.0f, 0.0f, -83.0f}, (Vector3){13.0f, 0.0f, -90.0f},
-                                    (Vector3){-17.0f, 0.0f, -94.0f}, (Vector3){2.0f, 0.0f, -97.0f},
-                                    (Vector3){-18.0f, 0.0f, -154.0f}, (Vector3){-1.0f, 0.0f, -154.0f},
-                                    (Vector3){19.0f, 0.0f, -154.0f}, (Vector3){36.0f, 0.0f, -155.0f},
-                                    (Vector3){9.0f, 0.0f, -174.0f}, (Vector3){29.0f, 0.0f, -175.0f},
-                                    (Vector3){46.0f, 0.0f, -172.0f}, (Vector3){-36.0f, 0.0f, -231.0f},
-                                    (Vector3){-22.0f, 0.0f, -228.0f}, (Vector3){-2.0f, 0.0f, -229.0f},
-                                    (Vector3){19.0f, 0.0f, -230.0f}, (Vector3){40.0f, 0.0f, -230.0f},
-                                    (Vector3){50.0f, 0.0f, -230.0f}, (Vector3){70.0f, 0.0f, -230.0f},};
-    Vector3 enemyAPCPositions[] = {(Vector3){-9.0f, 0.0f, -30.0f}, (Vector3){8.0f, 0.0f, -30.0f},
-                                   (Vector3){21.0f, 0.0f, -31.0f}, (Vector3){8.0f, 0.0f, -19.0f},
-                                   (Vector3){-7.0f, 0.0f, -20.0f}, (Vector3){8.0f, 0.0f, -72.0f},
-                                   (Vector3){-12.0f, 0.0f, -72.0f}, (Vector3){4.0f, 0.0f, -85.0f},
-                                   (Vector3){35.0f, 0.0f, -221.0f}, (Vector3){53.0f, 0.0f, -221.0f},
-                                   (Vector3){70.0f, 0.0f, -220.0f}, (Vector3){0.0f, 0.0f, -220.0f},
-                                   (Vector3){-6.0f, 0.0f, -214.0f}, (Vector3){-21.0f, 0.0f, -214.0f},
-                                   (Vector3){-35.0f, 0.0f, -210.0f},};
-    EnemyTank enemyAPCs[MaxNumberOfEnemyAPCs];
-    
-    for(int i = 0; i < MaxNumberOfEnemyTanks; i++){
-        enemyTanks[i].enemyType = TANK;
-        enemyTanks[i].enemyModel = EnemyTankModel;
-        enemyTanks[i].enemyPos = enemyTankPositions[i];
-        enemyTanks[i].enemyDir = (Vector3){0.0f, 0.0f, 0.0f};
-        enemyTanks[i].enemyHealth = 60;
-        enemyTanks[i].enemyRange = 25;
-        enemyTanks[i].enemyYaw = 180;
-        enemyTanks[i].IsEnemyAlive = true;
-        enemyTanks[i].enemyToPlayerAngle = 0;
-        enemyTanks[i].enemyDamage = 10;
-        enemyTanks[i].CanTankFire = true;
-        enemyTanks[i].enemyTankFireRate = 2;
-        enemyTanks[i].enemyTimeTillLastShot = 0;
-    } //initializing list of enemy tanks
+    //walls, buildings and battleship collision, bounds come from the meshes loaded above
+    BoundingBox verticalWallBounds = GetMeshBoundingBox(Wall_Vertical.meshes[0]);
+    BoundingBox horizontalWallBounds = GetMeshBoundingBox(Wall_Horizontal.meshes[0]);
+    BoundingBox building1Bounds = GetMeshBoundingBox(Building1.meshes[0]);
+    TriangleBvh battleshipBvh = LoadTriangleBvh("The Last Tank/LandBattleship.obj");
+    World world = { 0 };
+    InitWorld(&world, &level, verticalWallBounds, horizontalWallBounds, building1Bounds, &battleshipBvh);
     
-    //initializing list of enemy APCs
-    for(int i = 0; i < MaxNumberOfEnemyAPCs; i++){
-        enemyAPCs[i].enemyType = APC;
-        enemyAPCs[i].enemyModel = EnemyAPCModel;
-        enemyAPCs[i].enemyPos = enemyAPCPositions[i];
-        enemyAPCs[i].enemyDir = (Vector3){0.0f, 0.0f, 0.0f};
-        enemyAPCs[i].enemyHealth = 30;
-        enemyAPCs[i].enemyRange = 15;
-        enemyAPCs[i].enemyYaw = 180;
-        enemyAPCs[i].IsEnemyAlive = true;
-        enemyAPCs[i].enemyToPlayerAngle = 0;
-        enemyAPCs[i].enemyDamage = 1;
-        enemyAPCs[i].CanTankFire = true;
-        enemyAPCs[i].enemyTankFireRate = 0.125f;
-        enemyAPCs[i].enemyTimeTillLastShot = 0;
-    }
-    
-    //pickups
-    typedef struct pickup{
-        PickupType pickupType;
-        Vector3 pickupPos;
-        float pickupYaw;
-        Model pickupModel;
-        bool IsPickedUp;
-        float pickupRotSpeed;
-    } Pickup;
-    
-    //data structure for holding type and position of pickups
-    typedef struct p_Data{
-        PickupType type;
-        Vector3 pos;
-    }PickupData;
-    
-    PickupData pickupData[] = {{HEALTH, (Vector3){-14.0f, 0.0f, -7.0f}}, {HEALTH, (Vector3){20.0f, 0.0f, -44.0f}},
-                               {HEALTH, (Vector3){18.0f, 0.0f, -78.0f}}, {HEALTH, (Vector3){-12.0f, 0.0f, -56.0f}},
-                               {HEALTH, (Vector3){-15.0f, 0.0f, -79.0f}}, {HEALTH, (Vector3){9.0f, 0.0f, -91.0f}},
-                               {HEALTH, (Vector3){44.0f, 0.0f, -122.0f}}, {HEALTH, (Vector3){-13.0f, 0.0f, -188.0f}},
-                               {HEALTH, (Vector3){-11.0f, 0.0f, -139.0f}}, {HEALTH, (Vector3){45.0f, 0.0f, -144.0f}},
-                               {HEALTH, (Vector3){-11.0f, 0.0f, -178.0f}}, {HEALTH, (Vector3){37.0f, 0.0f, -181.0f}},
-                               {HEALTH, (Vector3){66.0f, 0.0f, -200.0f}}, {HEALTH, (Vector3){-46.0f, 0.0f, -200.0f}},
-                               {HEALTH, (Vector3){-12.0f, 0.0f, -201.0f}}, {HEALTH, (Vector3){-30.0f, 0.0f, -203.0f}},
-                               {HEALTH, (Vector3){3.0f, 0.0f, -202.0f}}, {HEALTH, (Vector3){25.0f, 0.0f, -202.0f}},
-                               {MG, (Vector3){15.0f, 0.0f, -6.0f}}, {MG, (Vector3){0.0f, 0.0f, -6.0f}},
-                               {MG, (Vector3){16.0f, 0.0f, -18.0f}}, {MG, (Vector3){5.0f, 0.0f, -42.0f}},
-                               {MG, (Vector3){0.0f, 0.0f, -67.0f}}, {MG, (Vector3){16.0f, 0.0f, -67.0f}},
-                               {MG, (Vector3){16.0f, 0.0f, -67.0f}}, {MG, (Vector3){-7.0f, 0.0f, -90.0f}},
-                               {MG, (Vector3){3.0f, 0.0f, -127.0f}}, {MG, (Vector3){25.0f, 0.0f, -125.0f}},
-                               {MG, (Vector3){44.0f, 0.0f, -125.0f}}, {MG, (Vector3){29.0f, 0.0f, -145.0f}},
-                               {MG, (Vector3){1.0f, 0.0f, -166.0f}}, {MG, (Vector3){38.0f, 0.0f, -162.0f}},
-                               {MG, (Vector3){25.0f, 0.0f, -205.0f}}, {MG, (Vector3){2.0f, 0.0f, -207.0f}},
-                               {MG, (Vector3){-14.0f, 0.0f, -207.0f}}, {MG, (Vector3){-30.0f, 0.0f, -207.0f}},
-                               {MG, (Vector3){-30.0f, 0.0f, -220.0f}}, {MG, (Vector3){-11.0f, 0.0f, -224.0f}},
-                               {MG, (Vector3){11.0f, 0.0f, -224.0f}}, {MG, (Vector3){29.0f, 0.0f, -225.0f}},
-                               {MG, (Vector3){46.0f, 0.0f, -221.0f}}, {MG, (Vector3){63.0f, 0.0f, -221.0f}},
-                               {MG, (Vector3){64.0f, 0.0f, -205.0f}}, {MG, (Vector3){45.0f, 0.0f, -204.0f}},
-                               {MAINGUN, (Vector3){-11.0f, 0.0f, -134.0f}}, {MAINGUN, (Vector3){-30.0f, 0.0f, -217.0f}},
-                               {MAINGUN, (Vector3){-11.0f, 0.0f, -217.0f}}, {MAINGUN, (Vector3){13.0f, 0.0f, -219.0f}},
-                               {MAINGUN, (Vector3){-27.0f, 0.0f, -217.0f}}, {MAINGUN, (Vector3){-44.0f, 0.0f, -217.0f}},
-                               {MAINGUN, (Vector3){29.0f, 0.0f, -219.0f}}, {MAINGUN, (Vector3){26.0f, 0.0f, -168.0f}},};
-    
-    Pickup AllPickups[MaxNumberOfPickups];
+    //instance batches, one per model that is drawn many times a frame, they grow if a level needs more
+    InstanceBatch tankBulletBatch = LoadInstanceBatch(tankBullet, instancingShader, MaxPlayerTankBullets + MaxEnemyTankBullets + MaxNumberOfBattleShipTankBullets);
+    InstanceBatch MGBulletBatch = LoadInstanceBatch(MGBullet, instancingShader, MaxPlayerMGBullets + MaxEnemyMGBullets);
+    InstanceBatch BigBulletBatch = LoadInstanceBatch(BigBullet, instancingShader, MaxNumberOfSpecialBullets);
+    InstanceBatch enemyTankBatches[MaxModelLods], enemyAPCBatches[MaxModelLods];        //one per detail level
+    for(int i = 0; i < enemyTankLod.levelCount; i++) enemyTankBatches[i] = LoadInstanceBatch(enemyTankLod.levels[i], instancingShader, level.enemyTankCount);
+    for(int i = 0; i < enemyAPCLod.levelCount; i++) enemyAPCBatches[i] = LoadInstanceBatch(enemyAPCLod.levels[i], instancingShader, level.enemyAPCCount);
     
-    //initializing pickups
-    for(int i = 0; i < MaxNumberOfPickups; i++){
-        AllPickups[i].pickupType = pickupData[i].type;
-        AllPickups[i].pickupPos = pickupData[i].pos;
-        AllPickups[i].pickupYaw = 0;
-        if(AllPickups[i].pickupType == HEALTH) AllPickups[i].pickupModel = HealthPickup;
-        else if(AllPickups[i].pickupType == MAINGUN) AllPickups[i].pickupModel = MainGunPickup;
-        else AllPickups[i].pickupModel = MGPickup;
-        AllPickups[i].IsPickedUp = false;
-        AllPickups[i].pickupRotSpeed = 1;
-    }
+    //detail level each enemy and the battleship were last drawn at, for the hysteresis
+    unsigned char *enemyTankLods = (unsigned char *)calloc(level.enemyTankCount + 1, sizeof(unsigned char));
+    unsigned char *enemyAPCLods = (unsigned char *)calloc(level.enemyAPCCount + 1, sizeof(unsigned char));
+    unsigned char battleshipLodLevel = 0;
+    InstanceBatch HealthPickupBatch = LoadInstanceBatch(HealthPickup, instancingShader, level.pickupCount);
+    InstanceBatch MainGunPickupBatch = LoadInstanceBatch(MainGunPickup, instancingShader, level.pickupCount);
+    InstanceBatch MGPickupBatch = LoadInstanceBatch(MGPickup, instancingShader, level.pickupCount);
     
-    //player attributes
-    Vector3 playerPos = {0.0f, 0.0f, 0.0f};
-    int PlayerDamage = 45;
-    int PlayerMGDamage = 15;
-    int PlayerHealth = 150;
-    int CurrentPlayerHealth = 100;
-    int CurrentMainGunAmmo = 20;
-    int CurrentMGAmmo = 150;
-    
-    //positions for battleship guns
-    Vector3 BattleshipTankGunPositions[] = {(Vector3){-45.9f, 0.0f, 12.0f}, (Vector3){-36.2f, 0.0f, 12.0f},
-                                            (Vector3){-21.8f, 0.0f, 12.0f}, (Vector3){-14.8f, 0.0f, 12.0f},
-                                            (Vector3){-5.1f, 0.0f, 12.0f}, (Vector3){10.6f, 0.0f, 12.0f},
-                                            (Vector3){18.0f, 0.0f, 12.0f}, (Vector3){27.7f, 0.0f, 12.0f},
-                                            (Vector3){46.1f, 0.0f, 12.0f}, (Vector3){55.8f, 0.0f, 12.0f}};
-    Vector3 BattleshipSpecialGunPositions[] = {(Vector3){-40.3f, 0.0f, 15.0f}, (Vector3){-39.3f, 0.0f, 15.0f},
-                                               (Vector3){-9.0f, 0.0f, 15.0f}, (Vector3){-8.0f, 0.0f, 15.0f},
-                                               (Vector3){23.9f, 0.0f, 15.0f}, (Vector3){24.9f, 0.0f, 15.0f},
-                                               (Vector3){52.1f, 0.0f, 15.0f}, (Vector3){53.1f, 0.0f, 15.0f},};
-    
-    //stuff for camera following player tank
-    Vector3 camOffset = (Vector3){cam.position.x - playerPos.x, cam.position.y - playerPos.y, cam.position.z - playerPos.z};
-    
-    //stuff for controlling rate of fire of player's guns
-    float playerYaw = 180;
-    float playerTankGunTime = 0;
-    float playerMGTime = 0;
-    bool CanPlayerFireTank = true;
-    bool CanPlayerFireMG = true;
+    //buildings never move, they are baked into world space meshes in 64 unit chunks and rebaked when the level reloads
+    StaticBatch building1Batch = BakeStaticBatch(Building1, instancingShader, level.buildings, level.buildingCount, 64.0f);
+    
+    //bullet data, one batch per projectile type instead of one model per bullet
+    InstanceBatch *projectileBatches[PROJECTILE_TYPE_COUNT] = {&tankBulletBatch, &MGBulletBatch, &tankBulletBatch,
+                                                               &MGBulletBatch, &tankBulletBatch, &BigBulletBatch};
+    
+    //player, enemies, pickups, boss and bullets, everything SimStep updates
+    GameState *state = LoadGameState(&world);
+    
+    //a snapshot every simulated second, backspace rewinds to them
+    SnapshotRing rewind = LoadSnapshotRing(state, MaxRewindSnapshots);
+    
+    //stuff for camera following player tank, the camera's start position is its offset from the player
+    Vector3 camOffset = cam.position;
     
     DisableCursor();
     
-    //level related stuff
-    Vector3 Level_Pos = (Vector3){-31.0f, 0.0f, 0.0f};
-    Vector3 battleship_Pos = (Vector3){15.0f, 0.0f, -251.0f};
-    LevelModel.transform = MatrixRotateY(DEG2RAD * 180);
-    BattleShipModel.transform = MatrixRotateY(DEG2RAD * 180);
-    battleshipBox.min = Vector3Add(battleshipBox.min, battleship_Pos);
-    battleshipBox.max = Vector3Add(battleshipBox.max, battleship_Pos);
-    int CurrentBattleshipHealth = MaxBattleshipHealth;
-    bool CanBattleshipFire = true;
-    float battleshipFireTime = 0.0f;
+    //world space bounds of the level and battleship models for culling
+    BoundingBox levelCullBox = GetTransformedBoundingBox(GetModelBoundingBox(LevelModel), MatrixMultiply(LevelModel.transform, MatrixTranslate(level.levelModelPos.x, level.levelModelPos.y, level.levelModelPos.z)));
+    BoundingBox battleshipCullBox = GetTransformedBoundingBox(GetModelBoundingBox(BattleShipModel), MatrixMultiply(BattleShipModel.transform, MatrixTranslate(level.battleshipPos.x, level.battleshipPos.y, level.battleshipPos.z)));
+    bool ShowCullStats = false;
     
-    //gameScreen related stuff
-    bool ToRestartGame = false;
-    bool IsPlayerDead = false;
-    bool IsGameFinished = false;
+    //frame profiler, always timing in the windowed game, F3 shows the overlay
+    profiler.IsEnabled = true;
+    if(profileFileName != NULL) OpenProfilerCsv(profileFileName);
+    bool ShowProfiler = false;
+    
+    //session recording and playback
+    Replay recording = { 0 };
+    Replay replay = { 0 };
+    if(replayFileName != NULL) replay = LoadReplay(replayFileName);
+    int replayTick = 0;
+    
+    //the game advances in fixed steps however long frames take, frames draw between the last two steps
+    const float simDt = 1.0f/(float)simTickRate;
+    float simAccumulator = 0.0f;
+    unsigned int pendingButtons = 0;        //fire tank and restart presses not yet seen by a step
     
     // Main game loop
     while (!WindowShouldClose())    // Detect window close button or ESC key
     {
-        float dt = GetFrameTime();
+        BeginProfilePhase(PROFILE_FRAME);
+        float frameTime = GetFrameTime();
+        if(frameTime > MaxFrameTime) frameTime = MaxFrameTime;
+        simAccumulator += frameTime;
         // Update
         //----------------------------------------------------------------------------------
         UpdateCamera(&cam, CAMERA_FREE);
         
         // TODO: Update your variables here
         
-        //detect input and move player character if player isn't dead
-        if(!IsPlayerDead){
-            if(IsKeyDown(KEY_RIGHT)) playerYaw -= playerMoveSpeed * 10;
-            if(IsKeyDown(KEY_LEFT)) playerYaw += playerMoveSpeed * 10;
-            if(IsKeyDown(KEY_UP)) {
-                bool CanMove = true;
-                Vector3 checkingSphereDist = (Vector3){playerPos.x + sin(DEG2RAD * playerYaw) * 1, 0.0f, playerPos.z + cos(DEG2RAD * playerYaw) * 1};
-                for(int i = 0; i < HorizontalWallCount; i++){
-                    if(CheckCollisionBoxSphere(horizontalWalls[i], checkingSphereDist, 1)) CanMove = false;
-                }
-                for(int i = 0; i < VerticalWallCount; i++){
-                    if(CheckCollisionBoxSphere(verticalWalls[i], checkingSphereDist, 1)) CanMove = false;
-                }
-                for(int i = 0; i < Building1Count; i++){
-                    if(CheckCollisionBoxSphere(building1_BBs[i], checkingSphereDist, 1)) CanMove = false;
-                }
-                if(CheckCollisionBoxSphere(battleshipBox, checkingSphereDist, 1)) CanMove = false;
-                if(CanMove){
-                    playerPos.z += cos(DEG2RAD * playerYaw) * playerMoveSpeed;
-                    playerPos.x += sin(DEG2RAD * playerYaw) * playerMoveSpeed; 
+        //running as many steps as the elapsed time holds with this frame's input, or the next recorded ticks when playing back
+        //a press lands on the next step even if this frame runs none
+        InputFrame frameInput = GetInputFrame();
+        pendingButtons |= frameInput.buttons & (INPUT_FIRE_TANK | INPUT_RESTART);
+        frameInput.buttons &= ~(INPUT_FIRE_TANK | INPUT_RESTART);
+        while(true){
+            InputFrame input = frameInput;
+            float stepDt = simDt;
+            if(replayFileName != NULL){
+                if(replayTick >= replay.tickCount){
+                    simAccumulator = 0.0f;
+                    break;
                 }
+                input.buttons = replay.buttons[replayTick];
+                stepDt = replay.dt[replayTick];
             }
-            if(IsKeyDown(KEY_DOWN)) {
-                bool CanMove = true;
-                Vector3 checkingSphereDist = (Vector3){playerPos.x - sin(DEG2RAD * playerYaw) * 2, 0.0f, playerPos.z - cos(DEG2RAD * playerYaw) * 2};
-                for(int i = 0; i < HorizontalWallCount; i++){
-                    if(CheckCollisionBoxSphere(horizontalWalls[i], checkingSphereDist, 1)) CanMove = false;
-                }
-                for(int i = 0; i < VerticalWallCount; i++){
-                    if(CheckCollisionBoxSphere(verticalWalls[i], checkingSphereDist, 1)) CanMove = false;
-                }
-                for(int i = 0; i < Building1Count; i++){
-                    if(CheckCollisionBoxSphere(building1_BBs[i], checkingSphereDist, 1)) CanMove = false;
-                }
-                if(CanMove){
-                    playerPos.z -= cos(DEG2RAD * playerYaw) * playerMoveSpeed;
-                    playerPos.x -= sin(DEG2RAD * playerYaw) * playerMoveSpeed;  
-                }  
+            if(simAccumulator < stepDt) break;
+            simAccumulator -= stepDt;
+            
+            if(replayFileName != NULL) replayTick++;
+            else {
+                input.buttons |= pendingButtons;
+                pendingButtons = 0;
             }
+            if(recordFileName != NULL) RecordReplayTick(&recording, &input, stepDt);
+            SimStep(state, &input, stepDt);
+            if(state->tick%simTickRate == 0) PushSnapshotRing(&rewind, state);
+            if(replayFileName != NULL && replayTick == replay.tickCount) TraceLog(LOG_INFO, "REPLAY: Finished after %d ticks, checksum %08x", replayTick, GetGameStateChecksum(state));
+            
+            //playing the sounds each step asked for, heard from the player tank
+            PlaySoundEvents(&voices, state->soundEvents, state->soundEventCount, state->playerPos);
         }
+        UpdateVoiceManager(&voices);
         
-        //updating player stuff
-        cam.position = (Vector3) {camOffset.x + playerPos.x, camOffset.y + playerPos.y, camOffset.z + playerPos.z};
-        cam.target = playerPos;
-        playerTank.transform = MatrixRotateY(DEG2RAD * playerYaw);
-        
-        //updating rotation of all pickup items not picked up by player
-        for(int i = 0; i < MaxNumberOfPickups; i++){
-            if(!AllPickups[i].IsPickedUp){
-                AllPickups[i].pickupYaw += AllPickups[i].pickupRotSpeed;
-                AllPickups[i].pickupModel.transform = MatrixRotateY(DEG2RAD * AllPickups[i].pickupYaw);
-            }
-        }
-        
-        //checking enemy position and rotation and checking if enemy is dead and if player is in range
-        for(int i = 0; i < MaxNumberOfEnemyTanks; i++){
-            if(enemyTanks[i].IsEnemyAlive){
-                if(Vector3Distance(enemyTanks[i].enemyPos, playerPos) <= enemyTanks[i].enemyRange){
-                    enemyTanks[i].enemyDir = (Vector3){cos(DEG2RAD * enemyTanks[i].enemyYaw), 0.0f, sin(DEG2RAD * enemyTanks[i].enemyYaw)};
-                    Vector3 enemyToPlayerDir = (Vector3){playerPos.x - enemyTanks[i].enemyPos.x,
-                                                        playerPos.y - enemyTanks[i].enemyPos.y,
-                                                        playerPos.z - enemyTanks[i].enemyPos.z};
-                    float angleToRotate = -(atan2(enemyToPlayerDir.z,enemyToPlayerDir.x)) * 180.0f/3.14f + 90.0f;
-                    enemyTanks[i].enemyToPlayerAngle = angleToRotate;
-                    float angleError = angleToRotate - enemyTanks[i].enemyYaw;
-                    
-                    if(fabs(angleError) > 1){
-                        if(angleError > 1) enemyTanks[i].enemyYaw += 1;
-                        else if(angleError < 1) enemyTanks[i].enemyYaw -= 1;
-                    }else{
-                        //shoot at player tank
-                        if(enemyTanks[i].CanTankFire){
-                            for(int j = 0; j < MaxEnemyTankBullets; j++){
-                                if(!enemyTankBullets[j].IsBulletFired){
-                                    enemyTankBullets[i].bulletPos = (Vector3){enemyTanks[i].enemyPos.x,
-                                                                              enemyTanks[i].enemyPos.y + 0.5f,
-                                                                              enemyTanks[i].enemyPos.z};
-                                    enemyTankBullets[j].bulletYaw = enemyTanks[i].enemyYaw;
-                                    enemyTankBullets[j].bulletDir = enemyTanks[i].enemyDir;
-                                    enemyTankBullets[j].IsBulletFired = true;
-                                    enemyTanks[i].CanTankFire = false;
-                                    PlaySound(EnemyTankGunSound);
-                                }
-                            }
-                        }
-                    }
-                    
-                    enemyTanks[i].enemyModel.transform = MatrixRotateY(DEG2RAD * enemyTanks[i].enemyYaw * 3.0f);
-                }  
-                if(enemyTanks[i].enemyHealth <= 0){
-                    enemyTanks[i].IsEnemyAlive = false;
-                }    
-            }
-        } 
-        
-        //checking enemy APC position and rotation and checking if enemy APC is dead and if player is in range
-        for(int i = 0; i < MaxNumberOfEnemyAPCs; i++){
-            if(enemyAPCs[i].IsEnemyAlive){
-                if(Vector3Distance(enemyAPCs[i].enemyPos, playerPos) <= enemyAPCs[i].enemyRange){
-                    enemyAPCs[i].enemyDir = (Vector3){cos(DEG2RAD * enemyAPCs[i].enemyYaw), 0.0f, sin(DEG2RAD * enemyAPCs[i].enemyYaw)};
-                    Vector3 enemyToPlayerDir = (Vector3){playerPos.x - enemyAPCs[i].enemyPos.x,
-                                                        playerPos.y - enemyAPCs[i].enemyPos.y,
-                                                        playerPos.z - enemyAPCs[i].enemyPos.z};
-                    float angleToRotate = -(atan2(enemyToPlayerDir.z,enemyToPlayerDir.x)) * 180.0f/3.14f + 90.0f;
-                    enemyAPCs[i].enemyToPlayerAngle = angleToRotate;
-                    float angleError = angleToRotate - enemyAPCs[i].enemyYaw;
-                    
-                    if(fabs(angleError) > 1){
-                        if(angleError > 1) enemyAPCs[i].enemyYaw += 1;
-                        else if(angleError < 1) enemyAPCs[i].enemyYaw -= 1;
-                    }else{
-                        //shoot machine gun at player tank 
-                        if(enemyAPCs[i].CanTankFire){
-                            for(int j = 0; j < MaxEnemyMGBullets; j++){
-                                if(!enemyMGBullets[j].IsBulletFired){
-                                    enemyMGBullets[i].bulletPos = (Vector3){enemyAPCs[i].enemyPos.x,
-                                                                              enemyAPCs[i].enemyPos.y + 0.5f,
-                                                                              enemyAPCs[i].enemyPos.z};
-                                    enemyMGBullets[j].bulletYaw = enemyAPCs[i].enemyYaw;
-                                    enemyMGBullets[j].bulletDir = enemyAPCs[i].enemyDir;
-                                    enemyMGBullets[j].IsBulletFired = true;
-                                    enemyAPCs[i].CanTankFire = false;
-                                    PlaySound(PlayerMGSound);
-                                }
-                            }
-                        }
-                    }
-                    
-                    enemyAPCs[i].enemyModel.transform = MatrixRotateY(DEG2RAD * enemyAPCs[i].enemyYaw);
-                }  
-                if(enemyAPCs[i].enemyHealth <= 0){
-                    enemyAPCs[i].IsEnemyAlive = false;
-                }    
-            }
+        //every press goes back to an earlier second, recordings and playback would no longer line up with the steps so they can't rewind
+        if(IsKeyPressed(KEY_BACKSPACE) && replayFileName == NULL && recordFileName == NULL && PopSnapshotRing(&rewind, state)){
+            simAccumulator = 0.0f;
+            TraceLog(LOG_INFO, "REWIND: Back to tick %u", state->tick);
         }
         
-        //checking if battleship can fire
-        if(CurrentBattleshipHealth > 0){
-            //checking if player is close enough
-            if(Vector3Distance(playerPos, battleship_Pos) <= 60){
-                //display battleship health bar
-                //fire battleship's guns
-                if(CanBattleshipFire){
-                    for(int i = 0; i < 10; i++){
-                        for(int j = 0; j < MaxNumberOfBattleShipTankBullets; j++){
-                            if(!battleshipTankBullets[j].IsBulletFired){
-                                battleshipTankBullets[j].bulletPos = Vector3Add(BattleshipTankGunPositions[i], battleship_Pos);
-                                battleshipTankBullets[j].bulletYaw = 0;
-                                battleshipTankBullets[j].bulletDir = (Vector3){0.0f, 0.0f, 0.0f};
-                                battleshipTankBullets[j].IsBulletFired = true;
-                                break;
-                            }
-                        }
-                    }
-                    for(int i = 0; i < 8; i++){
-                        for(int j = 0; j < MaxNumberOfSpecialBullets; j++){
-                            if(!battleshipSpecialBullets[j].IsBulletFired){
-                                battleshipSpecialBullets[j].bulletPos = Vector3Add(BattleshipSpecialGunPositions[i], battleship_Pos);
-                                battleshipSpecialBullets[j].bulletYaw = 0;
-                                battleshipSpecialBullets[j].bulletDir = (Vector3){0.0f, 0.0f, 0.0f};
-                                battleshipSpecialBullets[j].IsBulletFired = true;
-                                break;
-                            }
-                        }
-                    }
-                    
-                    CanBattleshipFire = false;
-                }
-                
-                if(!CanBattleshipFire){
-                    battleshipFireTime += dt;
-                    
-                    if(battleshipFireTime >= BattleshipFireRate){
-                        battleshipFireTime = 0;
-                        CanBattleshipFire = true;
-                    }
-                }
-            }
-        }
+        //how far this frame is between the last two steps
+        float alpha = simAccumulator/simDt;
+        if(alpha > 1.0f) alpha = 1.0f;
         
-        //updating player tank bullet
-        for(int i = 0; i < MaxPlayerTankBullets; i++){
-            if(playerTankBullets[i].IsBulletFired){
-                playerTankBullets[i].bulletPos.z += cos(DEG2RAD * playerTankBullets[i].bulletYaw) * playerTankBullets[i].bulletSpeed;
-                playerTankBullets[i].bulletPos.x += sin(DEG2RAD * playerTankBullets[i].bulletYaw) * playerTankBullets[i].bulletSpeed;
-                playerTankBullets[i].bulletModel.transform = MatrixRotateY(DEG2RAD * playerTankBullets[i].bulletYaw);
-                if(Vector3Distance(playerPos, playerTankBullets[i].bulletPos) >= playerTankBullets[i].maxRange){
-                    playerTankBullets[i].IsBulletFired = false;
-                }
-            }
-        }
-        //updating player mg bullets
-        for(int i = 0; i < MaxPlayerMGBullets; i++){
-            if(playerMGBullets[i].IsBulletFired){
-                playerMGBullets[i].bulletPos.z += cos(DEG2RAD * playerMGBullets[i].bulletYaw) * playerMGBullets[i].bulletSpeed;
-                playerMGBullets[i].bulletPos.x += sin(DEG2RAD * playerMGBullets[i].bulletYaw) * playerMGBullets[i].bulletSpeed;
-                playerMGBullets[i].bulletModel.transform = MatrixRotateY(DEG2RAD * playerMGBullets[i].bulletYaw);
-                if(Vector3Distance(playerPos, playerMGBullets[i].bulletPos) >= playerMGBullets[i].maxRange){
-                    playerMGBullets[i].IsBulletFired = false;
-                }
-            }
-        }
-        //updating enemy bullets
-        for(int i = 0; i < MaxEnemyTankBullets; i++){
-            if(enemyTankBullets[i].IsBulletFired){
-                enemyTankBullets[i].bulletPos.z += cos(DEG2RAD * enemyTankBullets[i].bulletYaw) * enemyTankBullets[i].bulletSpeed;
-                enemyTankBullets[i].bulletPos.x += sin(DEG2RAD * enemyTankBullets[i].bulletYaw) * enemyTankBullets[i].bulletSpeed;
-                enemyTankBullets[i].bulletModel.transform = MatrixRotateY(DEG2RAD * enemyTankBullets[i].bulletYaw);
-                if(Vector3Distance(playerPos, enemyTankBullets[i].bulletPos) >= enemyTankBullets[i].maxRange){
-                    enemyTankBullets[i].IsBulletFired = false;
-                }
-            }
-        }
+        //updating player stuff
+        Vector3 drawPlayerPos = Vector3Lerp(state->prevPlayerPos, state->playerPos, alpha);
+        cam.position = (Vector3) {camOffset.x + drawPlayerPos.x, camOffset.y + drawPlayerPos.y, camOffset.z + drawPlayerPos.z};
+        cam.target = drawPlayerPos;
+        playerTank.transform = MatrixRotateY(DEG2RAD * Lerp(state->prevPlayerYaw, state->playerYaw, alpha));
         
-        //updating enemy MG bullets
-        for(int i = 0; i < MaxEnemyMGBullets; i++){
-            if(enemyMGBullets[i].IsBulletFired){
-                enemyMGBullets[i].bulletPos.z += cos(DEG2RAD * enemyMGBullets[i].bulletYaw) * enemyMGBullets[i].bulletSpeed;
-                enemyMGBullets[i].bulletPos.x += sin(DEG2RAD * enemyMGBullets[i].bulletYaw) * enemyMGBullets[i].bulletSpeed;
-                enemyMGBullets[i].bulletModel.transform = MatrixRotateY(DEG2RAD * enemyMGBullets[i].bulletYaw);
-                if(Vector3Distance(playerPos, enemyMGBullets[i].bulletPos) >= enemyMGBullets[i].maxRange){
-                    enemyMGBullets[i].IsBulletFired = false;
-                }
+        //hot swapping the level from disk, the match restarts on the new map and the old one stays if loading fails
+        if(IsKeyPressed(KEY_F5)){
+            Level reloadedLevel = LoadLevel(levelFileName);
+            if(reloadedLevel.data != NULL){
+                UnloadGameState(state);
+                UnloadSnapshotRing(rewind);
+                UnloadWorld(&world);
+                UnloadLevel(level);
+                level = reloadedLevel;
+                InitWorld(&world, &level, verticalWallBounds, horizontalWallBounds, building1Bounds, &battleshipBvh);
+                state = LoadGameState(&world);
+                rewind = LoadSnapshotRing(state, MaxRewindSnapshots);
+                UnloadStaticBatch(building1Batch);
+                building1Batch = BakeStaticBatch(Building1, instancingShader, level.buildings, level.buildingCount, 64.0f);
+                free(enemyTankLods);
+                free(enemyAPCLods);
+                enemyTankLods = (unsigned char *)calloc(level.enemyTankCount + 1, sizeof(unsigned char));
+                enemyAPCLods = (unsigned char *)calloc(level.enemyAPCCount + 1, sizeof(unsigned char));
+                levelCullBox = GetTransformedBoundingBox(GetModelBoundingBox(LevelModel), MatrixMultiply(LevelModel.transform, MatrixTranslate(level.levelModelPos.x, level.levelModelPos.y, level.levelModelPos.z)));
+                battleshipCullBox = GetTransformedBoundingBox(GetModelBoundingBox(BattleShipModel), MatrixMultiply(BattleShipModel.transform, MatrixTranslate(level.battleshipPos.x, level.battleshipPos.y, level.battleshipPos.z)));
             }
         }
+        //----------------------------------------------------------------------------------
+
+        // Draw
+        //----------------------------------------------------------------------------------
+        BeginProfilePhase(PROFILE_DRAW);
+        BeginDrawing();
+
+        ClearBackground(DARKGRAY);
         
-        //updating battleship tank bullets
-        for(int i = 0; i < MaxNumberOfBattleShipTankBullets; i++){
-            if(battleshipTankBullets[i].IsBulletFired){
-                battleshipTankBullets[i].bulletPos.z += cos(DEG2RAD * battleshipTankBullets[i].bulletYaw) * battleshipTankBullets[i].bulletSpeed;
-                battleshipTankBullets[i].bulletPos.x += sin(DEG2RAD * battleshipTankBullets[i].bulletYaw) * battleshipTankBullets[i].bulletSpeed;
-                battleshipTankBullets[i].bulletModel.transform = MatrixRotateY(DEG2RAD * battleshipTankBullets[i].bulletYaw);
-                if(Vector3Distance(playerPos, battleshipTankBullets[i].bulletPos) >= battleshipTankBullets[i].maxRange){
-                    battleshipTankBullets[i].IsBulletFired = false;
-                }
-            }
-        }
+        //view volume of the chase camera, everything below is tested against it before being queued
+        Frustum frustum = GetCameraFrustum(cam, (float)GetScreenWidth()/(float)GetScreenHeight(), ViewDistance);
+
+        BeginMode3D(cam);
+        //DrawGrid(32, 1);
         
-        //updating battleship special bullets
-        for(int i = 0; i < MaxNumberOfSpecialBullets; i++){
-            if(battleshipSpecialBullets[i].IsBulletFired){
-                battleshipSpecialBullets[i].bulletPos.z += cos(DEG2RAD * battleshipSpecialBullets[i].bulletYaw) * battleshipSpecialBullets[i].bulletSpeed;
-                battleshipSpecialBullets[i].bulletPos.x += sin(DEG2RAD * battleshipSpecialBullets[i].bulletYaw) * battleshipSpecialBullets[i].bulletSpeed;
-                battleshipSpecialBullets[i].bulletModel.transform = MatrixRotateY(DEG2RAD * battleshipSpecialBullets[i].bulletYaw);
-                if(Vector3Distance(playerPos, battleshipSpecialBullets[i].bulletPos) >= battleshipSpecialBullets[i].maxRange){
-                    battleshipSpecialBullets[i].IsBulletFired = false;
-                }
-            }
-        }
+        //drawing player tank
+        DrawModel(playerTank, drawPlayerPos, 1.0f, WHITE);
         
-        //checking if player bullets hit enemy
-        for(int i = 0; i < MaxNumberOfEnemyTanks; i++){
-            if(enemyTanks[i].IsEnemyAlive){
-                for(int j = 0; j < MaxPlayerTankBullets; j++){
-                    if(playerTankBullets[j].IsBulletFired){
-                        if(CheckCollisionSpheres(playerTankBullets[j].bulletPos, 1, enemyTanks[i].enemyPos, 3)){
-                            PlaySound(EnemyHitSound);
-                            enemyTanks[i].enemyHealth -= PlayerDamage;
-                            playerTankBullets[j].IsBulletFired = false;
-                            
-                            if(enemyTanks[i].enemyHealth <= 0){
-                                enemyTanks[i].IsEnemyAlive = false;
-                                PlaySound(EnemyDieSound);
-                            }
-                        }
-                    }
-                }//checking if player MG hits enemy tank
-                for(int j = 0; j < MaxPlayerMGBullets; j++){
-                    if(playerMGBullets[j].IsBulletFired){
-                        if(CheckCollisionSpheres(playerMGBullets[j].bulletPos, 1, enemyTanks[i].enemyPos, 3)){
-                            PlaySound(EnemyHitSound);
-                            enemyTanks[i].enemyHealth -= PlayerMGDamage;
-                            playerMGBullets[j].IsBulletFired = false;
-                            
-                            if(enemyTanks[i].enemyHealth <= 0){
-                                enemyTanks[i].IsEnemyAlive = false;
-                                PlaySound(EnemyDieSound);
-                            }
-                        }
-                    }
-                }
-            }
+        //collecting all fired bullets into their type's batch
+        for(int k = 0; k < state->projectiles.liveCount; k++){
+            int i = state->projectiles.live[k];
+            Vector3 bulletPos = Vector3Lerp(GetProjectileStartPosition(&state->projectiles, i), GetProjectilePosition(&state->projectiles, i), alpha);
+            AddVisibleInstance(projectileBatches[state->projectiles.type[i]], &frustum, MatrixMultiply(MatrixRotateY(DEG2RAD * state->projectiles.yaw[i]), MatrixTranslate(bulletPos.x, bulletPos.y, bulletPos.z)));
         }
         
-        //checking if player hits the battleship
-        for(int i = 0; i < MaxPlayerTankBullets; i++){
-            if(playerTankBullets[i].IsBulletFired){
-                if(CheckCollisionBoxSphere(battleshipBox, playerTankBullets[i].bulletPos,1)){
-                    PlaySound(EnemyHitSound);
-                    CurrentBattleshipHealth -= PlayerDamage;
-                    playerTankBullets[i].IsBulletFired = false;
-                    break;
-                }
-            }
+        //collecting enemy tanks
+        for(int i = 0; i < state->enemyTankCount; i++){
+            Vector3 drawPos = Vector3Lerp(state->enemyTanks[i].enemyPrevPos, state->enemyTanks[i].enemyPos, alpha);
+            if(state->enemyTanks[i].IsEnemyAlive) AddVisibleLodInstance(enemyTankBatches, &enemyTankLod, &enemyTankLods[i], &frustum, cam, MatrixMultiply(MatrixRotateY(DEG2RAD * Lerp(state->enemyTanks[i].enemyPrevModelYaw, state->enemyTanks[i].enemyModelYaw, alpha)), MatrixTranslate(drawPos.x, drawPos.y, drawPos.z)));
         }
         
-        //checking if player mg hits the battleship
-        for(int i = 0; i < MaxPlayerMGBullets; i++){
-            if(playerMGBullets[i].IsBulletFired){
-                    if(CheckCollisionBoxSphere(battleshipBox, playerMGBullets[i].bulletPos,1)){
-                        PlaySound(EnemyHitSound);
-                        CurrentBattleshipHealth -= PlayerMGDamage;
-                        playerMGBullets[i].IsBulletFired = false;
-                        break;
-                }
-            }
+        //collecting enemy APCs
+        for(int i = 0; i < state->enemyAPCCount; i++){
+            Vector3 drawPos = Vector3Lerp(state->enemyAPCs[i].enemyPrevPos, state->enemyAPCs[i].enemyPos, alpha);
+            if(state->enemyAPCs[i].IsEnemyAlive) AddVisibleLodInstance(enemyAPCBatches, &enemyAPCLod, &enemyAPCLods[i], &frustum, cam, MatrixMultiply(MatrixRotateY(DEG2RAD * Lerp(state->enemyAPCs[i].enemyPrevModelYaw, state->enemyAPCs[i].enemyModelYaw, alpha)), MatrixTranslate(drawPos.x, drawPos.y, drawPos.z)));
         }
         
-        //checking if player bullets hit enemy APC
-        for(int i = 0; i < MaxNumberOfEnemyAPCs; i++){
-            if(enemyAPCs[i].IsEnemyAlive){
-                for(int j = 0; j < MaxPlayerTankBullets; j++){
-                    if(playerTankBullets[j].IsBulletFired){
-                        if(CheckCollisionSpheres(playerTankBullets[j].bulletPos, 1, enemyAPCs[i].enemyPos, 3)){
-                            PlaySound(EnemyHitSound);
-                            enemyAPCs[i].enemyHealth -= PlayerDamage;
-                            playerTankBullets[j].IsBulletFired = false;
-                            
-                            if(enemyAPCs[i].enemyHealth <= 0){
-                                enemyAPCs[i].IsEnemyAlive = false;
-                                PlaySound(EnemyDieSound);
-                            }
-                        }
-                    }
-                }//checking if player MG hits enemy APC
-                for(int j = 0; j < MaxPlayerMGBullets; j++){
-                    if(playerMGBullets[j].IsBulletFired){
-                        if(CheckCollisionSpheres(playerMGBullets[j].bulletPos, 1, enemyAPCs[i].enemyPos, 3)){
-                            PlaySound(EnemyHitSound);
-                            enemyAPCs[i].enemyHealth -= PlayerMGDamage;
-                            playerMGBullets[j].IsBulletFired = false;
-                            
-                            if(enemyAPCs[i].enemyHealth <= 0){
-                                enemyAPCs[i].IsEnemyAlive = false;
-                                PlaySound(EnemyDieSound);
-                            }
-                        }
-                    }
-                }
+        //collecting pickups, drawn at scale 2
+        for(int i =0; i < state->pickupCount; i++){
+            if(!state->AllPickups[i].IsPickedUp){
+                Matrix pickupRotation = MatrixRotateY(DEG2RAD * Lerp(state->AllPickups[i].pickupPrevYaw, state->AllPickups[i].pickupYaw, alpha));
+                Matrix pickupTransform = MatrixMultiply(MatrixMultiply(pickupRotation, MatrixScale(2, 2, 2)),
+                                                        MatrixTranslate(state->AllPickups[i].pickupPos.x, state->AllPickups[i].pickupPos.y, state->AllPickups[i].pickupPos.z));
+                if(state->AllPickups[i].pickupType == HEALTH) AddVisibleInstance(&HealthPickupBatch, &frustum, pickupTransform);
+                else if(state->AllPickups[i].pickupType == MAINGUN) AddVisibleInstance(&MainGunPickupBatch, &frustum, pickupTransform);
+                else AddVisibleInstance(&MGPickupBatch, &frustum, pickupTransform);
             }
         }
         
-        //check if battleship bullets hit the player
-        for(int i = 0; i < MaxNumberOfBattleShipTankBullets; i++){
-            if(battleshipTankBullets[i].IsBulletFired){
-                if(CheckCollisionSpheres(playerPos, 2, battleshipTankBullets[i].bulletPos, 1)){
-                    CurrentPlayerHealth -= enemyTanks[0].enemyDamage;
-                    battleshipTankBullets[i].IsBulletFired = false;
-                }
+        //drawing every batch with one instanced draw call per mesh
+        DrawInstanceBatch(&tankBulletBatch);
+        DrawInstanceBatch(&MGBulletBatch);
+        DrawInstanceBatch(&BigBulletBatch);
+        for(int i = 0; i < enemyTankLod.levelCount; i++) DrawInstanceBatch(&enemyTankBatches[i]);
+        for(int i = 0; i < enemyAPCLod.levelCount; i++) DrawInstanceBatch(&enemyAPCBatches[i]);
+        DrawInstanceBatch(&HealthPickupBatch);
+        DrawInstanceBatch(&MainGunPickupBatch);
+        DrawInstanceBatch(&MGPickupBatch);
+        
+        //drawing the baked buildings, one draw call per visible chunk
+        DrawStaticBatch(&building1Batch, &frustum);
+        
+        //drawing transparent pickup halos after the opaque batches
+        for(int i =0; i < state->pickupCount; i++){
+            if(!state->AllPickups[i].IsPickedUp) {
+                Vector3 spherePos = Vector3Add(state->AllPickups[i].pickupPos, (Vector3){0.0f, 0.5f, 0.0f});
+                if(!IsSphereInFrustum(&frustum, spherePos, 1.0f)) continue;
+                if(state->AllPickups[i].pickupType == HEALTH) DrawSphere(spherePos, 1.0f, (Color){255, 0, 0, 50});
+                else if(state->AllPickups[i].pickupType == MG) DrawSphere(spherePos, 1.0f, (Color){255, 203, 0, 50});
+                else DrawSphere(spherePos, 1.0f, (Color){255, 255, 255, 50});
             }
         }
         
-        //check if battleship special bullets hit the player
-        for(int i = 0; i < MaxNumberOfSpecialBullets; i++){
-            if(battleshipSpecialBullets[i].IsBulletFired){
-                if(CheckCollisionSpheres(playerPos, 2, battleshipSpecialBullets[i].bulletPos, 1)){
-                    CurrentPlayerHealth -= SpecialBulletDamage;
-                    battleshipSpecialBullets[i].IsBulletFired = false;
-                }
-            }
+        /*//boundary test
+        for(int i = 0; i < world.staticGrid.boxCount; i++){
+            DrawBoundingBox(world.staticGrid.boxes[i], DARKGRAY);
+        }*/
+        
+        //drawing level
+        if(IsBoxInFrustum(&frustum, levelCullBox)) DrawModel(LevelModel, level.levelModelPos, 1.0f, WHITE);
+        if(IsBoxInFrustum(&frustum, battleshipCullBox)){
+            Vector3 battleshipCenter = Vector3Scale(Vector3Add(battleshipCullBox.min, battleshipCullBox.max), 0.5f);
+            float battleshipSize = GetProjectedSize(cam, battleshipCenter, Vector3Distance(battleshipCullBox.min, battleshipCullBox.max)*0.5f);
+            battleshipLodLevel = (unsigned char)SelectModelLod(&battleshipLod, battleshipLodLevel, battleshipSize);
+            DrawModel(battleshipLod.levels[battleshipLodLevel], level.battleshipPos, 1, WHITE);
         }
         
-        //check if player and enemy bullet hits walls
-        for(int i = 0; i < HorizontalWallCount; i++){
-            //checking for horizontal walls
-            for(int j = 0; j < MaxPlayerTankBullets; j++){
-                if(playerTankBullets[j].IsBulletFired){
-                    if(CheckCollisionBoxSphere(horizontalWalls[i], playerTankBullets[j].bulletPos, 1)){
-                        //play wall hit sound
-                        playerTankBullets[j].IsBulletFired = false;
-                    }
-                }
-            }
-            for(int j = 0; j < MaxPlayerMGBullets; j++){
-                if(playerMGBullets[j].IsBulletFired){
-                    if(CheckCollisionBoxSphere(horizontalWalls[i], playerMGBullets[j].bulletPos, 1)){
-                        //play wall hit sound
-                        playerMGBullets[j].IsBulletFired = false;
-                    }
-                }
-            }
-            
-            for(int j = 0; j < MaxEnemyTankBullets; j++){
-                if(enemyTankBullets[j].IsBulletFired){
-                    if(CheckCollisionBoxSphere(horizontalWalls[i], enemyTankBullets[j].bulletPos, 1)){
-                        //play wall hit sound
-                        enemyTankBullets[j].IsBulletFired = false;
-                    }
-                }
-            }
-            
-            for(int j = 0; j < MaxEnemyMGBullets; j++){
-                if(enemyMGBullets[j].IsBulletFired){
-                    if(CheckCollisionBoxSphere(horizontalWalls[i], enemyMGBullets[j].bulletPos, 1)){
-                        //play wall hit sound
-                        enemyMGBullets[j].IsBulletFired = false;
-                    }
-                }
-            }
+        EndMode3D();
+        DrawTextureEx(healthIcon_tex, (Vector2){25, GetScreenHeight()-100}, 0, 0.1375f, WHITE);
+        DrawTextureEx(MainGunIcon_tex, (Vector2){25, GetScreenHeight()-230}, 0, 0.1375f, WHITE);
+        DrawTextureEx(MGIcon_tex, (Vector2){25, GetScreenHeight()-360}, 0, 0.1375f, WHITE);
+        DrawText(TextFormat("%d", state->CurrentPlayerHealth), 200, GetScreenHeight() - 100, 100, RAYWHITE);
+        DrawText(TextFormat("%d", state->CurrentMainGunAmmo), 200, GetScreenHeight() - 230, 100, RAYWHITE);
+        DrawText(TextFormat("%d", state->CurrentMGAmmo), 200, GetScreenHeight() - 360, 100, RAYWHITE);
+        
+        if(state->IsPlayerDead){
+            DrawText("Game Over!", (int)GetScreenWidth()/2 - 400, (int)GetScreenHeight()/2 - 300, 200, RAYWHITE);
+            DrawText("Press R to restart game", (int)GetScreenWidth()/2 - 300, (int)GetScreenHeight()/2, 50, RAYWHITE);
+            DrawText("Press ESC to quit game", (int)GetScreenWidth()/2 - 300, (int)GetScreenHeight()/2 + 100, 50, RAYWHITE);
+        }
+        if(!state->IsPlayerDead && !state->IsGameFinished){
+            DrawText("Destroy All Enemies", (int)GetScreenWidth()/2 - 300, 100, 50, RAYWHITE);
             
-            //checking for battleship bullets hitting walls
-            for(int j = 0; j < MaxNumberOfBattleShipTankBullets; j++){
-                if(battleshipTankBullets[j].IsBulletFired){
-                    if(CheckCollisionBoxSphere(horizontalWalls[i], battleshipTankBullets[j].bulletPos, 1)){
-                        //play wall hit sound
-                        battleshipTankBullets[j].IsBulletFired = false;
-                    }
-                }
+            if(Vector3Distance(state->playerPos, level.battleshipPos) <= 100){
+                DrawText("STRANDED LAND BATTLESHIP",(int)GetScreenWidth()/2 - 400, 200, 50, WHITE);
+                DrawRectangle((int)GetScreenWidth()/2 - 400, 275, 800, 50, WHITE);
+                DrawRectangle((int)GetScreenWidth()/2 - 400, 275, (state->CurrentBattleshipHealth/MaxBattleshipHealth * 800), 50, RED);
             }
             
-            for(int j = 0; j < MaxNumberOfSpecialBullets; j++){
-                if(battleshipSpecialBullets[j].IsBulletFired){
-                    if(CheckCollisionBoxSphere(horizontalWalls[i], battleshipSpecialBullets[j].bulletPos, 1)){
-                        //play wall hit sound
-                        battleshipSpecialBullets[j].IsBulletFired = false;
-                    }
-                }
-            }
+            DrawText("Controls:", 25, 10, 20, RAYWHITE);
+            DrawText("Arrow Up/Arrow Down - Move Forward/Backward", 25, 40, 20, RAYWHITE);
+            DrawText("Arrow Right/Arrow Left - Turn Right/Left", 25, 60, 20, RAYWHITE);
+            DrawText("Spacebar - Fire Tank Gun", 25, 80, 20, RAYWHITE);
+            DrawText("Left Alt - Fire Machine Gun", 25, 100, 20, RAYWHITE);
         }
         
-        //checking if player and enemy bullets hit vertical walls
-        for(int i = 0; i < VerticalWallCount; i++){
-            //checking for horizontal walls
-            for(int j = 0; j < MaxPlayerTankBullets; j++){
-                if(playerTankBullets[j].IsBulletFired){
-                    if(CheckCollisionBoxSphere(verticalWalls[i], playerTankBullets[j].bulletPos, 1)){
-                        //play wall hit sound
-                        playerTankBullets[j].IsBulletFired = false;
-                    }
-                }
-            }
-            for(int j = 0; j < MaxPlayerMGBullets; j++){
-                if(playerMGBullets[j].IsBulletFired){
-                    if(CheckCollisionBoxSphere(verticalWalls[i], playerMGBullets[j].bulletPos, 1)){
-                        //play wall hit sound
-                        playerMGBullets[j].IsBulletFired = false;
-                    }
-                }
-            }
-            
-            for(int j = 0; j < MaxEnemyTankBullets; j++){
-                if(enemyTankBullets[j].IsBulletFired){
-                    if(CheckCollisionBoxSphere(verticalWalls[i], enemyTankBullets[j].bulletPos, 1)){
-                        //play wall hit sound
-                        enemyTankBullets[j].IsBulletFired = false;
-                    }
-                }
-            }
-            
-            for(int j = 0; j < MaxEnemyMGBullets; j++){
-                if(enemyMGBullets[j].IsBulletFired){
-                    if(CheckCollisionBoxSphere(verticalWalls[i], enemyMGBullets[j].bulletPos, 1)){
-                        //play wall hit sound
-                        enemyMGBullets[j].IsBulletFired = false;
-                    }
-                }
-            }
-            
-            //checking for battleship bullets hitting walls
-            for(int j = 0; j < MaxNumberOfBattleShipTankBullets; j++){
-                if(battleshipTankBullets[j].IsBulletFired){
-                    if(CheckCollisionBoxSphere(horizontalWalls[i], battleshipTankBullets[j].bulletPos, 1)){
-                        //play wall hit sound
-                        battleshipTankBullets[j].IsBulletFired = false;
-                    }
-                }
-            }
+        //draw game finish screen
+        if(state->IsGameFinished){
+            DrawText("You won!", (int)GetScreenWidth()/2 - 400, (int)GetScreenHeight()/2 - 300, 200, RAYWHITE);
+            DrawText("Press R to restart game", (int)GetScreenWidth()/2 - 300, (int)GetScreenHeight()/2, 50, RAYWHITE);
+            DrawText("Press ESC to quit game", (int)GetScreenWidth()/2 - 300, (int)GetScreenHeight()/2 + 100, 50, RAYWHITE);
+        }
+        
+        DrawFPS(10, 10);
+        if(IsKeyPressed(KEY_F2)) ShowCullStats = !ShowCullStats;
+        if(ShowCullStats) DrawText(TextFormat("Culling: %d visible / %d tested", frustum.visible, frustum.tested), 10, 130, 20, LIME);
+        EndProfilePhase(PROFILE_DRAW);
+        if(IsKeyPressed(KEY_F3)) ShowProfiler = !ShowProfiler;
+        if(ShowProfiler) DrawProfilerOverlay(GetScreenWidth() - 460, 20);
+        EndDrawing();
+        EndProfilePhase(PROFILE_FRAME);
+        EndProfilerFrame();
+        //----------------------------------------------------------------------------------
+    }
+
+    // De-Initialization
+    //--------------------------------------------------------------------------------------
+    ShutdownJobSystem(&jobs);
+    UnloadVoiceManager(&voices);
+    UnloadResources(&resources);
+    
+    UnloadImage(GameIcon);
+    
+    if(recordFileName != NULL){
+        if(SaveReplay(&recording, recordFileName)) TraceLog(LOG_INFO, "REPLAY: [%s] Saved %d ticks", recordFileName, recording.tickCount);
+    }
+    UnloadReplay(recording);
+    UnloadReplay(replay);
+    CloseProfilerCsv();
+    
+    UnloadGameState(state);
+    UnloadSnapshotRing(rewind);
+    UnloadWorld(&world);
+    UnloadTriangleBvh(battleshipBvh);
+    UnloadLevel(level);
+    UnloadInstanceBatch(tankBulletBatch);
+    UnloadInstanceBatch(MGBulletBatch);
+    UnloadInstanceBatch(BigBulletBatch);
+    for(int i = 0; i < enemyTankLod.levelCount; i++) UnloadInstanceBatch(enemyTankBatches[i]);
+    for(int i = 0; i < enemyAPCLod.levelCount; i++) UnloadInstanceBatch(enemyAPCBatches[i]);
+    UnloadModelLod(enemyTankLod);
+    UnloadModelLod(enemyAPCLod);
+    UnloadModelLod(battleshipLod);
+    free(enemyTankLods);
+    free(enemyAPCLods);
+    UnloadInstanceBatch(HealthPickupBatch);
+    UnloadInstanceBatch(MainGunPickupBatch);
+    UnloadInstanceBatch(MGPickupBatch);
+    UnloadStaticBatch(building1Batch);
+    UnloadShader(instancingShader);
+    CloseAudioDevice();
+    CloseWindow();        // Close window and OpenGL context
+    //--------------------------------------------------------------------------------------
+
+    return 0;
+}
+
+//----------------------------------------------------------------------------------
+// Module Functions Definition
+//----------------------------------------------------------------------------------
+//buckets every box into each XZ cell it overlaps (counting pass, prefix sum, fill pass)
+static StaticGrid LoadStaticGrid(const BoundingBox *boxes, int boxCount, float cellSize)
+{
+    StaticGrid grid = {0};
+    grid.cellSize = cellSize;
+    grid.boxCount = boxCount;
+    if(boxCount <= 0) return grid;
+    
+    grid.boxes = (BoundingBox *)malloc(boxCount * sizeof(BoundingBox));
+    float minX = boxes[0].min.x, minZ = boxes[0].min.z, maxX = boxes[0].max.x, maxZ = boxes[0].max.z;
+    for(int i = 0; i < boxCount; i++){
+        grid.boxes[i] = boxes[i];
+        if(boxes[i].min.x < minX) minX = boxes[i].min.x;
+        if(boxes[i].min.z < minZ) minZ = boxes[i].min.z;
+        if(boxes[i].max.x > maxX) maxX = boxes[i].max.x;
+        if(boxes[i].max.z > maxZ) maxZ = boxes[i].max.z;
+    }
+    grid.originX = minX;
+    grid.originZ = minZ;
+    grid.cellsX = (int)((maxX - minX) / cellSize) + 1;
+    grid.cellsZ = (int)((maxZ - minZ) / cellSize) + 1;
+    
+    int cellCount = grid.cellsX * grid.cellsZ;
+    grid.cellStart = (int *)calloc(cellCount + 1, sizeof(int));
+    
+    //counting how many boxes land in each cell
+    for(int i = 0; i < boxCount; i++){
+        int x0 = (int)((boxes[i].min.x - minX) / cellSize), x1 = (int)((boxes[i].max.x - minX) / cellSize);
+        int z0 = (int)((boxes[i].min.z - minZ) / cellSize), z1 = (int)((boxes[i].max.z - minZ) / cellSize);
+        for(int z = z0; z <= z1; z++){
+            for(int x = x0; x <= x1; x++) grid.cellStart[z * grid.cellsX + x + 1]++;
+        }
+    }
+    for(int c = 0; c < cellCount; c++) grid.cellStart[c + 1] += grid.cellStart[c];
+    
+    //filling cells, using a scratch cursor per cell
+    grid.cellItems = (int *)malloc((grid.cellStart[cellCount] > 0 ? grid.cellStart[cellCount] : 1) * sizeof(int));
+    int *cursor = (int *)malloc(cellCount * sizeof(int));
+    for(int c = 0; c < cellCount; c++) cursor[c] = grid.cellStart[c];
+    for(int i = 0; i < boxCount; i++){
+        int x0 = (int)((boxes[i].min.x - minX) / cellSize), x1 = (int)((boxes[i].max.x - minX) / cellSize);
+        int z0 = (int)((boxes[i].min.z - minZ) / cellSize), z1 = (int)((boxes[i].max.z - minZ) / cellSize);
+        for(int z = z0; z <= z1; z++){
+            for(int x = x0; x <= x1; x++) grid.cellItems[cursor[z * grid.cellsX + x]++] = i;
+        }
+    }
+    free(cursor);
+    
+    //copying bounds into cell order
+    int itemCount = (grid.cellStart[cellCount] > 0 ? grid.cellStart[cellCount] : 1);
+    grid.itemMinX = (float *)malloc(itemCount * sizeof(float));
+    grid.itemMinY = (float *)malloc(itemCount * sizeof(float));
+    grid.itemMinZ = (float *)malloc(itemCount * sizeof(float));
+    grid.itemMaxX = (float *)malloc(itemCount * sizeof(float));
+    grid.itemMaxY = (float *)malloc(itemCount * sizeof(float));
+    grid.itemMaxZ = (float *)malloc(itemCount * sizeof(float));
+    for(int k = 0; k < grid.cellStart[cellCount]; k++){
+        BoundingBox box = boxes[grid.cellItems[k]];
+        grid.itemMinX[k] = box.min.x;
+        grid.itemMinY[k] = box.min.y;
+        grid.itemMinZ[k] = box.min.z;
+        grid.itemMaxX[k] = box.max.x;
+        grid.itemMaxY[k] = box.max.y;
+        grid.itemMaxZ[k] = box.max.z;
+    }
+    
+    return grid;
+}
+
+static void UnloadStaticGrid(StaticGrid grid)
+{
+    free(grid.boxes);
+    free(grid.cellStart);
+    free(grid.cellItems);
+    free(grid.itemMinX);
+    free(grid.itemMinY);
+    free(grid.itemMinZ);
+    free(grid.itemMaxX);
+    free(grid.itemMaxY);
+    free(grid.itemMaxZ);
+}
+
+//range of grid cells a sphere's XZ footprint overlaps, false when it is outside the grid
+static bool GetStaticGridCellRange(const StaticGrid *grid, Vector3 center, float radius, int *x0, int *x1, int *z0, int *z1)
+{
+    if(grid->boxCount <= 0) return false;
+    
+    *x0 = (int)floorf((center.x - radius - grid->originX) / grid->cellSize);
+    *x1 = (int)floorf((center.x + radius - grid->originX) / grid->cellSize);
+    *z0 = (int)floorf((center.z - radius - grid->originZ) / grid->cellSize);
+    *z1 = (int)floorf((center.z + radius - grid->originZ) / grid->cellSize);
+    if(*x1 < 0 || *z1 < 0 || *x0 >= grid->cellsX || *z0 >= grid->cellsZ) return false;
+    if(*x0 < 0) *x0 = 0;
+    if(*z0 < 0) *z0 = 0;
+    if(*x1 >= grid->cellsX) *x1 = grid->cellsX - 1;
+    if(*z1 >= grid->cellsZ) *z1 = grid->cellsZ - 1;
+    return true;
+}
+
+//tests a sphere only against the boxes stored in the cells its XZ footprint overlaps
+static bool CheckCollisionStaticGridSphere(const StaticGrid *grid, Vector3 center, float radius)
+{
+    int x0, x1, z0, z1;
+    if(!GetStaticGridCellRange(grid, center, radius, &x0, &x1, &z0, &z1)) return false;
+    
+    for(int z = z0; z <= z1; z++){
+        for(int x = x0; x <= x1; x++){
+            int cell = z * grid->cellsX + x;
+            int first = grid->cellStart[cell];
+            int count = grid->cellStart[cell + 1] - first;
+            if(CheckCollisionBoxesSphereBatch(grid->itemMinX + first, grid->itemMinY + first, grid->itemMinZ + first,
+                                              grid->itemMaxX + first, grid->itemMaxY + first, grid->itemMaxZ + first, count, center, radius) >= 0) return true;
+        }
+    }
+    
+    return false;
+}
+
+//earliest fraction of the segment start->end at which a sphere moving along it touches a static box, -1 if it touches none
+//boxes are picked with the batch test against the sphere around the whole path, then swept one by one
+static float GetStaticGridSweptHitTime(const StaticGrid *grid, Vector3 start, Vector3 end, float radius)
+{
+    Vector3 center = Vector3Lerp(start, end, 0.5f);
+    float reach = radius + 0.5f*Vector3Distance(start, end);
+    int x0, x1, z0, z1;
+    if(!GetStaticGridCellRange(grid, center, reach, &x0, &x1, &z0, &z1)) return -1.0f;
+    
+    float hitTime = -1.0f;
+    for(int z = z0; z <= z1; z++){
+        for(int x = x0; x <= x1; x++){
+            int cell = z * grid->cellsX + x;
+            int first = grid->cellStart[cell];
+            int count = grid->cellStart[cell + 1] - first;
+            for(int k = 0; k < count; k++){
+                int next = CheckCollisionBoxesSphereBatch(grid->itemMinX + first + k, grid->itemMinY + first + k, grid->itemMinZ + first + k,
+                                                          grid->itemMaxX + first + k, grid->itemMaxY + first + k, grid->itemMaxZ + first + k, count - k, center, reach);
+                if(next < 0) break;
+                k += next;
+                float t = GetSweptBoxHitTime(start, end, radius, grid->boxes[grid->cellItems[first + k]]);
+                if(t >= 0.0f && (hitTime < 0.0f || t < hitTime)) hitTime = t;
+            }
+        }
+    }
+    
+    return hitTime;
+}
+
+//true if no static box touches the segment, only the cells the segment crosses are visited (Amanatides and Woo),
+//nearest first, and the walk stops at the first box in the way
+static bool IsStaticGridSegmentClear(const StaticGrid *grid, Vector3 start, Vector3 end)
+{
+    if(grid->boxCount <= 0) return true;
+    
+    float fx = (start.x - grid->originX)/grid->cellSize, fz = (start.z - grid->originZ)/grid->cellSize;
+    float dx = end.x - start.x, dz = end.z - start.z;
+    int x = (int)floorf(fx), z = (int)floorf(fz);
+    int endX = (int)floorf((end.x - grid->originX)/grid->cellSize), endZ = (int)floorf((end.z - grid->originZ)/grid->cellSize);
+    int stepX = (dx > 0.0f)? 1 : -1, stepZ = (dz > 0.0f)? 1 : -1;
+    
+    //segment time at which the walk crosses the next cell border on each axis, and between two borders
+    float tDeltaX = (dx != 0.0f)? grid->cellSize/fabsf(dx) : INFINITY;
+    float tDeltaZ = (dz != 0.0f)? grid->cellSize/fabsf(dz) : INFINITY;
+    float tMaxX = (dx != 0.0f)? ((dx > 0.0f)? (x + 1 - fx) : (fx - x))*tDeltaX : INFINITY;
+    float tMaxZ = (dz != 0.0f)? ((dz > 0.0f)? (z + 1 - fz) : (fz - z))*tDeltaZ : INFINITY;
+    
+    int steps = abs(endX - x) + abs(endZ - z);
+    for(int i = 0; i <= steps; i++){
+        if(x >= 0 && z >= 0 && x < grid->cellsX && z < grid->cellsZ){
+            int cell = z * grid->cellsX + x;
+            for(int k = grid->cellStart[cell]; k < grid->cellStart[cell + 1]; k++){
+                if(GetSweptBoxHitTime(start, end, 0.0f, grid->boxes[grid->cellItems[k]]) >= 0.0f) return false;
+            }
+        }
+        if(tMaxX < tMaxZ){
+            tMaxX += tDeltaX;
+            x += stepX;
+        }
+        else {
+            tMaxZ += tDeltaZ;
+            z += stepZ;
+        }
+    }
+    
+    return true;
+}
+
+static DynamicGrid LoadDynamicGrid(GameMemory *memory, const int *kindCapacity, float cellSize)
+{
+    DynamicGrid grid = {0};
+    grid.cellSize = cellSize;
+    grid.inverseCellSize = 1.0f/cellSize;
+    for(int k = 0; k < DYNAMIC_KIND_COUNT; k++){
+        grid.kindFirst[k] = grid.entryCount;
+        grid.kindCapacity[k] = kindCapacity[k];
+        grid.entryCount += kindCapacity[k];
+    }
+    
+    //at least two buckets per entry keeps the chains short
+    int bucketCount = 64;
+    while(bucketCount < 2*grid.entryCount) bucketCount *= 2;
+    grid.bucketMask = bucketCount - 1;
+    grid.bucketHead = (int *)PushGameMemory(memory, bucketCount * sizeof(int));
+    
+    int entryCount = (grid.entryCount > 0 ? grid.entryCount : 1);
+    grid.entryNext = (int *)PushGameMemory(memory, entryCount * sizeof(int));
+    grid.entryPrev = (int *)PushGameMemory(memory, entryCount * sizeof(int));
+    grid.entryCellX = (int *)PushGameMemory(memory, entryCount * sizeof(int));
+    grid.entryCellZ = (int *)PushGameMemory(memory, entryCount * sizeof(int));
+    grid.entryBucket = (int *)PushGameMemory(memory, entryCount * sizeof(int));
+    if(memory->base == NULL) return grid;
+    
+    for(int b = 0; b < bucketCount; b++) grid.bucketHead[b] = -1;
+    for(int e = 0; e < entryCount; e++) grid.entryBucket[e] = -1;
+    
+    return grid;
+}
+
+//cell coordinate of a world x or z, every item is placed with this once per step so it avoids calling floorf
+static int GetDynamicGridCell(const DynamicGrid *grid, float coord)
+{
+    float scaled = coord*grid->inverseCellSize;
+    int cell = (int)scaled;
+    return (scaled < (float)cell)? cell - 1 : cell;
+}
+
+//cells are unbounded, far apart cells may share a bucket
+static int GetDynamicGridBucket(const DynamicGrid *grid, int x, int z)
+{
+    return (int)((((unsigned int)x*73856093u) ^ ((unsigned int)z*19349663u)) & (unsigned int)grid->bucketMask);
+}
+
+static void RemoveDynamicGridItem(DynamicGrid *grid, DynamicKind kind, int index)
+{
+    int entry = grid->kindFirst[kind] + index;
+    int bucket = grid->entryBucket[entry];
+    if(bucket < 0) return;
+    
+    if(grid->entryPrev[entry] >= 0) grid->entryNext[grid->entryPrev[entry]] = grid->entryNext[entry];
+    else grid->bucketHead[bucket] = grid->entryNext[entry];
+    if(grid->entryNext[entry] >= 0) grid->entryPrev[grid->entryNext[entry]] = grid->entryPrev[entry];
+    grid->entryBucket[entry] = -1;
+}
+
+//inserts an item or moves it to the cell of its new position, radius is how far it reaches from pos
+static void UpdateDynamicGridItem(DynamicGrid *grid, DynamicKind kind, int index, Vector3 pos, float radius)
+{
+    int entry = grid->kindFirst[kind] + index;
+    int x = GetDynamicGridCell(grid, pos.x);
+    int z = GetDynamicGridCell(grid, pos.z);
+    if(radius > grid->kindRadius[kind]) grid->kindRadius[kind] = radius;
+    if(grid->entryBucket[entry] >= 0 && grid->entryCellX[entry] == x && grid->entryCellZ[entry] == z) return;
+    
+    RemoveDynamicGridItem(grid, kind, index);
+    int bucket = GetDynamicGridBucket(grid, x, z);
+    grid->entryCellX[entry] = x;
+    grid->entryCellZ[entry] = z;
+    grid->entryBucket[entry] = bucket;
+    grid->entryPrev[entry] = -1;
+    grid->entryNext[entry] = grid->bucketHead[bucket];
+    if(grid->bucketHead[bucket] >= 0) grid->entryPrev[grid->bucketHead[bucket]] = entry;
+    grid->bucketHead[bucket] = entry;
+}
+
+//starts walking the items of a kind in the cells a sphere's XZ footprint overlaps, callers still test the items themselves
+static DynamicGridQuery QueryDynamicGrid(const DynamicGrid *grid, DynamicKind kind, Vector3 center, float radius)
+{
+    float reach = radius + grid->kindRadius[kind];
+    DynamicGridQuery query = { .grid = grid, .kind = kind };
+    query.x0 = GetDynamicGridCell(grid, center.x - reach);
+    query.x1 = GetDynamicGridCell(grid, center.x + reach);
+    query.z0 = GetDynamicGridCell(grid, center.z - reach);
+    query.z1 = GetDynamicGridCell(grid, center.z + reach);
+    query.x = query.x0;
+    query.z = query.z0;
+    query.entry = grid->bucketHead[GetDynamicGridBucket(grid, query.x, query.z)];
+    return query;
+}
+
+//next item index of the query, false once every cell was walked, each item comes up once
+static bool NextDynamicGridItem(DynamicGridQuery *query, int *index)
+{
+    const DynamicGrid *grid = query->grid;
+    int first = grid->kindFirst[query->kind];
+    int last = first + grid->kindCapacity[query->kind];
+    
+    while(query->z <= query->z1){
+        while(query->entry >= 0){
+            int entry = query->entry;
+            query->entry = grid->entryNext[entry];
+            //skipping other kinds and other cells sharing the bucket
+            if(entry >= first && entry < last && grid->entryCellX[entry] == query->x && grid->entryCellZ[entry] == query->z){
+                *index = entry - first;
+                return true;
+            }
+        }
+        
+        if(++query->x > query->x1){
+            query->x = query->x0;
+            query->z++;
+        }
+        if(query->z <= query->z1) query->entry = grid->bucketHead[GetDynamicGridBucket(grid, query->x, query->z)];
+    }
+    
+    return false;
+}
+
+//marks every cell whose center is within agentRadius of a box, an enemy following the open cells keeps clear of walls
+static NavGrid LoadNavGrid(const BoundingBox *boxes, int boxCount, float cellSize, float agentRadius)
+{
+    NavGrid grid = { 0 };
+    grid.cellSize = cellSize;
+    if(boxCount <= 0) return grid;
+    
+    float minX = boxes[0].min.x, minZ = boxes[0].min.z, maxX = boxes[0].max.x, maxZ = boxes[0].max.z;
+    for(int i = 1; i < boxCount; i++){
+        minX = fminf(minX, boxes[i].min.x);
+        minZ = fminf(minZ, boxes[i].min.z);
+        maxX = fmaxf(maxX, boxes[i].max.x);
+        maxZ = fmaxf(maxZ, boxes[i].max.z);
+    }
+    grid.originX = minX - cellSize;
+    grid.originZ = minZ - cellSize;
+    grid.cellsX = (int)((maxX - minX)/cellSize) + 3;
+    grid.cellsZ = (int)((maxZ - minZ)/cellSize) + 3;
+    grid.IsBlocked = (bool *)calloc(grid.cellsX*grid.cellsZ, sizeof(bool));
+    
+    for(int i = 0; i < boxCount; i++){
+        int x0 = (int)ceilf((boxes[i].min.x - agentRadius - grid.originX)/cellSize - 0.5f);
+        int x1 = (int)floorf((boxes[i].max.x + agentRadius - grid.originX)/cellSize - 0.5f);
+        int z0 = (int)ceilf((boxes[i].min.z - agentRadius - grid.originZ)/cellSize - 0.5f);
+        int z1 = (int)floorf((boxes[i].max.z + agentRadius - grid.originZ)/cellSize - 0.5f);
+        if(x0 < 0) x0 = 0;
+        if(z0 < 0) z0 = 0;
+        if(x1 >= grid.cellsX) x1 = grid.cellsX - 1;
+        if(z1 >= grid.cellsZ) z1 = grid.cellsZ - 1;
+        for(int z = z0; z <= z1; z++){
+            for(int x = x0; x <= x1; x++) grid.IsBlocked[z*grid.cellsX + x] = true;
+        }
+    }
+    
+    return grid;
+}
+
+static void UnloadNavGrid(NavGrid grid)
+{
+    free(grid.IsBlocked);
+}
+
+//cell index of a position, -1 off the grid
+static int GetNavCell(const NavGrid *grid, Vector3 pos)
+{
+    int x = (int)floorf((pos.x - grid->originX)/grid->cellSize);
+    int z = (int)floorf((pos.z - grid->originZ)/grid->cellSize);
+    if(x < 0 || z < 0 || x >= grid->cellsX || z >= grid->cellsZ) return -1;
+    return z*grid->cellsX + x;
+}
+
+//true if move d out of cell (x, z) lands on an open cell, diagonal moves also need both cells beside them open so they don't cut corners
+static bool IsNavStepOpen(const NavGrid *grid, int x, int z, int d)
+{
+    int nx = x + flowSteps[d][0], nz = z + flowSteps[d][1];
+    if(nx < 0 || nz < 0 || nx >= grid->cellsX || nz >= grid->cellsZ || grid->IsBlocked[nz*grid->cellsX + nx]) return false;
+    if(flowSteps[d][0] != 0 && flowSteps[d][1] != 0) return !grid->IsBlocked[z*grid->cellsX + nx] && !grid->IsBlocked[nz*grid->cellsX + x];
+    return true;
+}
+
+static FlowField LoadFlowField(GameMemory *memory, const NavGrid *grid)
+{
+    int cellCount = grid->cellsX*grid->cellsZ;
+    FlowField field = { 0 };
+    field.targetCell = -1;
+    field.cost = (int *)PushGameMemory(memory, (cellCount + 1)*sizeof(int));
+    field.direction = (unsigned char *)PushGameMemory(memory, cellCount + 1);
+    if(memory->base == NULL) return field;
+    
+    for(int c = 0; c < cellCount; c++){
+        field.cost[c] = -1;
+        field.direction[c] = FlowDirectionCount;
+    }
+    return field;
+}
+
+//the open cells of a rebuild keyed by cost then cell
+//a cell is pushed again each time a settled neighbour lowers its cost, at most once per direction, plus the target
+static long long *LoadFlowFieldHeap(const NavGrid *grid)
+{
+    return (long long *)malloc((grid->cellsX*grid->cellsZ*FlowDirectionCount + 1)*sizeof(long long));
+}
+
+static void PushFlowFieldHeap(long long *heap, int *count, int cost, int cell)
+{
+    long long key = ((long long)cost << 32) | cell;
+    int i = (*count)++;
+    while(i > 0 && heap[(i - 1)/2] > key){
+        heap[i] = heap[(i - 1)/2];
+        i = (i - 1)/2;
+    }
+    heap[i] = key;
+}
+
+static long long PopFlowFieldHeap(long long *heap, int *count)
+{
+    long long top = heap[0];
+    long long last = heap[--(*count)];
+    int i = 0;
+    while(2*i + 1 < *count){
+        int child = 2*i + 1;
+        if(child + 1 < *count && heap[child + 1] < heap[child]) child++;
+        if(heap[child] >= last) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+    return top;
+}
+
+//Dijkstra out from the target's cell over the open cells, then every cell points at the neighbour on its cheapest way back
+//blocked cells point at an open neighbour so an enemy pushed into one drives out, nothing is done while the target stays in its cell
+static void UpdateFlowField(FlowField *field, const NavGrid *grid, long long *heap, Vector3 target)
+{
+    int targetCell = GetNavCell(grid, target);
+    if(targetCell == field->targetCell) return;
+    field->targetCell = targetCell;
+    
+    int cellCount = grid->cellsX*grid->cellsZ;
+    for(int c = 0; c < cellCount; c++){
+        field->cost[c] = -1;
+        field->direction[c] = FlowDirectionCount;
+    }
+    if(targetCell < 0) return;
+    
+    int heapCount = 0;
+    field->cost[targetCell] = 0;
+    PushFlowFieldHeap(heap, &heapCount, 0, targetCell);
+    while(heapCount > 0){
+        long long top = PopFlowFieldHeap(heap, &heapCount);
+        int cost = (int)(top >> 32);
+        int cell = (int)(top & 0xffffffff);
+        if(cost > field->cost[cell]) continue;      //reached cheaper since it was pushed
+        
+        int x = cell%grid->cellsX, z = cell/grid->cellsX;
+        for(int d = 0; d < FlowDirectionCount; d++){
+            if(!IsNavStepOpen(grid, x, z, d)) continue;
+            int next = (z + flowSteps[d][1])*grid->cellsX + x + flowSteps[d][0];
+            int nextCost = cost + flowSteps[d][2];
+            if(field->cost[next] >= 0 && field->cost[next] <= nextCost) continue;
+            field->cost[next] = nextCost;
+            PushFlowFieldHeap(heap, &heapCount, nextCost, next);
+        }
+    }
+    
+    for(int cell = 0; cell < cellCount; cell++){
+        if(cell == targetCell) continue;
+        int x = cell%grid->cellsX, z = cell/grid->cellsX;
+        int bestCost = -1;
+        for(int d = 0; d < FlowDirectionCount; d++){
+            int nx = x + flowSteps[d][0], nz = z + flowSteps[d][1];
+            if(grid->IsBlocked[cell]){
+                if(nx < 0 || nz < 0 || nx >= grid->cellsX || nz >= grid->cellsZ || grid->IsBlocked[nz*grid->cellsX + nx]) continue;
+            }
+            else if(!IsNavStepOpen(grid, x, z, d)) continue;
+            
+            int nextCost = field->cost[nz*grid->cellsX + nx];
+            if(nextCost < 0) continue;
+            if(bestCost < 0 || nextCost + flowSteps[d][2] < bestCost){
+                bestCost = nextCost + flowSteps[d][2];
+                field->direction[cell] = (unsigned char)d;
+            }
+        }
+    }
+}
+
+//unit XZ direction to follow from a position, zero off the grid, in the target's cell or where the target can't be reached
+static Vector3 GetFlowFieldDirection(const FlowField *field, const NavGrid *grid, Vector3 pos)
+{
+    int cell = GetNavCell(grid, pos);
+    if(cell < 0) return Vector3Zero();
+    const int *step = flowSteps[field->direction[cell]];
+    return Vector3Normalize((Vector3){(float)step[0], 0.0f, (float)step[1]});
+}
+
+//earliest fraction of the segment start->end at which a sphere moving along it touches the target sphere, -1 if it never does
+static float GetSweptSphereHitTime(Vector3 start, Vector3 end, float radius, Vector3 center, float targetRadius)
+{
+    Vector3 dir = Vector3Subtract(end, start);
+    Vector3 offset = Vector3Subtract(start, center);
+    float reach = radius + targetRadius;
+    float c = Vector3DotProduct(offset, offset) - reach*reach;
+    if(c <= 0.0f) return 0.0f;                          //touching already at the start
+    
+    float a = Vector3DotProduct(dir, dir);
+    float b = Vector3DotProduct(offset, dir);
+    if(a <= 0.0f || b >= 0.0f) return -1.0f;           //not moving, or moving away
+    float discriminant = b*b - a*c;
+    if(discriminant < 0.0f) return -1.0f;
+    
+    float t = (-b - sqrtf(discriminant))/a;
+    return (t <= 1.0f)? t : -1.0f;
+}
+
+//same for a box, swept as a segment against the box grown by the radius (slab test), which is slightly generous at the corners
+static float GetSweptBoxHitTime(Vector3 start, Vector3 end, float radius, BoundingBox box)
+{
+    float origin[3] = {start.x, start.y, start.z};
+    float dir[3] = {end.x - start.x, end.y - start.y, end.z - start.z};
+    float boxMin[3] = {box.min.x - radius, box.min.y - radius, box.min.z - radius};
+    float boxMax[3] = {box.max.x + radius, box.max.y + radius, box.max.z + radius};
+    float tEnter = 0.0f, tExit = 1.0f;
+    
+    for(int axis = 0; axis < 3; axis++){
+        if(fabsf(dir[axis]) < 1e-8f){
+            if(origin[axis] < boxMin[axis] || origin[axis] > boxMax[axis]) return -1.0f;
+            continue;
+        }
+        float t0 = (boxMin[axis] - origin[axis])/dir[axis];
+        float t1 = (boxMax[axis] - origin[axis])/dir[axis];
+        if(t0 > t1){
+            float swap = t0;
+            t0 = t1;
+            t1 = swap;
+        }
+        if(t0 > tEnter) tEnter = t0;
+        if(t1 < tExit) tExit = t1;
+        if(tEnter > tExit) return -1.0f;
+    }
+    
+    return tEnter;
+}
+
+static float GetVector3Axis(Vector3 v, int axis)
+{
+    return (axis == 0)? v.x : (axis == 1)? v.y : v.z;
+}
+
+static float GetBoundingBoxArea(BoundingBox box)
+{
+    Vector3 size = Vector3Subtract(box.max, box.min);
+    return size.x*size.y + size.y*size.z + size.z*size.x;
+}
+
+//centroid bin of a triangle when splitting along an axis, binning and partitioning must agree exactly
+static int GetBvhBin(Vector3 centroid, int axis, float axisMin, float binScale)
+{
+    int bin = (int)((GetVector3Axis(centroid, axis) - axisMin)*binScale);
+    return (bin < BvhSplitBins)? bin : BvhSplitBins - 1;
+}
+
+//fits a node to its triangles and splits it in two at the cheapest of the binned planes along its widest axis (surface area heuristic)
+static void BuildBvhNode(TriangleBvh *bvh, Vector3 *centroids, int index, int depth)
+{
+    BvhNode *node = &bvh->nodes[index];
+    const Vector3 *corners = bvh->vertices + 3*node->first;
+    node->bounds = (BoundingBox){corners[0], corners[0]};
+    BoundingBox centroidBounds = {centroids[node->first], centroids[node->first]};
+    for(int i = 0; i < node->triangleCount; i++){
+        for(int c = 0; c < 3; c++){
+            node->bounds.min = Vector3Min(node->bounds.min, corners[3*i + c]);
+            node->bounds.max = Vector3Max(node->bounds.max, corners[3*i + c]);
+        }
+        centroidBounds.min = Vector3Min(centroidBounds.min, centroids[node->first + i]);
+        centroidBounds.max = Vector3Max(centroidBounds.max, centroids[node->first + i]);
+    }
+    if(node->triangleCount <= MaxBvhLeafTriangles || depth >= MaxBvhDepth - 1) return;
+    
+    Vector3 extent = Vector3Subtract(centroidBounds.max, centroidBounds.min);
+    int axis = (extent.x >= extent.y && extent.x >= extent.z)? 0 : (extent.y >= extent.z)? 1 : 2;
+    float axisMin = GetVector3Axis(centroidBounds.min, axis);
+    if(GetVector3Axis(extent, axis) <= 0.0f) return;                //every centroid in one spot, no plane separates them
+    float binScale = BvhSplitBins/GetVector3Axis(extent, axis);
+    
+    int binCounts[BvhSplitBins] = { 0 };
+    BoundingBox binBounds[BvhSplitBins];
+    for(int i = 0; i < node->triangleCount; i++){
+        int bin = GetBvhBin(centroids[node->first + i], axis, axisMin, binScale);
+        if(binCounts[bin]++ == 0) binBounds[bin] = (BoundingBox){corners[3*i], corners[3*i]};
+        for(int c = 0; c < 3; c++){
+            binBounds[bin].min = Vector3Min(binBounds[bin].min, corners[3*i + c]);
+            binBounds[bin].max = Vector3Max(binBounds[bin].max, corners[3*i + c]);
+        }
+    }
+    
+    //cost of the planes after each bin, the left side swept up from bin 0 and the right side down from the last bin
+    float leftCost[BvhSplitBins - 1];
+    BoundingBox sideBounds = { 0 };
+    int sideCount = 0;
+    for(int b = 0; b < BvhSplitBins - 1; b++){
+        if(binCounts[b] > 0){
+            sideBounds = (sideCount == 0)? binBounds[b] : (BoundingBox){Vector3Min(sideBounds.min, binBounds[b].min), Vector3Max(sideBounds.max, binBounds[b].max)};
+            sideCount += binCounts[b];
+        }
+        leftCost[b] = sideCount*GetBoundingBoxArea(sideBounds);
+    }
+    int split = 0;
+    float bestCost = INFINITY;
+    sideCount = 0;
+    for(int b = BvhSplitBins - 1; b > 0; b--){
+        if(binCounts[b] > 0){
+            sideBounds = (sideCount == 0)? binBounds[b] : (BoundingBox){Vector3Min(sideBounds.min, binBounds[b].min), Vector3Max(sideBounds.max, binBounds[b].max)};
+            sideCount += binCounts[b];
+        }
+        float cost = leftCost[b - 1] + sideCount*GetBoundingBoxArea(sideBounds);
+        if(sideCount > 0 && sideCount < node->triangleCount && cost <= bestCost){
+            bestCost = cost;
+            split = b;
+        }
+    }
+    
+    //triangles in bins below the split to the front
+    int first = node->first, count = node->triangleCount;
+    int i = first, j = first + count - 1;
+    while(i <= j){
+        if(GetBvhBin(centroids[i], axis, axisMin, binScale) < split) i++;
+        else {
+            for(int c = 0; c < 3; c++){
+                Vector3 swap = bvh->vertices[3*i + c];
+                bvh->vertices[3*i + c] = bvh->vertices[3*j + c];
+                bvh->vertices[3*j + c] = swap;
+            }
+            Vector3 swap = centroids[i];
+            centroids[i] = centroids[j];
+            centroids[j] = swap;
+            j--;
+        }
+    }
+    int leftCount = i - first;
+    if(leftCount == 0 || leftCount == count) return;
+    
+    int left = bvh->nodeCount;
+    bvh->nodeCount += 2;
+    bvh->nodes[left].first = first;
+    bvh->nodes[left].triangleCount = leftCount;
+    bvh->nodes[left + 1].first = first + leftCount;
+    bvh->nodes[left + 1].triangleCount = count - leftCount;
+    node->first = left;
+    node->triangleCount = 0;
+    BuildBvhNode(bvh, centroids, left, depth + 1);
+    BuildBvhNode(bvh, centroids, left + 1, depth + 1);
+}
+
+//sorts triangles, three corners each, into a BVH that takes over the vertex array
+static TriangleBvh BuildTriangleBvh(Vector3 *vertices, int triangleCount)
+{
+    TriangleBvh bvh = { 0 };
+    bvh.vertices = vertices;
+    bvh.triangleCount = triangleCount;
+    if(vertices == NULL || triangleCount <= 0) return bvh;
+    
+    //a binary tree with one triangle per leaf has 2n - 1 nodes, fewer are ever needed
+    bvh.nodes = (BvhNode *)malloc((2*triangleCount - 1)*sizeof(BvhNode));
+    Vector3 *centroids = (Vector3 *)malloc(triangleCount*sizeof(Vector3));
+    for(int i = 0; i < triangleCount; i++){
+        centroids[i] = Vector3Scale(Vector3Add(Vector3Add(vertices[3*i], vertices[3*i + 1]), vertices[3*i + 2]), 1.0f/3.0f);
+    }
+    bvh.nodes[0].first = 0;
+    bvh.nodes[0].triangleCount = triangleCount;
+    bvh.nodeCount = 1;
+    BuildBvhNode(&bvh, centroids, 0, 0);
+    free(centroids);
+    return bvh;
+}
+
+static void UnloadTriangleBvh(TriangleBvh bvh)
+{
+    free(bvh.nodes);
+    free(bvh.vertices);
+}
+
+//point of the triangle abc nearest to p, by the Voronoi region of abc p falls in
+static Vector3 GetClosestPointOnTriangle(Vector3 p, Vector3 a, Vector3 b, Vector3 c)
+{
+    Vector3 ab = Vector3Subtract(b, a), ac = Vector3Subtract(c, a), ap = Vector3Subtract(p, a);
+    float d1 = Vector3DotProduct(ab, ap), d2 = Vector3DotProduct(ac, ap);
+    if(d1 <= 0.0f && d2 <= 0.0f) return a;
+    
+    Vector3 bp = Vector3Subtract(p, b);
+    float d3 = Vector3DotProduct(ab, bp), d4 = Vector3DotProduct(ac, bp);
+    if(d3 >= 0.0f && d4 <= d3) return b;
+    
+    float vc = d1*d4 - d3*d2;
+    if(vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return Vector3Add(a, Vector3Scale(ab, d1/(d1 - d3)));
+    
+    Vector3 cp = Vector3Subtract(p, c);
+    float d5 = Vector3DotProduct(ab, cp), d6 = Vector3DotProduct(ac, cp);
+    if(d6 >= 0.0f && d5 <= d6) return c;
+    
+    float vb = d5*d2 - d1*d6;
+    if(vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return Vector3Add(a, Vector3Scale(ac, d2/(d2 - d6)));
+    
+    float va = d3*d6 - d5*d4;
+    if(va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) return Vector3Add(b, Vector3Scale(Vector3Subtract(c, b), (d4 - d3)/((d4 - d3) + (d5 - d6))));
+    
+    float denom = 1.0f/(va + vb + vc);
+    return Vector3Add(a, Vector3Add(Vector3Scale(ab, vb*denom), Vector3Scale(ac, vc*denom)));
+}
+
+//earliest fraction of the segment start->end at which a sphere moving along it touches the triangle, -1 if it never does
+//the face is tried first, a path that only brushes the rim meets a corner or an edge instead
+static float GetSweptTriangleHitTime(Vector3 start, Vector3 end, float radius, const Vector3 *corners)
+{
+    if(Vector3DistanceSqr(GetClosestPointOnTriangle(start, corners[0], corners[1], corners[2]), start) <= radius*radius) return 0.0f;
+    
+    Vector3 dir = Vector3Subtract(end, start);
+    Vector3 normal = Vector3CrossProduct(Vector3Subtract(corners[1], corners[0]), Vector3Subtract(corners[2], corners[0]));
+    float normalLength = Vector3Length(normal);
+    if(normalLength > 0.0f){
+        normal = Vector3Scale(normal, 1.0f/normalLength);
+        float distance = Vector3DotProduct(normal, Vector3Subtract(start, corners[0]));
+        float approach = Vector3DotProduct(normal, dir);
+        float side = (distance < 0.0f)? -1.0f : 1.0f;  //the normal keeps the winding for the inside test, side says which face the sphere comes from
+        
+        //the sphere reaches the plane inside the triangle, nothing of the triangle can be touched earlier
+        float t = (side*approach < 0.0f)? (radius - side*distance)/(side*approach) : -1.0f;
+        if(t >= 0.0f && t <= 1.0f){
+            Vector3 contact = Vector3Subtract(Vector3Add(start, Vector3Scale(dir, t)), Vector3Scale(normal, side*radius));
+            bool IsInside = true;
+            for(int k = 0; k < 3 && IsInside; k++){
+                Vector3 edge = Vector3Subtract(corners[(k + 1)%3], corners[k]);
+                IsInside = Vector3DotProduct(Vector3CrossProduct(edge, Vector3Subtract(contact, corners[k])), normal) >= 0.0f;
+            }
+            if(IsInside) return t;
+        }
+    }
+    if(radius <= 0.0f) return -1.0f;
+    
+    float best = -1.0f;
+    for(int k = 0; k < 3; k++){
+        float t = GetSweptSphereHitTime(start, end, radius, corners[k], 0.0f);
+        if(t >= 0.0f && (best < 0.0f || t < best)) best = t;
+        
+        //the edge as a cylinder of the sphere's radius, a hit only counts between the edge's two ends
+        Vector3 edge = Vector3Subtract(corners[(k + 1)%3], corners[k]);
+        Vector3 offset = Vector3Subtract(start, corners[k]);
+        float edgeLengthSqr = Vector3DotProduct(edge, edge);
+        float edgeDir = Vector3DotProduct(edge, dir), edgeOffset = Vector3DotProduct(edge, offset);
+        float a = edgeLengthSqr*Vector3DotProduct(dir, dir) - edgeDir*edgeDir;
+        float b = edgeLengthSqr*Vector3DotProduct(dir, offset) - edgeDir*edgeOffset;
+        float c = edgeLengthSqr*(Vector3DotProduct(offset, offset) - radius*radius) - edgeOffset*edgeOffset;
+        float discriminant = b*b - a*c;
+        if(a <= 0.0f || discriminant < 0.0f) continue;
+        t = (-b - sqrtf(discriminant))/a;
+        float along = (edgeOffset + t*edgeDir)/edgeLengthSqr;
+        if(t >= 0.0f && t <= 1.0f && along >= 0.0f && along <= 1.0f && (best < 0.0f || t < best)) best = t;
+    }
+    return best;
+}
+
+//true if a sphere in the tree's model space touches any of its triangles
+static bool CheckCollisionTriangleBvhSphere(const TriangleBvh *bvh, Vector3 center, float radius)
+{
+    if(bvh->nodeCount <= 0) return false;
+    
+    int stack[MaxBvhDepth + 1];
+    int top = 0;
+    stack[top++] = 0;
+    while(top > 0){
+        const BvhNode *node = &bvh->nodes[stack[--top]];
+        if(!CheckCollisionBoxSphere(node->bounds, center, radius)) continue;
+        if(node->triangleCount == 0){
+            stack[top++] = node->first;
+            stack[top++] = node->first + 1;
+            continue;
+        }
+        for(int i = node->first; i < node->first + node->triangleCount; i++){
+            const Vector3 *corners = bvh->vertices + 3*i;
+            if(Vector3DistanceSqr(GetClosestPointOnTriangle(center, corners[0], corners[1], corners[2]), center) <= radius*radius) return true;
+        }
+    }
+    return false;
+}
+
+//earliest fraction of the segment start->end, in the tree's model space, at which a sphere moving along it touches a triangle, -1 if it never does
+//the nearer child is walked first and nodes entered after the best hit so far are skipped
+static float GetTriangleBvhSweptHitTime(const TriangleBvh *bvh, Vector3 start, Vector3 end, float radius)
+{
+    if(bvh->nodeCount <= 0) return -1.0f;
+    
+    float best = 2.0f;
+    int stack[MaxBvhDepth + 1];
+    float stackTime[MaxBvhDepth + 1];
+    int top = 0;
+    stackTime[top] = GetSweptBoxHitTime(start, end, radius, bvh->nodes[0].bounds);
+    if(stackTime[top] >= 0.0f) stack[top++] = 0;
+    while(top > 0){
+        top--;
+        if(stackTime[top] > best) continue;
+        const BvhNode *node = &bvh->nodes[stack[top]];
+        if(node->triangleCount > 0){
+            for(int i = node->first; i < node->first + node->triangleCount; i++){
+                float t = GetSweptTriangleHitTime(start, end, radius, bvh->vertices + 3*i);
+                if(t >= 0.0f && t < best) best = t;
+            }
+            continue;
+        }
+        
+        int near = node->first, far = node->first + 1;
+        float nearTime = GetSweptBoxHitTime(start, end, radius, bvh->nodes[near].bounds);
+        float farTime = GetSweptBoxHitTime(start, end, radius, bvh->nodes[far].bounds);
+        if(farTime >= 0.0f && (nearTime < 0.0f || farTime < nearTime)){
+            int swapNode = near;
+            near = far;
+            far = swapNode;
+            float swapTime = nearTime;
+            nearTime = farTime;
+            farTime = swapTime;
+        }
+        if(farTime >= 0.0f && farTime <= best){
+            stack[top] = far;
+            stackTime[top++] = farTime;
+        }
+        if(nearTime >= 0.0f && nearTime <= best){
+            stack[top] = near;
+            stackTime[top++] = nearTime;
+        }
+    }
+    return (best <= 1.0f)? best : -1.0f;
+}
+
+//the batch kernels below do the same float operations in the same order as raylib's CheckCollisionSpheres and
+//CheckCollisionBoxSphere (squared distance against squared radius, no sqrt) so each lane agrees with them bit for bit
+
+//tests packed spheres against one sphere, hits[i] is 1 where sphere i touches it, returns the number of hits
+static int CheckCollisionSpheresBatch(const float *x, const float *y, const float *z, const float *radius, int count, Vector3 center, float centerRadius, unsigned char *hits)
+{
+    int hitCount = 0;
+    int i = 0;
+    
+#if defined(COLLISION_AVX)
+    __m256 cx8 = _mm256_set1_ps(center.x), cy8 = _mm256_set1_ps(center.y), cz8 = _mm256_set1_ps(center.z), cr8 = _mm256_set1_ps(centerRadius);
+    for(; i + 8 <= count; i += 8){
+        __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + i), cx8);
+        __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + i), cy8);
+        __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(z + i), cz8);
+        __m256 distSqr = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+        __m256 reach = _mm256_add_ps(_mm256_loadu_ps(radius + i), cr8);
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(distSqr, _mm256_mul_ps(reach, reach), _CMP_LE_OQ));
+        for(int lane = 0; lane < 8; lane++){
+            hits[i + lane] = (mask >> lane) & 1;
+            hitCount += hits[i + lane];
+        }
+    }
+#endif
+#if defined(COLLISION_SSE2)
+    __m128 cx4 = _mm_set1_ps(center.x), cy4 = _mm_set1_ps(center.y), cz4 = _mm_set1_ps(center.z), cr4 = _mm_set1_ps(centerRadius);
+    for(; i + 4 <= count; i += 4){
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(x + i), cx4);
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(y + i), cy4);
+        __m128 dz = _mm_sub_ps(_mm_loadu_ps(z + i), cz4);
+        __m128 distSqr = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        __m128 reach = _mm_add_ps(_mm_loadu_ps(radius + i), cr4);
+        int mask = _mm_movemask_ps(_mm_cmple_ps(distSqr, _mm_mul_ps(reach, reach)));
+        for(int lane = 0; lane < 4; lane++){
+            hits[i + lane] = (mask >> lane) & 1;
+            hitCount += hits[i + lane];
+        }
+    }
+#endif
+    
+    for(; i < count; i++){
+        float dx = x[i] - center.x, dy = y[i] - center.y, dz = z[i] - center.z;
+        float reach = radius[i] + centerRadius;
+        hits[i] = (dx*dx + dy*dy + dz*dz <= reach*reach);
+        hitCount += hits[i];
+    }
+    
+    return hitCount;
+}
+
+//tests packed spheres against one box, hits[i] is 1 where sphere i touches it, returns the number of hits
+static int CheckCollisionBoxSpheresBatch(BoundingBox box, const float *x, const float *y, const float *z, const float *radius, int count, unsigned char *hits)
+{
+    int hitCount = 0;
+    int i = 0;
+    
+    //distance outside the box along each axis is max(min - c, c - max, 0), its square is the same as raylib's powf(c - bound, 2)
+#if defined(COLLISION_AVX)
+    __m256 zero8 = _mm256_setzero_ps();
+    __m256 minX8 = _mm256_set1_ps(box.min.x), minY8 = _mm256_set1_ps(box.min.y), minZ8 = _mm256_set1_ps(box.min.z);
+    __m256 maxX8 = _mm256_set1_ps(box.max.x), maxY8 = _mm256_set1_ps(box.max.y), maxZ8 = _mm256_set1_ps(box.max.z);
+    for(; i + 8 <= count; i += 8){
+        __m256 cx = _mm256_loadu_ps(x + i), cy = _mm256_loadu_ps(y + i), cz = _mm256_loadu_ps(z + i);
+        __m256 dx = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(minX8, cx), _mm256_sub_ps(cx, maxX8)), zero8);
+        __m256 dy = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(minY8, cy), _mm256_sub_ps(cy, maxY8)), zero8);
+        __m256 dz = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(minZ8, cz), _mm256_sub_ps(cz, maxZ8)), zero8);
+        __m256 distSqr = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+        __m256 r = _mm256_loadu_ps(radius + i);
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(distSqr, _mm256_mul_ps(r, r), _CMP_LE_OQ));
+        for(int lane = 0; lane < 8; lane++){
+            hits[i + lane] = (mask >> lane) & 1;
+            hitCount += hits[i + lane];
+        }
+    }
+#endif
+#if defined(COLLISION_SSE2)
+    __m128 zero4 = _mm_setzero_ps();
+    __m128 minX4 = _mm_set1_ps(box.min.x), minY4 = _mm_set1_ps(box.min.y), minZ4 = _mm_set1_ps(box.min.z);
+    __m128 maxX4 = _mm_set1_ps(box.max.x), maxY4 = _mm_set1_ps(box.max.y), maxZ4 = _mm_set1_ps(box.max.z);
+    for(; i + 4 <= count; i += 4){
+        __m128 cx = _mm_loadu_ps(x + i), cy = _mm_loadu_ps(y + i), cz = _mm_loadu_ps(z + i);
+        __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minX4, cx), _mm_sub_ps(cx, maxX4)), zero4);
+        __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minY4, cy), _mm_sub_ps(cy, maxY4)), zero4);
+        __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minZ4, cz), _mm_sub_ps(cz, maxZ4)), zero4);
+        __m128 distSqr = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        __m128 r = _mm_loadu_ps(radius + i);
+        int mask = _mm_movemask_ps(_mm_cmple_ps(distSqr, _mm_mul_ps(r, r)));
+        for(int lane = 0; lane < 4; lane++){
+            hits[i + lane] = (mask >> lane) & 1;
+            hitCount += hits[i + lane];
+        }
+    }
+#endif
+    
+    for(; i < count; i++){
+        float dx = fmaxf(fmaxf(box.min.x - x[i], x[i] - box.max.x), 0.0f);
+        float dy = fmaxf(fmaxf(box.min.y - y[i], y[i] - box.max.y), 0.0f);
+        float dz = fmaxf(fmaxf(box.min.z - z[i], z[i] - box.max.z), 0.0f);
+        hits[i] = (dx*dx + dy*dy + dz*dz <= radius[i]*radius[i]);
+        hitCount += hits[i];
+    }
+    
+    return hitCount;
+}
+
+//tests one sphere against packed boxes, returns the index of the first box it touches or -1
+static int CheckCollisionBoxesSphereBatch(const float *minX, const float *minY, const float *minZ, const float *maxX, const float *maxY, const float *maxZ,
+                                          int count, Vector3 center, float radius)
+{
+    int i = 0;
+    
+#if defined(COLLISION_SSE2)
+    __m128 zero = _mm_setzero_ps();
+    __m128 cx = _mm_set1_ps(center.x), cy = _mm_set1_ps(center.y), cz = _mm_set1_ps(center.z);
+    __m128 radiusSqr = _mm_set1_ps(radius*radius);
+    for(; i + 4 <= count; i += 4){
+        __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(minX + i), cx), _mm_sub_ps(cx, _mm_loadu_ps(maxX + i))), zero);
+        __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(minY + i), cy), _mm_sub_ps(cy, _mm_loadu_ps(maxY + i))), zero);
+        __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(minZ + i), cz), _mm_sub_ps(cz, _mm_loadu_ps(maxZ + i))), zero);
+        __m128 distSqr = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        int mask = _mm_movemask_ps(_mm_cmple_ps(distSqr, radiusSqr));
+        if(mask != 0){
+            for(int lane = 0; lane < 4; lane++){
+                if(mask & (1 << lane)) return i + lane;
+            }
+        }
+    }
+#endif
+    
+    for(; i < count; i++){
+        float dx = fmaxf(fmaxf(minX[i] - center.x, center.x - maxX[i]), 0.0f);
+        float dy = fmaxf(fmaxf(minY[i] - center.y, center.y - maxY[i]), 0.0f);
+        float dz = fmaxf(fmaxf(minZ[i] - center.z, center.z - maxZ[i]), 0.0f);
+        if(dx*dx + dy*dy + dz*dz <= radius*radius) return i;
+    }
+    
+    return -1;
+}
+
+//carves every projectile slot out of the game state's block as one set of arrays, giving each type a contiguous range of slots
+static Projectiles LoadProjectiles(GameMemory *memory, const int *typeCapacity, const float *typeSpeed, const float *typeRange)
+{
+    Projectiles projectiles = {0};
+    for(int t = 0; t < PROJECTILE_TYPE_COUNT; t++){
+        projectiles.typeFirst[t] = projectiles.capacity;
+        projectiles.typeCapacity[t] = typeCapacity[t];
+        projectiles.typeSpeed[t] = typeSpeed[t];
+        projectiles.typeRange[t] = typeRange[t];
+        projectiles.capacity += typeCapacity[t];
+    }
+    
+    int n = projectiles.capacity;
+    projectiles.posX = (float *)PushGameMemory(memory, n*sizeof(float));
+    projectiles.posY = (float *)PushGameMemory(memory, n*sizeof(float));
+    projectiles.posZ = (float *)PushGameMemory(memory, n*sizeof(float));
+    projectiles.prevX = (float *)PushGameMemory(memory, n*sizeof(float));
+    projectiles.prevZ = (float *)PushGameMemory(memory, n*sizeof(float));
+    projectiles.velX = (float *)PushGameMemory(memory, n*sizeof(float));
+    projectiles.velZ = (float *)PushGameMemory(memory, n*sizeof(float));
+    projectiles.yaw = (float *)PushGameMemory(memory, n*sizeof(float));
+    projectiles.maxRange = (float *)PushGameMemory(memory, n*sizeof(float));
+    projectiles.damage = (int *)PushGameMemory(memory, n*sizeof(int));
+    projectiles.owner = (int *)PushGameMemory(memory, n*sizeof(int));
+    projectiles.type = (unsigned char *)PushGameMemory(memory, n*sizeof(unsigned char));
+    projectiles.faction = (unsigned char *)PushGameMemory(memory, n*sizeof(unsigned char));
+    projectiles.IsFired = (bool *)PushGameMemory(memory, n*sizeof(bool));
+    projectiles.live = (int *)PushGameMemory(memory, n*sizeof(int));
+    projectiles.livePos = (int *)PushGameMemory(memory, n*sizeof(int));
+    projectiles.liveX = (float *)PushGameMemory(memory, n*sizeof(float));
+    projectiles.liveY = (float *)PushGameMemory(memory, n*sizeof(float));
+    projectiles.liveZ = (float *)PushGameMemory(memory, n*sizeof(float));
+    projectiles.liveRadius = (float *)PushGameMemory(memory, n*sizeof(float));
+    projectiles.liveHits = (unsigned char *)PushGameMemory(memory, n*sizeof(unsigned char));
+    projectiles.liveHitTime = (float *)PushGameMemory(memory, n*sizeof(float));
+    projectiles.liveHitKind = (unsigned char *)PushGameMemory(memory, n*sizeof(unsigned char));
+    projectiles.liveHitIndex = (int *)PushGameMemory(memory, n*sizeof(int));
+    
+    if(memory->base == NULL) return projectiles;
+    
+    //chaining every slot of a type into that type's free list
+    for(int t = 0; t < PROJECTILE_TYPE_COUNT; t++){
+        int first = projectiles.typeFirst[t];
+        int last = first + projectiles.typeCapacity[t] - 1;
+        projectiles.freeHead[t] = (projectiles.typeCapacity[t] > 0)? first : -1;
+        for(int i = first; i <= last; i++){
+            projectiles.type[i] = (unsigned char)t;
+            projectiles.faction[i] = (t == PLAYER_TANK_BULLET || t == PLAYER_MG_BULLET)? PLAYER_FACTION : ENEMY_FACTION;
+            projectiles.livePos[i] = (i < last)? i + 1 : -1;
+        }
+    }
+    
+    return projectiles;
+}
+
+//fires a bullet from the head of its type's free list in O(1), returns the slot or -1 if the type's pool is exhausted
+static int SpawnProjectile(Projectiles *projectiles, ProjectileType type, Vector3 pos, float yaw, int damage, int owner)
+{
+    int i = projectiles->freeHead[type];
+    if(i < 0) return -1;
+    projectiles->freeHead[type] = projectiles->livePos[i];
+    
+    float speed = projectiles->typeSpeed[type];
+    projectiles->posX[i] = pos.x;
+    projectiles->posY[i] = pos.y;
+    projectiles->posZ[i] = pos.z;
+    projectiles->prevX[i] = pos.x;
+    projectiles->prevZ[i] = pos.z;
+    projectiles->velX[i] = sinf(DEG2RAD * yaw) * speed;
+    projectiles->velZ[i] = cosf(DEG2RAD * yaw) * speed;
+    projectiles->yaw[i] = yaw;
+    projectiles->maxRange[i] = projectiles->typeRange[type];
+    projectiles->damage[i] = damage;
+    projectiles->owner[i] = owner;
+    projectiles->IsFired[i] = true;
+    
+    int k = projectiles->liveCount++;
+    projectiles->livePos[i] = k;
+    projectiles->live[k] = i;
+    projectiles->liveX[k] = pos.x;
+    projectiles->liveY[k] = pos.y;
+    projectiles->liveZ[k] = pos.z;
+    projectiles->liveRadius[k] = ProjectileRadius;
+    return i;
+}
+
+//frees a slot in O(1): the last live slot takes its place in the live list and the slot goes back on its type's free list
+static void KillProjectile(Projectiles *projectiles, int slot)
+{
+    if(!projectiles->IsFired[slot]) return;
+    
+    int pos = projectiles->livePos[slot];
+    int lastPos = --projectiles->liveCount;
+    int last = projectiles->live[lastPos];
+    projectiles->live[pos] = last;
+    projectiles->livePos[last] = pos;
+    projectiles->liveX[pos] = projectiles->liveX[lastPos];
+    projectiles->liveY[pos] = projectiles->liveY[lastPos];
+    projectiles->liveZ[pos] = projectiles->liveZ[lastPos];
+    projectiles->liveRadius[pos] = projectiles->liveRadius[lastPos];
+    projectiles->IsFired[slot] = false;
+    
+    int type = projectiles->type[slot];
+    projectiles->livePos[slot] = projectiles->freeHead[type];
+    projectiles->freeHead[type] = slot;
+}
+
+//integration pass over live list entries [first, last) regardless of type, bullets past their range are flagged in liveHits
+//only touches those entries so disjoint ranges can move in parallel
+//the packed sphere of each bullet is grown to enclose its whole path this tick so the batch tests find every candidate for the swept tests
+static void MoveProjectiles(Projectiles *projectiles, int first, int last, Vector3 playerPos, float dt)
+{
+    for(int k = first; k < last; k++){
+        int i = projectiles->live[k];
+        float stepX = projectiles->velX[i]*dt;
+        float stepZ = projectiles->velZ[i]*dt;
+        projectiles->prevX[i] = projectiles->posX[i];
+        projectiles->prevZ[i] = projectiles->posZ[i];
+        projectiles->posX[i] += stepX;
+        projectiles->posZ[i] += stepZ;
+        projectiles->liveX[k] = projectiles->posX[i] - 0.5f*stepX;
+        projectiles->liveZ[k] = projectiles->posZ[i] - 0.5f*stepZ;
+        projectiles->liveRadius[k] = ProjectileRadius + 0.5f*sqrtf(stepX*stepX + stepZ*stepZ);
+        
+        float dx = projectiles->posX[i] - playerPos.x;
+        float dy = projectiles->posY[i] - playerPos.y;
+        float dz = projectiles->posZ[i] - playerPos.z;
+        projectiles->liveHits[k] = (dx*dx + dy*dy + dz*dz >= projectiles->maxRange[i] * projectiles->maxRange[i]);
+    }
+}
+
+//removes the bullets MoveProjectiles flagged, backwards so killing a bullet never skips one
+static void ExpireProjectiles(Projectiles *projectiles)
+{
+    for(int k = projectiles->liveCount - 1; k >= 0; k--){
+        if(projectiles->liveHits[k]) KillProjectile(projectiles, projectiles->live[k]);
+    }
+}
+
+static Vector3 GetProjectilePosition(const Projectiles *projectiles, int slot)
+{
+    return (Vector3){projectiles->posX[slot], projectiles->posY[slot], projectiles->posZ[slot]};
+}
+
+//where the slot was at the start of this tick's move
+static Vector3 GetProjectileStartPosition(const Projectiles *projectiles, int slot)
+{
+    return (Vector3){projectiles->prevX[slot], projectiles->posY[slot], projectiles->prevZ[slot]};
+}
+
+//keeps the earliest impact found for live list entry k, ties go to the one recorded first
+//or to the lower index of the same kind, so the order targets are found in doesn't matter within a kind
+static void RecordProjectileHit(Projectiles *projectiles, int k, float time, ProjectileHitKind kind, int index)
+{
+    if(time < 0.0f || time > projectiles->liveHitTime[k]) return;
+    if(time == projectiles->liveHitTime[k] && (kind != projectiles->liveHitKind[k] || index >= projectiles->liveHitIndex[k])) return;
+    projectiles->liveHitTime[k] = time;
+    projectiles->liveHitKind[k] = (unsigned char)kind;
+    projectiles->liveHitIndex[k] = index;
+}
+
+//sets up a batch drawing the given model's meshes with the instancing shader
+static InstanceBatch LoadInstanceBatch(Model model, Shader instancingShader, int capacity)
+{
+    InstanceBatch batch = {0};
+    batch.model = model;
+    batch.capacity = capacity;
+    batch.transforms = (Matrix *)malloc((capacity > 0 ? capacity : 1) * sizeof(Matrix));
+    batch.IsInstanced = IsShaderReady(instancingShader);
+    batch.bounds = GetModelBoundingSphere(model);
+    
+    //material copies share the model's maps (textures), only the shader differs
+    batch.materials = (Material *)malloc(model.materialCount * sizeof(Material));
+    for(int i = 0; i < model.materialCount; i++){
+        batch.materials[i] = model.materials[i];
+        if(batch.IsInstanced) batch.materials[i].shader = instancingShader;
+    }
+    
+    return batch;
+}
+
+static void UnloadInstanceBatch(InstanceBatch batch)
+{
+    free(batch.transforms);
+    free(batch.materials);
+}
+
+//queues an instance only if the batch's bounding sphere, moved by the instance transform, touches the frustum
+//the model's own transform is applied before the instance transform (same order as DrawModel)
+static bool AddVisibleInstance(InstanceBatch *batch, Frustum *frustum, Matrix transform)
+{
+    Matrix full = MatrixMultiply(batch->model.transform, transform);
+    Vector3 center = Vector3Transform(batch->bounds.center, full);
+    
+    //largest axis scale of the transform, so scaled instances keep a conservative radius
+    float sx = Vector3Length((Vector3){full.m0, full.m1, full.m2});
+    float sy = Vector3Length((Vector3){full.m4, full.m5, full.m6});
+    float sz = Vector3Length((Vector3){full.m8, full.m9, full.m10});
+    float scale = fmaxf(sx, fmaxf(sy, sz));
+    
+    if(!IsSphereInFrustum(frustum, center, batch->bounds.radius * scale)) return false;
+    if(batch->count >= batch->capacity){
+        batch->capacity = batch->capacity*2 + 1;
+        batch->transforms = (Matrix *)realloc(batch->transforms, batch->capacity * sizeof(Matrix));
+    }
+    batch->transforms[batch->count++] = full;
+    return true;
+}
+
+static BoundingSphere GetModelBoundingSphere(Model model)
+{
+    BoundingBox box = GetModelBoundingBox(model);
+    BoundingSphere sphere = {0};
+    sphere.center = Vector3Scale(Vector3Add(box.min, box.max), 0.5f);
+    sphere.radius = Vector3Distance(box.max, sphere.center);
+    return sphere;
+}
+
+//axis aligned box enclosing the eight transformed corners of a box
+static BoundingBox GetTransformedBoundingBox(BoundingBox box, Matrix transform)
+{
+    BoundingBox result = {0};
+    for(int i = 0; i < 8; i++){
+        Vector3 corner = {(i & 1)? box.max.x : box.min.x, (i & 2)? box.max.y : box.min.y, (i & 4)? box.max.z : box.min.z};
+        corner = Vector3Transform(corner, transform);
+        if(i == 0) result.min = result.max = corner;
+        else {
+            result.min = Vector3Min(result.min, corner);
+            result.max = Vector3Max(result.max, corner);
+        }
+    }
+    return result;
+}
+
+//extracts the frustum planes from view * projection (Gribb/Hartmann), using the same projection as BeginMode3D
+static Frustum GetCameraFrustum(Camera camera, float aspect, float farDistance)
+{
+    Matrix view = MatrixLookAt(camera.position, camera.target, camera.up);
+    Matrix proj = MatrixPerspective(camera.fovy * DEG2RAD, aspect, RL_CULL_DISTANCE_NEAR, farDistance);
+    Matrix m = MatrixMultiply(view, proj);
+    
+    Frustum frustum = {0};
+    frustum.planes[0] = (Vector4){m.m3 + m.m0, m.m7 + m.m4, m.m11 + m.m8, m.m15 + m.m12};     //left
+    frustum.planes[1] = (Vector4){m.m3 - m.m0, m.m7 - m.m4, m.m11 - m.m8, m.m15 - m.m12};     //right
+    frustum.planes[2] = (Vector4){m.m3 + m.m1, m.m7 + m.m5, m.m11 + m.m9, m.m15 + m.m13};     //bottom
+    frustum.planes[3] = (Vector4){m.m3 - m.m1, m.m7 - m.m5, m.m11 - m.m9, m.m15 - m.m13};     //top
+    frustum.planes[4] = (Vector4){m.m3 + m.m2, m.m7 + m.m6, m.m11 + m.m10, m.m15 + m.m14};    //near
+    frustum.planes[5] = (Vector4){m.m3 - m.m2, m.m7 - m.m6, m.m11 - m.m10, m.m15 - m.m14};    //far
+    
+    for(int i = 0; i < 6; i++){
+        float length = sqrtf(frustum.planes[i].x*frustum.planes[i].x + frustum.planes[i].y*frustum.planes[i].y + frustum.planes[i].z*frustum.planes[i].z);
+        frustum.planes[i].x /= length;
+        frustum.planes[i].y /= length;
+        frustum.planes[i].z /= length;
+        frustum.planes[i].w /= length;
+    }
+    
+    return frustum;
+}
+
+static bool IsSphereInFrustum(Frustum *frustum, Vector3 center, float radius)
+{
+    frustum->tested++;
+    for(int i = 0; i < 6; i++){
+        Vector4 p = frustum->planes[i];
+        if(p.x*center.x + p.y*center.y + p.z*center.z + p.w < -radius) return false;
+    }
+    frustum->visible++;
+    return true;
+}
+
+//box is outside if its corner furthest along a plane's normal is still behind that plane
+static bool IsBoxInFrustum(Frustum *frustum, BoundingBox box)
+{
+    frustum->tested++;
+    for(int i = 0; i < 6; i++){
+        Vector4 p = frustum->planes[i];
+        Vector3 v = {(p.x >= 0)? box.max.x : box.min.x, (p.y >= 0)? box.max.y : box.min.y, (p.z >= 0)? box.max.z : box.min.z};
+        if(p.x*v.x + p.y*v.y + p.z*v.z + p.w < 0) return false;
+    }
+    frustum->visible++;
+    return true;
+}
+
+//submits all queued instances and empties the batch for the next frame
+static void DrawInstanceBatch(InstanceBatch *batch)
+{
+    if(batch->count == 0) return;
+    
+    for(int m = 0; m < batch->model.meshCount; m++){
+        Material material = batch->materials[batch->model.meshMaterial[m]];
+        if(batch->IsInstanced) DrawMeshInstanced(batch->model.meshes[m], material, batch->transforms, batch->count);
+        else {
+            for(int i = 0; i < batch->count; i++) DrawMesh(batch->model.meshes[m], material, batch->transforms[i]);
+        }
+    }
+    
+    batch->count = 0;
+}
+
+static int CompareStaticInstances(const void *a, const void *b)
+{
+    const StaticInstance *first = (const StaticInstance *)a;
+    const StaticInstance *second = (const StaticInstance *)b;
+    if(first->chunkZ != second->chunkZ) return (first->chunkZ < second->chunkZ)? -1 : 1;
+    if(first->chunkX != second->chunkX) return (first->chunkX < second->chunkX)? -1 : 1;
+    return first->index - second->index;
+}
+
+//merges mesh parts [firstPart, lastPart) of the sorted instances into a world space mesh, part p is mesh p%meshCount of instance p/meshCount
+//only meshes using one material that fit 16 bit indices are taken, stops early when the indices run out and returns the part the next piece starts at
+static int BakeStaticChunk(Model model, const Vector3 *positions, const StaticInstance *instances, int firstPart, int lastPart, int material, StaticChunk *chunk)
+{
+    int vertexCount = 0, indexCount = 0, part = firstPart;
+    for(; part < lastPart; part++){
+        Mesh source = model.meshes[part%model.meshCount];
+        if(model.meshMaterial[part%model.meshCount] != material || source.vertexCount > MaxStaticChunkVertices) continue;
+        if(vertexCount + source.vertexCount > MaxStaticChunkVertices) break;
+        vertexCount += source.vertexCount;
+        indexCount += (source.indices != NULL)? source.triangleCount*3 : source.vertexCount;
+    }
+    
+    Mesh mesh = { 0 };
+    mesh.vertexCount = vertexCount;
+    mesh.triangleCount = indexCount/3;
+    mesh.vertices = (float *)MemAlloc(vertexCount*3*sizeof(float));
+    mesh.texcoords = (float *)MemAlloc(vertexCount*2*sizeof(float));
+    mesh.normals = (float *)MemAlloc(vertexCount*3*sizeof(float));
+    mesh.indices = (unsigned short *)MemAlloc(indexCount*sizeof(unsigned short));
+    
+    BoundingBox bounds = { Vector3Zero(), Vector3Zero() };
+    int vertex = 0, index = 0;
+    for(int p = firstPart; p < part; p++){
+        Mesh source = model.meshes[p%model.meshCount];
+        if(model.meshMaterial[p%model.meshCount] != material || source.vertexCount > MaxStaticChunkVertices) continue;
+        
+        //same order as DrawModel, the model's own transform then the instance position
+        Vector3 pos = positions[instances[p/model.meshCount].index];
+        Matrix transform = MatrixMultiply(model.transform, MatrixTranslate(pos.x, pos.y, pos.z));
+        Matrix rotation = transform;
+        rotation.m12 = rotation.m13 = rotation.m14 = 0.0f;
+        
+        for(int v = 0; v < source.vertexCount; v++){
+            Vector3 world = Vector3Transform((Vector3){source.vertices[v*3], source.vertices[v*3 + 1], source.vertices[v*3 + 2]}, transform);
+            mesh.vertices[(vertex + v)*3] = world.x;
+            mesh.vertices[(vertex + v)*3 + 1] = world.y;
+            mesh.vertices[(vertex + v)*3 + 2] = world.z;
+            if(vertex + v == 0) bounds = (BoundingBox){ world, world };
+            bounds.min = Vector3Min(bounds.min, world);
+            bounds.max = Vector3Max(bounds.max, world);
+            
+            if(source.texcoords != NULL){
+                mesh.texcoords[(vertex + v)*2] = source.texcoords[v*2];
+                mesh.texcoords[(vertex + v)*2 + 1] = source.texcoords[v*2 + 1];
+            }
+            if(source.normals != NULL){
+                Vector3 normal = Vector3Normalize(Vector3Transform((Vector3){source.normals[v*3], source.normals[v*3 + 1], source.normals[v*3 + 2]}, rotation));
+                mesh.normals[(vertex + v)*3] = normal.x;
+                mesh.normals[(vertex + v)*3 + 1] = normal.y;
+                mesh.normals[(vertex + v)*3 + 2] = normal.z;
+            }
+        }
+        
+        if(source.indices != NULL){
+            for(int i = 0; i < source.triangleCount*3; i++) mesh.indices[index++] = (unsigned short)(vertex + source.indices[i]);
+        }
+        else {
+            for(int i = 0; i < source.vertexCount; i++) mesh.indices[index++] = (unsigned short)(vertex + i);
+        }
+        vertex += source.vertexCount;
+    }
+    
+    UploadMesh(&mesh, false);
+    *chunk = (StaticChunk){ mesh, material, bounds };
+    return part;
+}
+
+//instances are grouped into square chunks of the XZ plane by position, every chunk gets one mesh per material it uses
+//(more if it needs over 65535 vertices), so the whole batch draws in a handful of calls and chunks are still culled on their own
+static StaticBatch BakeStaticBatch(Model model, Shader instancingShader, const Vector3 *positions, int count, float chunkSize)
+{
+    StaticBatch batch = { 0 };
+    batch.model = model;
+    if(count <= 0 || model.meshCount <= 0) return batch;
+    
+    StaticInstance *instances = (StaticInstance *)malloc(count*sizeof(StaticInstance));
+    for(int i = 0; i < count; i++){
+        instances[i] = (StaticInstance){ (int)floorf(positions[i].x/chunkSize), (int)floorf(positions[i].z/chunkSize), i };
+    }
+    qsort(instances, count, sizeof(StaticInstance), CompareStaticInstances);
+    
+    int chunkCapacity = 8;
+    batch.chunks = (StaticChunk *)malloc(chunkCapacity*sizeof(StaticChunk));
+    for(int first = 0; first < count;){
+        int last = first + 1;
+        while(last < count && instances[last].chunkX == instances[first].chunkX && instances[last].chunkZ == instances[first].chunkZ) last++;
+        
+        for(int material = 0; material < model.materialCount; material++){
+            bool IsUsed = false;
+            for(int m = 0; m < model.meshCount; m++){
+                if(model.meshMaterial[m] == material && model.meshes[m].vertexCount > 0 && model.meshes[m].vertexCount <= MaxStaticChunkVertices) IsUsed = true;
+            }
+            if(!IsUsed) continue;
+            
+            for(int next = first*model.meshCount; next < last*model.meshCount;){
+                if(batch.chunkCount == chunkCapacity){
+                    chunkCapacity *= 2;
+                    batch.chunks = (StaticChunk *)realloc(batch.chunks, chunkCapacity*sizeof(StaticChunk));
+                }
+                next = BakeStaticChunk(model, positions, instances, next, last*model.meshCount, material, &batch.chunks[batch.chunkCount++]);
+            }
+        }
+        first = last;
+    }
+    free(instances);
+    
+    //meshes no chunk can hold go into a model of their own, drawn instanced at every position
+    for(int m = 0; m < model.meshCount; m++) if(model.meshes[m].vertexCount > MaxStaticChunkVertices) batch.oversized.meshCount++;
+    if(batch.oversized.meshCount > 0){
+        batch.oversized.transform = model.transform;
+        batch.oversized.materials = model.materials;
+        batch.oversized.materialCount = model.materialCount;
+        batch.oversized.meshes = (Mesh *)malloc(batch.oversized.meshCount*sizeof(Mesh));
+        batch.oversized.meshMaterial = (int *)malloc(batch.oversized.meshCount*sizeof(int));
+        for(int m = 0, o = 0; m < model.meshCount; m++){
+            if(model.meshes[m].vertexCount <= MaxStaticChunkVertices) continue;
+            batch.oversized.meshes[o] = model.meshes[m];
+            batch.oversized.meshMaterial[o++] = model.meshMaterial[m];
+        }
+        batch.oversizedBatch = LoadInstanceBatch(batch.oversized, instancingShader, count);
+        batch.positions = (Vector3 *)malloc(count*sizeof(Vector3));
+        memcpy(batch.positions, positions, count*sizeof(Vector3));
+        batch.positionCount = count;
+    }
+    
+    return batch;
+}
+
+static void UnloadStaticBatch(StaticBatch batch)
+{
+    for(int i = 0; i < batch.chunkCount; i++) UnloadMesh(batch.chunks[i].mesh);
+    free(batch.chunks);
+    UnloadInstanceBatch(batch.oversizedBatch);
+    free(batch.oversized.meshes);
+    free(batch.oversized.meshMaterial);
+    free(batch.positions);
+}
+
+//one draw call per chunk that touches the frustum, the vertices are already in world space, then the oversized meshes of every visible instance
+static void DrawStaticBatch(StaticBatch *batch, Frustum *frustum)
+{
+    for(int i = 0; i < batch->chunkCount; i++){
+        if(IsBoxInFrustum(frustum, batch->chunks[i].bounds)) DrawMesh(batch->chunks[i].mesh, batch->model.materials[batch->chunks[i].material], MatrixIdentity());
+    }
+    
+    for(int i = 0; i < batch->positionCount; i++){
+        Vector3 pos = batch->positions[i];
+        AddVisibleInstance(&batch->oversizedBatch, frustum, MatrixTranslate(pos.x, pos.y, pos.z));
+    }
+    DrawInstanceBatch(&batch->oversizedBatch);
+}
+
+//bounds of every vertex in an .obj file, lets the headless simulation build the world without uploading meshes
+static BoundingBox LoadObjBounds(const char *fileName)
+{
+    BoundingBox bounds = { 0 };
+    char *text = LoadFileText(fileName);
+    if(text == NULL) return bounds;
+    
+    bool IsFirstVertex = true;
+    for(char *line = text; line != NULL && *line != '\0'; ){
+        if(line[0] == 'v' && line[1] == ' '){
+            //strtof rather than sscanf, which measures the whole remaining file on every call
+            char *end = line + 2;
+            Vector3 v;
+            v.x = strtof(end, &end);
+            v.y = strtof(end, &end);
+            v.z = strtof(end, &end);
+            if(IsFirstVertex){
+                bounds.min = v;
+                bounds.max = v;
+                IsFirstVertex = false;
+            }
+            else {
+                bounds.min = Vector3Min(bounds.min, v);
+                bounds.max = Vector3Max(bounds.max, v);
+            }
+        }
+        line = strchr(line, '\n');
+        if(line != NULL) line++;
+    }
+    
+    UnloadFileText(text);
+    return bounds;
+}
+
+//every triangle of an .obj file as three corners, polygons are split into fans, NULL if the file can't be read
+static Vector3 *LoadObjTriangles(const char *fileName, int *triangleCount)
+{
+    *triangleCount = 0;
+    char *text = LoadFileText(fileName);
+    if(text == NULL) return NULL;
+    
+    int vertexCount = 0, vertexCapacity = 1024, cornerCount = 0, cornerCapacity = 3072;
+    Vector3 *vertices = (Vector3 *)malloc(vertexCapacity*sizeof(Vector3));
+    Vector3 *corners = (Vector3 *)malloc(cornerCapacity*sizeof(Vector3));
+    for(char *line = text; line != NULL && *line != '\0'; ){
+        if(line[0] == 'v' && line[1] == ' '){
+            if(vertexCount == vertexCapacity){
+                vertexCapacity *= 2;
+                vertices = (Vector3 *)realloc(vertices, vertexCapacity*sizeof(Vector3));
+            }
+            char *end = line + 2;
+            vertices[vertexCount].x = strtof(end, &end);
+            vertices[vertexCount].y = strtof(end, &end);
+            vertices[vertexCount].z = strtof(end, &end);
+            vertexCount++;
+        }
+        else if(line[0] == 'f' && line[1] == ' '){
+            //"f 1/1/1 2/2/2 3/3/3", only the position index of each corner, negative ones count back from the last vertex
+            char *cursor = line + 2;
+            int firstIndex = -1, previousIndex = -1;
+            for(int corner = 0; ; corner++){
+                while(*cursor == ' ' || *cursor == '\t') cursor++;
+                if(*cursor != '-' && (*cursor < '0' || *cursor > '9')) break;
+                long index = strtol(cursor, &cursor, 10);
+                while(*cursor != ' ' && *cursor != '\t' && *cursor != '\r' && *cursor != '\n' && *cursor != '\0') cursor++;
+                index = (index < 0)? vertexCount + index : index - 1;
+                if(index < 0 || index >= vertexCount) break;
+                
+                if(corner >= 2){
+                    if(cornerCount + 3 > cornerCapacity){
+                        cornerCapacity *= 2;
+                        corners = (Vector3 *)realloc(corners, cornerCapacity*sizeof(Vector3));
+                    }
+                    corners[cornerCount++] = vertices[firstIndex];
+                    corners[cornerCount++] = vertices[previousIndex];
+                    corners[cornerCount++] = vertices[index];
+                }
+                if(corner == 0) firstIndex = (int)index;
+                previousIndex = (int)index;
+            }
+        }
+        line = strchr(line, '\n');
+        if(line != NULL) line++;
+    }
+    
+    UnloadFileText(text);
+    free(vertices);
+    *triangleCount = cornerCount/3;
+    return corners;
+}
+//64 bit FNV-1a, a cached asset is rebuilt as soon as its source file hashes differently
+static unsigned long long GetDataHash(const unsigned char *data, int dataSize)
+{
+    unsigned long long hash = 14695981039346656037ULL;
+    for(int i = 0; i < dataSize; i++) hash = (hash ^ data[i])*1099511628211ULL;
+    return hash;
+}
+
+//"The Last Tank/PlayerTank.obj" caches to "The Last Tank/cache/PlayerTank.obj.mesh"
+static void GetAssetCachePath(const char *fileName, const char *extension, char *path, int pathSize)
+{
+    snprintf(path, pathSize, "%s/%s%s", ASSET_CACHE_DIR, GetFileName(fileName), extension);
+}
+
+static bool SaveAssetCache(const char *cachePath, void *data, int dataSize)
+{
+    if(!DirectoryExists(ASSET_CACHE_DIR)) MakeDirectory(ASSET_CACHE_DIR);
+    bool IsSaved = SaveFileData(cachePath, data, dataSize);
+    if(!IsSaved) TraceLog(LOG_WARNING, "CACHE: [%s] Could not write cache, the source will be converted again next launch", cachePath);
+    return IsSaved;
+}
+
+//cache blobs are only read through once to copy their contents out, so they're mapped rather than loaded into a buffer first
+//windows.h can't be included next to raylib, there the blob is still read with LoadFileData
+static unsigned char *MapCacheFile(const char *fileName, int *dataSize)
+{
+    *dataSize = 0;
+#if defined(CACHE_MMAP)
+    int file = open(fileName, O_RDONLY);
+    if(file < 0) return NULL;
+    struct stat info;
+    void *data = MAP_FAILED;
+    if(fstat(file, &info) == 0 && info.st_size > 0 && info.st_size <= 0x7fffffff) data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if(data == MAP_FAILED) return NULL;
+    *dataSize = (int)info.st_size;
+    return (unsigned char *)data;
+#else
+    if(!FileExists(fileName)) return NULL;
+    return LoadFileData(fileName, dataSize);
+#endif
+}
+
+static void UnmapCacheFile(unsigned char *data, int dataSize)
+{
+    if(data == NULL) return;
+#if defined(CACHE_MMAP)
+    munmap(data, (size_t)dataSize);
+#else
+    (void)dataSize;
+    UnloadFileData(data);
+#endif
+}
+
+//bounds checked copy out of a cache blob, returns NULL once the blob runs out
+static const unsigned char *ReadCacheBytes(const unsigned char *cursor, const unsigned char *end, void *dst, int size)
+{
+    if(cursor == NULL || size < 0 || end - cursor < size) return NULL;
+    memcpy(dst, cursor, size);
+    return cursor + size;
+}
+
+//welds identical vertices of a non indexed mesh into shared ones plus a 16 bit index list
+//returns the unique vertex count, or 0 when the mesh is already indexed or would need more than 65535 vertices
+static int WeldMeshVertices(const Mesh *mesh, float *vertices, float *texcoords, float *normals, unsigned short *indices)
+{
+    if(mesh->indices != NULL || mesh->vertexCount <= 0) return 0;
+    
+    int tableSize = 1;
+    while(tableSize < mesh->vertexCount*2) tableSize <<= 1;
+    int *table = (int *)MemAlloc(tableSize*sizeof(int));
+    for(int i = 0; i < tableSize; i++) table[i] = -1;
+    
+    int uniqueCount = 0;
+    for(int i = 0; i < mesh->vertexCount; i++){
+        float vertex[8] = { mesh->vertices[i*3], mesh->vertices[i*3 + 1], mesh->vertices[i*3 + 2] };
+        if(mesh->texcoords != NULL) memcpy(&vertex[3], &mesh->texcoords[i*2], 2*sizeof(float));
+        if(mesh->normals != NULL) memcpy(&vertex[5], &mesh->normals[i*3], 3*sizeof(float));
+        
+        unsigned int hash = (unsigned int)GetDataHash((const unsigned char *)vertex, sizeof(vertex));
+        int slot = hash & (tableSize - 1);
+        while(table[slot] >= 0){
+            int u = table[slot];
+            if(memcmp(&vertices[u*3], &vertex[0], 3*sizeof(float)) == 0 && memcmp(&texcoords[u*2], &vertex[3], 2*sizeof(float)) == 0 &&
+               memcmp(&normals[u*3], &vertex[5], 3*sizeof(float)) == 0) break;
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        if(table[slot] < 0){
+            if(uniqueCount == 65536){
+                MemFree(table);
+                return 0;
+            }
+            memcpy(&vertices[uniqueCount*3], &vertex[0], 3*sizeof(float));
+            memcpy(&texcoords[uniqueCount*2], &vertex[3], 2*sizeof(float));
+            memcpy(&normals[uniqueCount*3], &vertex[5], 3*sizeof(float));
+            table[slot] = uniqueCount++;
+        }
+        indices[i] = (unsigned short)table[slot];
+    }
+    
+    MemFree(table);
+    return uniqueCount;
+}
+
+//packs a freshly parsed model into the cache layout, meshes that can't be welded are stored without indices
+static unsigned char *BuildMeshCache(Model model, unsigned long long sourceHash, int *dataSize)
+{
+    int capacity = sizeof(MeshCacheHeader) + model.materialCount*sizeof(Color) + model.meshCount*sizeof(int);
+    for(int m = 0; m < model.meshCount; m++){
+        capacity += sizeof(MeshCacheEntry) + model.meshes[m].vertexCount*(8*sizeof(float) + sizeof(unsigned short)) + 4;
+    }
+    unsigned char *data = (unsigned char *)MemAlloc(capacity);
+    unsigned char *cursor = data;
+    
+    MeshCacheHeader header = { 0 };
+    memcpy(header.magic, MESH_CACHE_MAGIC, 4);
+    header.version = ASSET_CACHE_VERSION;
+    header.sourceHash = sourceHash;
+    header.meshCount = model.meshCount;
+    header.materialCount = model.materialCount;
+    memcpy(cursor, &header, sizeof(header));
+    cursor += sizeof(header);
+    
+    for(int m = 0; m < model.materialCount; m++){
+        memcpy(cursor, &model.materials[m].maps[MATERIAL_MAP_DIFFUSE].color, sizeof(Color));
+        cursor += sizeof(Color);
+    }
+    memcpy(cursor, model.meshMaterial, model.meshCount*sizeof(int));
+    cursor += model.meshCount*sizeof(int);
+    
+    for(int m = 0; m < model.meshCount; m++){
+        const Mesh *mesh = &model.meshes[m];
+        MeshCacheEntry entry = { mesh->vertexCount, mesh->triangleCount, 0 };
+        unsigned char *entryCursor = cursor;
+        cursor += sizeof(entry);
+        
+        float *vertices = (float *)cursor;
+        float *texcoords = vertices + mesh->vertexCount*3;
+        float *normals = texcoords + mesh->vertexCount*2;
+        unsigned short *indices = (unsigned short *)MemAlloc(mesh->vertexCount*sizeof(unsigned short));
+        int uniqueCount = WeldMeshVertices(mesh, vertices, texcoords, normals, indices);
+        
+        //welded arrays were written at the non welded spacing, close the gaps between them
+        if(uniqueCount > 0){
+            entry.vertexCount = uniqueCount;
+            entry.indexCount = mesh->vertexCount;
+            memmove(vertices + uniqueCount*3, texcoords, uniqueCount*2*sizeof(float));
+            memmove(vertices + uniqueCount*5, normals, uniqueCount*3*sizeof(float));
+            cursor += uniqueCount*8*sizeof(float);
+            memcpy(cursor, indices, entry.indexCount*sizeof(unsigned short));
+            cursor += (entry.indexCount*sizeof(unsigned short) + 3) & ~3;
+        }
+        else {
+            memcpy(vertices, mesh->vertices, mesh->vertexCount*3*sizeof(float));
+            if(mesh->texcoords != NULL) memcpy(texcoords, mesh->texcoords, mesh->vertexCount*2*sizeof(float));
+            else memset(texcoords, 0, mesh->vertexCount*2*sizeof(float));
+            if(mesh->normals != NULL) memcpy(normals, mesh->normals, mesh->vertexCount*3*sizeof(float));
+            else memset(normals, 0, mesh->vertexCount*3*sizeof(float));
+            cursor += mesh->vertexCount*8*sizeof(float);
+        }
+        MemFree(indices);
+        memcpy(entryCursor, &entry, sizeof(entry));
+    }
+    
+    *dataSize = (int)(cursor - data);
+    return data;
+}
+
+//frees a model that never reached the GPU, UnloadModel also deletes vertex arrays and so has to stay on the main thread
+static void UnloadDecodedModel(Model model)
+{
+    for(int m = 0; m < model.meshCount; m++){
+        MemFree(model.meshes[m].vertices);
+        MemFree(model.meshes[m].texcoords);
+        MemFree(model.meshes[m].normals);
+        MemFree(model.meshes[m].indices);
+    }
+    for(int m = 0; m < model.materialCount; m++) MemFree(model.materials[m].maps);
+    MemFree(model.meshes);
+    MemFree(model.materials);
+    MemFree(model.meshMaterial);
+}
+
+//rebuilds a model's CPU side from a cache blob, no text parsing, false if the blob is stale or damaged
+//the meshes still need UploadMesh, everything before that is safe on a loader worker
+static bool LoadModelFromCache(const unsigned char *data, int dataSize, unsigned long long sourceHash, Model *model)
+{
+    const unsigned char *end = data + dataSize;
+    MeshCacheHeader header;
+    const unsigned char *cursor = ReadCacheBytes(data, end, &header, sizeof(header));
+    if(cursor == NULL || memcmp(header.magic, MESH_CACHE_MAGIC, 4) != 0 || header.version != ASSET_CACHE_VERSION ||
+       header.sourceHash != sourceHash || header.meshCount <= 0 || header.materialCount <= 0 ||
+       header.meshCount > dataSize || header.materialCount > dataSize) return false;
+    
+    Model cached = { 0 };
+    cached.transform = MatrixIdentity();
+    cached.meshCount = header.meshCount;
+    cached.materialCount = header.materialCount;
+    cached.meshes = (Mesh *)MemAlloc(cached.meshCount*sizeof(Mesh));
+    cached.materials = (Material *)MemAlloc(cached.materialCount*sizeof(Material));
+    cached.meshMaterial = (int *)MemAlloc(cached.meshCount*sizeof(int));
+    
+    for(int m = 0; m < cached.materialCount; m++){
+        cached.materials[m] = LoadMaterialDefault();
+        cursor = ReadCacheBytes(cursor, end, &cached.materials[m].maps[MATERIAL_MAP_DIFFUSE].color, sizeof(Color));
+    }
+    cursor = ReadCacheBytes(cursor, end, cached.meshMaterial, cached.meshCount*sizeof(int));
+    for(int m = 0; cursor != NULL && m < cached.meshCount; m++){
+        if(cached.meshMaterial[m] < 0 || cached.meshMaterial[m] >= cached.materialCount) cursor = NULL;
+    }
+    
+    for(int m = 0; cursor != NULL && m < cached.meshCount; m++){
+        MeshCacheEntry entry;
+        cursor = ReadCacheBytes(cursor, end, &entry, sizeof(entry));
+        if(cursor == NULL || entry.vertexCount <= 0 || entry.vertexCount > dataSize/32 || entry.indexCount < 0 || entry.indexCount > dataSize/2){
+            cursor = NULL;
+            break;
+        }
+        
+        Mesh *mesh = &cached.meshes[m];
+        mesh->vertexCount = entry.vertexCount;
+        mesh->triangleCount = entry.triangleCount;
+        mesh->vertices = (float *)MemAlloc(entry.vertexCount*3*sizeof(float));
+        mesh->texcoords = (float *)MemAlloc(entry.vertexCount*2*sizeof(float));
+        mesh->normals = (float *)MemAlloc(entry.vertexCount*3*sizeof(float));
+        cursor = ReadCacheBytes(cursor, end, mesh->vertices, entry.vertexCount*3*sizeof(float));
+        cursor = ReadCacheBytes(cursor, end, mesh->texcoords, entry.vertexCount*2*sizeof(float));
+        cursor = ReadCacheBytes(cursor, end, mesh->normals, entry.vertexCount*3*sizeof(float));
+        if(entry.indexCount > 0){
+            mesh->indices = (unsigned short *)MemAlloc(entry.indexCount*sizeof(unsigned short));
+            cursor = ReadCacheBytes(cursor, end, mesh->indices, entry.indexCount*sizeof(unsigned short));
+            unsigned short padding;
+            if(entry.indexCount%2 == 1) cursor = ReadCacheBytes(cursor, end, &padding, sizeof(padding));
+            for(int i = 0; cursor != NULL && i < entry.indexCount; i++){
+                if(mesh->indices[i] >= entry.vertexCount) cursor = NULL;
+            }
+        }
+    }
+    
+    if(cursor == NULL){
+        UnloadDecodedModel(cached);
+        return false;
+    }
+    
+    *model = cached;
+    return true;
+}
+
+//copies one whitespace separated name, such as a material or file name, returns the end of the line
+static const char *ReadObjName(const char *cursor, char *name, int nameSize)
+{
+    int length = 0;
+    while(*cursor == ' ' || *cursor == '\t') cursor++;
+    while(*cursor != '\0' && *cursor != '\r' && *cursor != '\n'){
+        if(length < nameSize - 1) name[length++] = *cursor;
+        cursor++;
+    }
+    while(length > 0 && (name[length - 1] == ' ' || name[length - 1] == '\t')) length--;
+    name[length] = '\0';
+    return cursor;
+}
+
+//reads the newmtl names and their Kd colors from the .mtl next to an .obj file, returns the material count
+static int LoadObjMaterials(const char *objFileName, const char *mtlName, char names[][64], Color *colors)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", GetDirectoryPath(objFileName), mtlName);
+    char *text = LoadFileText(path);
+    if(text == NULL) return 0;
+    
+    int count = 0;
+    for(char *line = text; line != NULL && *line != '\0'; ){
+        while(*line == ' ' || *line == '\t') line++;
+        if(strncmp(line, "newmtl", 6) == 0 && (line[6] == ' ' || line[6] == '\t') && count < MaxObjMaterials){
+            ReadObjName(line + 6, names[count], 64);
+            colors[count++] = WHITE;
+        }
+        else if(line[0] == 'K' && line[1] == 'd' && (line[2] == ' ' || line[2] == '\t') && count > 0){
+            char *end = line + 2;
+            float r = strtof(end, &end), g = strtof(end, &end), b = strtof(end, &end);
+            colors[count - 1] = (Color){ (unsigned char)(r*255.0f), (unsigned char)(g*255.0f), (unsigned char)(b*255.0f), 255 };
+        }
+        line = strchr(line, '\n');
+        if(line != NULL) line++;
+    }
+    
+    UnloadFileText(text);
+    return count;
+}
+
+//CPU only .obj reader for the loader workers, LoadModel uploads every mesh as it parses and has to stay on the render thread
+//follows LoadModel's layout: one unindexed mesh per material the faces use, polygons split into fans, v flipped, Kd as the diffuse color
+static bool ParseObjModel(const char *fileName, const char *text, Model *model)
+{
+    char materialNames[MaxObjMaterials][64];
+    Color materialColors[MaxObjMaterials];
+    int materialCount = 0, material = 0;
+    
+    int positionCount = 0, positionCapacity = 1024, texcoordCount = 0, texcoordCapacity = 1024, normalCount = 0, normalCapacity = 1024;
+    int cornerCount = 0, cornerCapacity = 3072;
+    float *positions = (float *)malloc(positionCapacity*3*sizeof(float));
+    float *texcoords = (float *)malloc(texcoordCapacity*2*sizeof(float));
+    float *normals = (float *)malloc(normalCapacity*3*sizeof(float));
+    int *corners = (int *)malloc(cornerCapacity*4*sizeof(int));     //position, texcoord, normal (-1 when missing) and material of every triangle corner
+    
+    for(const char *line = text; line != NULL && *line != '\0'; ){
+        char *end = (char *)line + 2;
+        if(line[0] == 'v' && line[1] == ' '){
+            if(positionCount == positionCapacity){
+                positionCapacity *= 2;
+                positions = (float *)realloc(positions, positionCapacity*3*sizeof(float));
+            }
+            for(int k = 0; k < 3; k++) positions[positionCount*3 + k] = strtof(end, &end);
+            positionCount++;
+        }
+        else if(line[0] == 'v' && line[1] == 't' && (line[2] == ' ' || line[2] == '\t')){
+            if(texcoordCount == texcoordCapacity){
+                texcoordCapacity *= 2;
+                texcoords = (float *)realloc(texcoords, texcoordCapacity*2*sizeof(float));
+            }
+            end++;
+            texcoords[texcoordCount*2] = strtof(end, &end);
+            texcoords[texcoordCount*2 + 1] = 1.0f - strtof(end, &end);
+            texcoordCount++;
+        }
+        else if(line[0] == 'v' && line[1] == 'n' && (line[2] == ' ' || line[2] == '\t')){
+            if(normalCount == normalCapacity){
+                normalCapacity *= 2;
+                normals = (float *)realloc(normals, normalCapacity*3*sizeof(float));
+            }
+            end++;
+            for(int k = 0; k < 3; k++) normals[normalCount*3 + k] = strtof(end, &end);
+            normalCount++;
+        }
+        else if(line[0] == 'f' && line[1] == ' '){
+            //"f 1/1/1 2//2 3", negative indices count back from the last one read
+            int first[3] = { -1, -1, -1 }, previous[3] = { -1, -1, -1 };
+            for(int corner = 0; ; corner++){
+                while(*end == ' ' || *end == '\t') end++;
+                if(*end != '-' && (*end < '0' || *end > '9')) break;
+                long index[3] = { strtol(end, &end, 10), 0, 0 };
+                if(*end == '/'){
+                    end++;
+                    if(*end != '/') index[1] = strtol(end, &end, 10);
+                    if(*end == '/'){
+                        end++;
+                        index[2] = strtol(end, &end, 10);
+                    }
+                }
+                const int counts[3] = { positionCount, texcoordCount, normalCount };
+                int resolved[3];
+                for(int k = 0; k < 3; k++){
+                    long i = (index[k] < 0)? counts[k] + index[k] : index[k] - 1;
+                    resolved[k] = (i >= 0 && i < counts[k])? (int)i : -1;
+                }
+                if(resolved[0] < 0) break;
+                
+                if(corner >= 2){
+                    if(cornerCount + 3 > cornerCapacity){
+                        cornerCapacity *= 2;
+                        corners = (int *)realloc(corners, cornerCapacity*4*sizeof(int));
+                    }
+                    const int *triangle[3] = { first, previous, resolved };
+                    for(int t = 0; t < 3; t++){
+                        memcpy(&corners[cornerCount*4], triangle[t], 3*sizeof(int));
+                        corners[cornerCount*4 + 3] = material;
+                        cornerCount++;
+                    }
+                }
+                if(corner == 0) memcpy(first, resolved, sizeof(first));
+                memcpy(previous, resolved, sizeof(previous));
+            }
+        }
+        else if(strncmp(line, "mtllib", 6) == 0 && (line[6] == ' ' || line[6] == '\t')){
+            char mtlName[256];
+            ReadObjName(line + 6, mtlName, sizeof(mtlName));
+            materialCount = LoadObjMaterials(fileName, mtlName, materialNames, materialColors);
+        }
+        else if(strncmp(line, "usemtl", 6) == 0 && (line[6] == ' ' || line[6] == '\t')){
+            char name[64];
+            ReadObjName(line + 6, name, sizeof(name));
+            material = 0;
+            for(int m = 0; m < materialCount; m++) if(strcmp(name, materialNames[m]) == 0) material = m;
+        }
+        line = strchr(line, '\n');
+        if(line != NULL) line++;
+    }
+    
+    //a model without a .mtl still gets one default material
+    if(materialCount == 0){
+        materialColors[0] = WHITE;
+        materialCount = 1;
+    }
+    
+    Model parsed = { 0 };
+    parsed.transform = MatrixIdentity();
+    parsed.materialCount = materialCount;
+    parsed.materials = (Material *)MemAlloc(materialCount*sizeof(Material));
+    parsed.meshes = (Mesh *)MemAlloc(materialCount*sizeof(Mesh));
+    parsed.meshMaterial = (int *)MemAlloc(materialCount*sizeof(int));
+    for(int m = 0; m < materialCount; m++){
+        parsed.materials[m] = LoadMaterialDefault();
+        parsed.materials[m].maps[MATERIAL_MAP_DIFFUSE].color = materialColors[m];
+        
+        int count = 0;
+        for(int c = 0; c < cornerCount; c++) if(corners[c*4 + 3] == m) count++;
+        if(count == 0) continue;
+        
+        Mesh *mesh = &parsed.meshes[parsed.meshCount];
+        parsed.meshMaterial[parsed.meshCount++] = m;
+        mesh->vertexCount = count;
+        mesh->triangleCount = count/3;
+        mesh->vertices = (float *)MemAlloc(count*3*sizeof(float));
+        mesh->texcoords = (float *)MemAlloc(count*2*sizeof(float));
+        mesh->normals = (float *)MemAlloc(count*3*sizeof(float));
+        for(int c = 0, v = 0; c < cornerCount; c++){
+            const int *corner = &corners[c*4];
+            if(corner[3] != m) continue;
+            memcpy(&mesh->vertices[v*3], &positions[corner[0]*3], 3*sizeof(float));
+            if(corner[1] >= 0) memcpy(&mesh->texcoords[v*2], &texcoords[corner[1]*2], 2*sizeof(float));
+            if(corner[2] >= 0) memcpy(&mesh->normals[v*3], &normals[corner[2]*3], 3*sizeof(float));
+            v++;
+        }
+    }
+    
+    free(positions);
+    free(texcoords);
+    free(normals);
+    free(corners);
+    if(parsed.meshCount == 0){
+        UnloadDecodedModel(parsed);
+        return false;
+    }
+    *model = parsed;
+    return true;
+}
+
+//CPU half of loading a model through the cache, safe on a loader worker, false only when the source can't be read or parsed
+//a missing or stale cache is rebuilt here from the .obj, so the render thread never parses text
+static bool DecodeCachedModel(const char *fileName, Model *model, unsigned long long *sourceHash)
+{
+    char cachePath[512];
+    GetAssetCachePath(fileName, ".mesh", cachePath, sizeof(cachePath));
+    
+    int sourceSize = 0;
+    unsigned char *source = LoadFileData(fileName, &sourceSize);
+    if(source == NULL) return false;
+    *sourceHash = GetDataHash(source, sourceSize);
+    
+    int cacheSize = 0;
+    unsigned char *cache = MapCacheFile(cachePath, &cacheSize);
+    bool IsDecoded = (cache != NULL) && LoadModelFromCache(cache, cacheSize, *sourceHash, model);
+    UnmapCacheFile(cache, cacheSize);
+    
+    //first launch or the source changed, parse it once and load through the cache so both paths give the same mesh
+    if(!IsDecoded && IsFileExtension(fileName, ".obj")){
+        char *text = (char *)MemAlloc(sourceSize + 1);      //zeroed, so the copy of the file ends in a terminator
+        memcpy(text, source, sourceSize);
+        Model parsed = { 0 };
+        if(ParseObjModel(fileName, text, &parsed)){
+            unsigned char *converted = BuildMeshCache(parsed, *sourceHash, &cacheSize);
+            IsDecoded = LoadModelFromCache(converted, cacheSize, *sourceHash, model);
+            if(IsDecoded && SaveAssetCache(cachePath, converted, cacheSize)) TraceLog(LOG_INFO, "CACHE: [%s] Converted to %s", fileName, cachePath);
+            MemFree(converted);
+            UnloadDecodedModel(parsed);
+        }
+        MemFree(text);
+    }
+    UnloadFileData(source);
+    return IsDecoded;
+}
+
+//GPU half, uploads a decoded model, LoadModel is only left for files the workers could not parse
+static Model UploadCachedModel(const char *fileName, Model model, bool IsDecoded)
+{
+    if(!IsDecoded) return LoadModel(fileName);
+    for(int m = 0; m < model.meshCount; m++) UploadMesh(&model.meshes[m], false);
+    return model;
+}
+
+//rebuilds a BVH from a cache blob, false if the blob is stale or damaged, children always come after their parent so depth is checked in one pass
+static bool LoadTriangleBvhFromCache(const unsigned char *data, int dataSize, unsigned long long sourceHash, TriangleBvh *bvh)
+{
+    const unsigned char *end = data + dataSize;
+    BvhCacheHeader header;
+    const unsigned char *cursor = ReadCacheBytes(data, end, &header, sizeof(header));
+    if(cursor == NULL || memcmp(header.magic, BVH_CACHE_MAGIC, 4) != 0 || header.version != ASSET_CACHE_VERSION ||
+       header.sourceHash != sourceHash || header.triangleCount <= 0 || header.triangleCount > dataSize/(int)(3*sizeof(Vector3)) ||
+       header.nodeCount <= 0 || header.nodeCount > 2*header.triangleCount - 1) return false;
+    
+    TriangleBvh cached = { 0 };
+    cached.nodeCount = header.nodeCount;
+    cached.triangleCount = header.triangleCount;
+    cached.nodes = (BvhNode *)malloc(cached.nodeCount*sizeof(BvhNode));
+    cached.vertices = (Vector3 *)malloc(cached.triangleCount*3*sizeof(Vector3));
+    cursor = ReadCacheBytes(cursor, end, cached.nodes, cached.nodeCount*sizeof(BvhNode));
+    cursor = ReadCacheBytes(cursor, end, cached.vertices, cached.triangleCount*3*sizeof(Vector3));
+    
+    unsigned char *depth = (unsigned char *)calloc(cached.nodeCount, sizeof(unsigned char));
+    for(int i = 0; cursor != NULL && i < cached.nodeCount; i++){
+        const BvhNode *node = &cached.nodes[i];
+        if(node->triangleCount > 0){
+            if(node->first < 0 || node->triangleCount > cached.triangleCount - node->first) cursor = NULL;
+        }
+        else if(node->triangleCount < 0 || node->first <= i || node->first > cached.nodeCount - 2 || depth[i] >= MaxBvhDepth - 1) cursor = NULL;
+        else depth[node->first] = depth[node->first + 1] = depth[i] + 1;
+    }
+    free(depth);
+    
+    if(cursor == NULL){
+        UnloadTriangleBvh(cached);
+        return false;
+    }
+    
+    *bvh = cached;
+    return true;
+}
+
+//BVH over an .obj's triangles, built on the first launch and read from the cache afterwards, empty if the file can't be read
+static TriangleBvh LoadTriangleBvh(const char *fileName)
+{
+    TriangleBvh bvh = { 0 };
+    int sourceSize = 0;
+    unsigned char *source = LoadFileData(fileName, &sourceSize);
+    if(source == NULL) return bvh;
+    unsigned long long sourceHash = GetDataHash(source, sourceSize);
+    UnloadFileData(source);
+    
+    char cachePath[512];
+    GetAssetCachePath(fileName, ".bvh", cachePath, sizeof(cachePath));
+    int cacheSize = 0;
+    unsigned char *cache = MapCacheFile(cachePath, &cacheSize);
+    bool IsCached = (cache != NULL) && LoadTriangleBvhFromCache(cache, cacheSize, sourceHash, &bvh);
+    UnmapCacheFile(cache, cacheSize);
+    if(IsCached) return bvh;
+    
+    int triangleCount = 0;
+    Vector3 *vertices = LoadObjTriangles(fileName, &triangleCount);
+    bvh = BuildTriangleBvh(vertices, triangleCount);
+    if(bvh.nodeCount <= 0) return bvh;
+    
+    BvhCacheHeader header = { 0 };
+    memcpy(header.magic, BVH_CACHE_MAGIC, 4);
+    header.version = ASSET_CACHE_VERSION;
+    header.sourceHash = sourceHash;
+    header.nodeCount = bvh.nodeCount;
+    header.triangleCount = bvh.triangleCount;
+    int dataSize = sizeof(header) + bvh.nodeCount*sizeof(BvhNode) + bvh.triangleCount*3*sizeof(Vector3);
+    unsigned char *data = (unsigned char *)malloc(dataSize);
+    memcpy(data, &header, sizeof(header));
+    memcpy(data + sizeof(header), bvh.nodes, bvh.nodeCount*sizeof(BvhNode));
+    memcpy(data + sizeof(header) + bvh.nodeCount*sizeof(BvhNode), bvh.vertices, bvh.triangleCount*3*sizeof(Vector3));
+    if(SaveAssetCache(cachePath, data, dataSize)) TraceLog(LOG_INFO, "CACHE: [%s] Built a BVH of %d nodes over %d triangles", fileName, bvh.nodeCount, bvh.triangleCount);
+    free(data);
+    return bvh;
+}
+
+//adds a plane's outer product with itself to a quadric, stored as the upper triangle of the 4x4 matrix
+static void AddPlaneToQuadric(double *quadric, Vector3 normal, float distance)
+{
+    double plane[4] = { normal.x, normal.y, normal.z, distance };
+    int k = 0;
+    for(int i = 0; i < 4; i++){
+        for(int j = i; j < 4; j++) quadric[k++] += plane[i]*plane[j];
+    }
+}
+
+//sum of squared distances from a point to every plane in the quadric
+static double GetQuadricError(const double *q, Vector3 v)
+{
+    double x = v.x, y = v.y, z = v.z;
+    return q[0]*x*x + 2*q[1]*x*y + 2*q[2]*x*z + 2*q[3]*x + q[4]*y*y + 2*q[5]*y*z + 2*q[6]*y + q[7]*z*z + 2*q[8]*z + q[9];
+}
+
+//cost of collapsing edge (a, b) and where the merged vertex goes, the quadric's minimum when it is solvable and stays near the edge,
+//otherwise the cheaper of the two ends and the midpoint, border edges always stay on the border
+static double GetCollapseError(const Simplifier *simplifier, int a, int b, Vector3 *result)
+{
+    const SimplifyVertex *va = &simplifier->vertices[a];
+    const SimplifyVertex *vb = &simplifier->vertices[b];
+    double q[10];
+    for(int i = 0; i < 10; i++) q[i] = va->quadric[i] + vb->quadric[i];
+    
+    Vector3 candidates[4];
+    int candidateCount = 0;
+    
+    //solving [q0 q1 q2; q1 q4 q5; q2 q5 q7] p = -[q3 q6 q8] by Cramer's rule
+    double det = q[0]*(q[4]*q[7] - q[5]*q[5]) - q[1]*(q[1]*q[7] - q[5]*q[2]) + q[2]*(q[1]*q[5] - q[4]*q[2]);
+    if(fabs(det) > 1e-12 && !(va->IsBorder && vb->IsBorder)){
+        Vector3 optimal = {
+            (float)(-(q[3]*(q[4]*q[7] - q[5]*q[5]) - q[1]*(q[6]*q[7] - q[5]*q[8]) + q[2]*(q[6]*q[5] - q[4]*q[8]))/det),
+            (float)(-(q[0]*(q[6]*q[7] - q[8]*q[5]) - q[3]*(q[1]*q[7] - q[5]*q[2]) + q[2]*(q[1]*q[8] - q[6]*q[2]))/det),
+            (float)(-(q[0]*(q[4]*q[8] - q[5]*q[6]) - q[1]*(q[1]*q[8] - q[6]*q[2]) + q[3]*(q[1]*q[5] - q[4]*q[2]))/det)
+        };
+        
+        //nearly flat neighbourhoods give a badly conditioned minimum that can land anywhere on the plane
+        if(Vector3Distance(optimal, Vector3Lerp(va->pos, vb->pos, 0.5f)) <= Vector3Distance(va->pos, vb->pos)) candidates[candidateCount++] = optimal;
+    }
+    candidates[candidateCount++] = Vector3Lerp(va->pos, vb->pos, 0.5f);
+    candidates[candidateCount++] = va->pos;
+    candidates[candidateCount++] = vb->pos;
+    
+    double error = GetQuadricError(q, candidates[0]);
+    *result = candidates[0];
+    for(int i = 1; i < candidateCount; i++){
+        double candidateError = GetQuadricError(q, candidates[i]);
+        if(candidateError < error){
+            error = candidateError;
+            *result = candidates[i];
+        }
+    }
+    
+    return error;
+}
+
+static void UpdateTriangleErrors(const Simplifier *simplifier, SimplifyTriangle *triangle)
+{
+    Vector3 unused;
+    for(int j = 0; j < 3; j++) triangle->error[j] = GetCollapseError(simplifier, triangle->v[j], triangle->v[(j + 1)%3], &unused);
+    triangle->error[3] = fmin(triangle->error[0], fmin(triangle->error[1], triangle->error[2]));
+}
+
+//drops deleted triangles and rebuilds every vertex's list of triangles, the first time also finds the border vertices
+//and sums each triangle's plane into the quadrics of its corners
+static void UpdateSimplifierMesh(Simplifier *simplifier, bool IsFirst)
+{
+    int kept = 0;
+    for(int i = 0; i < simplifier->triangleCount; i++){
+        if(!simplifier->triangles[i].IsDeleted) simplifier->triangles[kept++] = simplifier->triangles[i];
+    }
+    simplifier->triangleCount = kept;
+    
+    for(int i = 0; i < simplifier->vertexCount; i++) simplifier->vertices[i].refCount = 0;
+    for(int i = 0; i < simplifier->triangleCount; i++){
+        for(int j = 0; j < 3; j++) simplifier->vertices[simplifier->triangles[i].v[j]].refCount++;
+    }
+    int refStart = 0, maxRefCount = 0;
+    for(int i = 0; i < simplifier->vertexCount; i++){
+        simplifier->vertices[i].refStart = refStart;
+        refStart += simplifier->vertices[i].refCount;
+        if(simplifier->vertices[i].refCount > maxRefCount) maxRefCount = simplifier->vertices[i].refCount;
+        simplifier->vertices[i].refCount = 0;
+    }
+    if(simplifier->refCapacity < refStart){
+        simplifier->refCapacity = refStart;
+        simplifier->refs = (SimplifyRef *)realloc(simplifier->refs, simplifier->refCapacity*sizeof(SimplifyRef));
+    }
+    for(int i = 0; i < simplifier->triangleCount; i++){
+        for(int j = 0; j < 3; j++){
+            SimplifyVertex *vertex = &simplifier->vertices[simplifier->triangles[i].v[j]];
+            simplifier->refs[vertex->refStart + vertex->refCount++] = (SimplifyRef){ i, j };
+        }
+    }
+    simplifier->refCount = refStart;
+    
+    if(!IsFirst) return;
+    
+    //an edge only one triangle uses is on the border, counting how many of a vertex's triangles each neighbour is in finds them
+    int *neighbours = (int *)malloc((maxRefCount*3 + 1)*sizeof(int));
+    int *neighbourUses = (int *)malloc((maxRefCount*3 + 1)*sizeof(int));
+    for(int i = 0; i < simplifier->vertexCount; i++) simplifier->vertices[i].IsBorder = false;
+    for(int i = 0; i < simplifier->vertexCount; i++){
+        const SimplifyVertex *vertex = &simplifier->vertices[i];
+        int neighbourCount = 0;
+        for(int k = 0; k < vertex->refCount; k++){
+            const SimplifyTriangle *triangle = &simplifier->triangles[simplifier->refs[vertex->refStart + k].triangle];
+            for(int j = 0; j < 3; j++){
+                int n = 0;
+                while(n < neighbourCount && neighbours[n] != triangle->v[j]) n++;
+                if(n == neighbourCount){
+                    neighbours[neighbourCount] = triangle->v[j];
+                    neighbourUses[neighbourCount++] = 0;
+                }
+                neighbourUses[n]++;
+            }
+        }
+        for(int n = 0; n < neighbourCount; n++){
+            if(neighbourUses[n] == 1) simplifier->vertices[neighbours[n]].IsBorder = true;
+        }
+    }
+    free(neighbours);
+    free(neighbourUses);
+    
+    for(int i = 0; i < simplifier->vertexCount; i++) memset(simplifier->vertices[i].quadric, 0, sizeof(simplifier->vertices[i].quadric));
+    for(int i = 0; i < simplifier->triangleCount; i++){
+        SimplifyTriangle *triangle = &simplifier->triangles[i];
+        Vector3 p0 = simplifier->vertices[triangle->v[0]].pos;
+        Vector3 p1 = simplifier->vertices[triangle->v[1]].pos;
+        Vector3 p2 = simplifier->vertices[triangle->v[2]].pos;
+        triangle->normal = Vector3Normalize(Vector3CrossProduct(Vector3Subtract(p1, p0), Vector3Subtract(p2, p0)));
+        for(int j = 0; j < 3; j++) AddPlaneToQuadric(simplifier->vertices[triangle->v[j]].quadric, triangle->normal, -Vector3DotProduct(triangle->normal, p0));
+    }
+    for(int i = 0; i < simplifier->triangleCount; i++) UpdateTriangleErrors(simplifier, &simplifier->triangles[i]);
+}
+
+//true if moving vertex a to pos folds one of its triangles over, collapsing marks the triangles that also use b and will vanish
+static bool IsCollapseFlipping(const Simplifier *simplifier, int a, int b, Vector3 pos, unsigned char *collapsing)
+{
+    const SimplifyVertex *vertex = &simplifier->vertices[a];
+    for(int k = 0; k < vertex->refCount; k++){
+        SimplifyRef ref = simplifier->refs[vertex->refStart + k];
+        const SimplifyTriangle *triangle = &simplifier->triangles[ref.triangle];
+        collapsing[k] = 0;
+        if(triangle->IsDeleted) continue;
+        
+        int id1 = triangle->v[(ref.corner + 1)%3];
+        int id2 = triangle->v[(ref.corner + 2)%3];
+        if(id1 == b || id2 == b){
+            collapsing[k] = 1;
+            continue;
+        }
+        
+        Vector3 d1 = Vector3Normalize(Vector3Subtract(simplifier->vertices[id1].pos, pos));
+        Vector3 d2 = Vector3Normalize(Vector3Subtract(simplifier->vertices[id2].pos, pos));
+        if(fabsf(Vector3DotProduct(d1, d2)) > 0.999f) return true;
+        Vector3 normal = Vector3Normalize(Vector3CrossProduct(d1, d2));
+        if(Vector3DotProduct(normal, triangle->normal) < 0.2f) return true;
+    }
+    return false;
+}
+
+//points vertex's triangles at kept, deleting the ones the collapse flattens, and appends the rest to the end of the refs
+static void UpdateCollapsedTriangles(Simplifier *simplifier, int kept, int vertex, const unsigned char *collapsing, int *liveCount)
+{
+    int refStart = simplifier->vertices[vertex].refStart;
+    int refCount = simplifier->vertices[vertex].refCount;
+    for(int k = 0; k < refCount; k++){
+        SimplifyRef ref = simplifier->refs[refStart + k];
+        SimplifyTriangle *triangle = &simplifier->triangles[ref.triangle];
+        if(triangle->IsDeleted) continue;
+        if(collapsing[k]){
+            triangle->IsDeleted = true;
+            (*liveCount)--;
+            continue;
+        }
+        
+        triangle->v[ref.corner] = kept;
+        triangle->IsDirty = true;
+        UpdateTriangleErrors(simplifier, triangle);
+        if(simplifier->refCount == simplifier->refCapacity){
+            simplifier->refCapacity *= 2;
+            simplifier->refs = (SimplifyRef *)realloc(simplifier->refs, simplifier->refCapacity*sizeof(SimplifyRef));
+        }
+        simplifier->refs[simplifier->refCount++] = ref;
+    }
+}
+
+//quadric edge collapse (Garland and Heckbert) down to targetCount triangles, instead of a priority queue every pass collapses
+//the edges under a threshold that grows each pass, triangles touched by a collapse wait for the next pass
+static void SimplifyMesh(Simplifier *simplifier, int targetCount)
+{
+    UpdateSimplifierMesh(simplifier, true);
+    int liveCount = simplifier->triangleCount;
+    unsigned char *collapsing = NULL;
+    int collapsingCapacity = 0;
+    
+    for(int pass = 0; pass < 100 && liveCount > targetCount; pass++){
+        if(pass > 0 && pass%5 == 0) UpdateSimplifierMesh(simplifier, false);
+        for(int i = 0; i < simplifier->triangleCount; i++) simplifier->triangles[i].IsDirty = false;
+        double threshold = 1e-9*pow(pass + 3, 7);
+        
+        for(int i = 0; i < simplifier->triangleCount && liveCount > targetCount; i++){
+            SimplifyTriangle *triangle = &simplifier->triangles[i];
+            if(triangle->IsDeleted || triangle->IsDirty || triangle->error[3] > threshold) continue;
+            
+            for(int j = 0; j < 3; j++){
+                if(triangle->error[j] > threshold) continue;
+                int a = triangle->v[j];
+                int b = triangle->v[(j + 1)%3];
+                SimplifyVertex *va = &simplifier->vertices[a];
+                SimplifyVertex *vb = &simplifier->vertices[b];
+                if(va->IsBorder != vb->IsBorder) continue;
+                
+                Vector3 pos;
+                GetCollapseError(simplifier, a, b, &pos);
+                if(collapsingCapacity < va->refCount + vb->refCount){
+                    collapsingCapacity = (va->refCount + vb->refCount)*2;
+                    collapsing = (unsigned char *)realloc(collapsing, collapsingCapacity);
+                }
+                if(IsCollapseFlipping(simplifier, a, b, pos, collapsing) || IsCollapseFlipping(simplifier, b, a, pos, collapsing + va->refCount)) continue;
+                
+                va->pos = pos;
+                for(int q = 0; q < 10; q++) va->quadric[q] += vb->quadric[q];
+                int refStart = simplifier->refCount;
+                UpdateCollapsedTriangles(simplifier, a, a, collapsing, &liveCount);
+                UpdateCollapsedTriangles(simplifier, a, b, collapsing + va->refCount, &liveCount);
+                
+                //a's new list usually fits where its old one was, reusing that keeps the refs from growing every collapse
+                int refCount = simplifier->refCount - refStart;
+                if(refCount <= va->refCount){
+                    memmove(&simplifier->refs[va->refStart], &simplifier->refs[refStart], refCount*sizeof(SimplifyRef));
+                    simplifier->refCount = refStart;
+                }
+                else va->refStart = refStart;
+                va->refCount = refCount;
+                break;
+            }
+        }
+    }
+    
+    free(collapsing);
+    UpdateSimplifierMesh(simplifier, false);
+}
+
+//welds a mesh's vertices by position only, indexed or not, corners keep their own texcoords and normals
+static Simplifier LoadSimplifier(Mesh mesh)
+{
+    Simplifier simplifier = { 0 };
+    simplifier.triangleCount = (mesh.indices != NULL)? mesh.triangleCount : mesh.vertexCount/3;
+    simplifier.triangles = (SimplifyTriangle *)calloc(simplifier.triangleCount + 1, sizeof(SimplifyTriangle));
+    simplifier.vertices = (SimplifyVertex *)calloc(mesh.vertexCount + 1, sizeof(SimplifyVertex));
+    simplifier.refCapacity = simplifier.triangleCount*3 + 1;
+    simplifier.refs = (SimplifyRef *)malloc(simplifier.refCapacity*sizeof(SimplifyRef));
+    
+    int tableSize = 1;
+    while(tableSize < mesh.vertexCount*2) tableSize <<= 1;
+    int *table = (int *)malloc(tableSize*sizeof(int));
+    for(int i = 0; i < tableSize; i++) table[i] = -1;
+    int *remap = (int *)malloc((mesh.vertexCount + 1)*sizeof(int));
+    
+    for(int i = 0; i < mesh.vertexCount; i++){
+        Vector3 pos = { mesh.vertices[i*3], mesh.vertices[i*3 + 1], mesh.vertices[i*3 + 2] };
+        int slot = (unsigned int)GetDataHash((const unsigned char *)&pos, sizeof(pos)) & (tableSize - 1);
+        while(table[slot] >= 0 && memcmp(&simplifier.vertices[table[slot]].pos, &pos, sizeof(pos)) != 0) slot = (slot + 1) & (tableSize - 1);
+        if(table[slot] < 0){
+            simplifier.vertices[simplifier.vertexCount].pos = pos;
+            table[slot] = simplifier.vertexCount++;
+        }
+        remap[i] = table[slot];
+    }
+    
+    //triangles that weld down to a line or a point have no edge worth collapsing and are dropped
+    int triangleCount = simplifier.triangleCount;
+    simplifier.triangleCount = 0;
+    for(int t = 0; t < triangleCount; t++){
+        SimplifyTriangle *triangle = &simplifier.triangles[simplifier.triangleCount];
+        for(int c = 0; c < 3; c++){
+            int index = (mesh.indices != NULL)? mesh.indices[t*3 + c] : t*3 + c;
+            triangle->v[c] = remap[index];
+            if(mesh.texcoords != NULL) memcpy(triangle->texcoords[c], &mesh.texcoords[index*2], 2*sizeof(float));
+            if(mesh.normals != NULL) memcpy(triangle->normals[c], &mesh.normals[index*3], 3*sizeof(float));
+        }
+        if(triangle->v[0] != triangle->v[1] && triangle->v[1] != triangle->v[2] && triangle->v[0] != triangle->v[2]) simplifier.triangleCount++;
+    }
+    
+    free(table);
+    free(remap);
+    return simplifier;
+}
+
+static void UnloadSimplifier(Simplifier simplifier)
+{
+    free(simplifier.vertices);
+    free(simplifier.triangles);
+    free(simplifier.refs);
+}
+
+//the surviving triangles as an unindexed mesh, BuildMeshCache welds it like a freshly parsed one
+static Mesh GetSimplifiedMesh(const Simplifier *simplifier)
+{
+    Mesh mesh = { 0 };
+    mesh.triangleCount = simplifier->triangleCount;
+    mesh.vertexCount = simplifier->triangleCount*3;
+    mesh.vertices = (float *)MemAlloc(mesh.vertexCount*3*sizeof(float));
+    mesh.texcoords = (float *)MemAlloc(mesh.vertexCount*2*sizeof(float));
+    mesh.normals = (float *)MemAlloc(mesh.vertexCount*3*sizeof(float));
+    for(int t = 0; t < simplifier->triangleCount; t++){
+        const SimplifyTriangle *triangle = &simplifier->triangles[t];
+        for(int c = 0; c < 3; c++){
+            Vector3 pos = simplifier->vertices[triangle->v[c]].pos;
+            mesh.vertices[(t*3 + c)*3] = pos.x;
+            mesh.vertices[(t*3 + c)*3 + 1] = pos.y;
+            mesh.vertices[(t*3 + c)*3 + 2] = pos.z;
+            memcpy(&mesh.texcoords[(t*3 + c)*2], triangle->texcoords[c], 2*sizeof(float));
+            memcpy(&mesh.normals[(t*3 + c)*3], triangle->normals[c], 3*sizeof(float));
+        }
+    }
+    return mesh;
+}
+
+//every mesh of a model simplified to a share of its triangles, CPU side only
+static Model SimplifyModel(Model model, float ratio)
+{
+    Model simplified = { 0 };
+    simplified.transform = model.transform;
+    simplified.meshCount = model.meshCount;
+    simplified.materialCount = model.materialCount;
+    simplified.meshes = (Mesh *)MemAlloc(model.meshCount*sizeof(Mesh));
+    simplified.materials = (Material *)MemAlloc(model.materialCount*sizeof(Material));
+    simplified.meshMaterial = (int *)MemAlloc(model.meshCount*sizeof(int));
+    memcpy(simplified.meshMaterial, model.meshMaterial, model.meshCount*sizeof(int));
+    for(int m = 0; m < model.materialCount; m++){
+        simplified.materials[m] = LoadMaterialDefault();
+        simplified.materials[m].maps[MATERIAL_MAP_DIFFUSE].color = model.materials[m].maps[MATERIAL_MAP_DIFFUSE].color;
+    }
+    
+    for(int m = 0; m < model.meshCount; m++){
+        Simplifier simplifier = LoadSimplifier(model.meshes[m]);
+        SimplifyMesh(&simplifier, (int)(simplifier.triangleCount*ratio));
+        simplified.meshes[m] = GetSimplifiedMesh(&simplifier);
+        UnloadSimplifier(simplifier);
+    }
+    
+    return simplified;
+}
+
+static int GetModelTriangleCount(Model model)
+{
+    int triangleCount = 0;
+    for(int m = 0; m < model.meshCount; m++) triangleCount += model.meshes[m].triangleCount;
+    return triangleCount;
+}
+
+//builds requests [first, last), each from its cache or by simplifying the source and caching the result
+static void BuildModelLodsJob(void *data, int first, int last)
+{
+    LodRequest *requests = (LodRequest *)data;
+    for(int i = first; i < last; i++){
+        LodRequest *request = &requests[i];
+        char extension[32];
+        char cachePath[512];
+        snprintf(extension, sizeof(extension), ".lod%d.mesh", request->level);
+        GetAssetCachePath(request->fileName, extension, cachePath, sizeof(cachePath));
+        
+        //keyed on the source and the level's ratio, so retuning LodTriangleRatios rebuilds the level
+        unsigned long long key[3] = { request->sourceHash, (unsigned long long)request->level, 0 };
+        memcpy(&key[2], &LodTriangleRatios[request->level], sizeof(float));
+        unsigned long long lodHash = GetDataHash((const unsigned char *)key, sizeof(key));
+        
+        int cacheSize = 0;
+        unsigned char *cache = MapCacheFile(cachePath, &cacheSize);
+        request->IsBuilt = (cache != NULL) && LoadModelFromCache(cache, cacheSize, lodHash, &request->model);
+        UnmapCacheFile(cache, cacheSize);
+        if(request->IsBuilt) continue;
+        
+        Model simplified = SimplifyModel(request->source, LodTriangleRatios[request->level]);
+        cache = BuildMeshCache(simplified, lodHash, &cacheSize);
+        request->IsBuilt = LoadModelFromCache(cache, cacheSize, lodHash, &request->model);
+        if(request->IsBuilt){
+            SaveAssetCache(cachePath, cache, cacheSize);
+            TraceLog(LOG_INFO, "CACHE: [%s] Simplified to %s", request->fileName, cachePath);
+        }
+        MemFree(cache);
+        UnloadDecodedModel(simplified);
+    }
+}
+
+//builds the simplified levels of several models at once on the job system, then uploads them
+//the levels share the source model's transform, shaders and textures, so set those up first
+static void LoadModelLods(ModelLod *lods, const Model *models, const char **fileNames, const unsigned long long *sourceHashes, int count)
+{
+    int requestCount = count*(MaxModelLods - 1);
+    LodRequest *requests = (LodRequest *)calloc(requestCount + 1, sizeof(LodRequest));
+    for(int i = 0; i < requestCount; i++){
+        int model = i/(MaxModelLods - 1);
+        requests[i] = (LodRequest){ .source = models[model], .fileName = fileNames[model], .sourceHash = sourceHashes[model],
+                                    .level = i%(MaxModelLods - 1) + 1 };
+    }
+    
+    JobGraph graph = { 0 };
+    AddJobTask(&graph, BuildModelLodsJob, requests, &requestCount, 1, PROFILE_LOAD);
+    RunJobGraph(&jobs, &graph);
+    
+    //a model's levels stop at the first one that couldn't be built
+    for(int i = 0; i < count; i++){
+        lods[i] = (ModelLod){ 0 };
+        lods[i].levels[0] = models[i];
+        lods[i].levelCount = 1;
+        for(int level = 1; level < MaxModelLods; level++){
+            LodRequest *request = &requests[i*(MaxModelLods - 1) + level - 1];
+            if(!request->IsBuilt) continue;
+            if(lods[i].levelCount != level){
+                UnloadDecodedModel(request->model);
+                continue;
+            }
+            
+            Model model = request->model;
+            for(int m = 0; m < model.meshCount; m++) UploadMesh(&model.meshes[m], false);
+            model.transform = models[i].transform;
+            for(int m = 0; m < model.materialCount && m < models[i].materialCount; m++){
+                model.materials[m].shader = models[i].materials[m].shader;
+                model.materials[m].maps[MATERIAL_MAP_DIFFUSE] = models[i].materials[m].maps[MATERIAL_MAP_DIFFUSE];
+            }
+            lods[i].levels[lods[i].levelCount++] = model;
+            TraceLog(LOG_INFO, "LOD: [%s] Level %d keeps %d of %d triangles", fileNames[i], level, GetModelTriangleCount(model), GetModelTriangleCount(models[i]));
+        }
+    }
+    
+    free(requests);
+}
+
+//unloads the simplified levels, level 0 belongs to the resource manager
+static void UnloadModelLod(ModelLod lod)
+{
+    for(int i = 1; i < lod.levelCount; i++) UnloadModel(lod.levels[i]);
+}
+
+//picks the level for an instance covering screenSize of the screen height, an instance only goes back to a finer level
+//once it is LodHysteresis past the switch point, so one sitting right on it doesn't flicker between the two
+static int SelectModelLod(const ModelLod *lod, int current, float screenSize)
+{
+    int level = (current < lod->levelCount)? current : lod->levelCount - 1;
+    while(level + 1 < lod->levelCount && screenSize < LodScreenSizes[level + 1]) level++;
+    while(level > 0 && screenSize > LodScreenSizes[level]*LodHysteresis) level--;
+    return level;
+}
+
+//share of the screen height a sphere covers, 1 once the camera is inside it
+static float GetProjectedSize(Camera camera, Vector3 center, float radius)
+{
+    float distance = Vector3Distance(camera.position, center);
+    if(distance <= radius) return 1.0f;
+    return radius/(distance*tanf(camera.fovy*0.5f*DEG2RAD));
+}
+
+//queues an instance into the batch of the level its size on screen asks for, current keeps the instance's level between frames
+static bool AddVisibleLodInstance(InstanceBatch *batches, const ModelLod *lod, unsigned char *current, Frustum *frustum, Camera camera, Matrix transform)
+{
+    Matrix full = MatrixMultiply(batches[0].model.transform, transform);
+    float screenSize = GetProjectedSize(camera, Vector3Transform(batches[0].bounds.center, full), batches[0].bounds.radius);
+    *current = (unsigned char)SelectModelLod(lod, *current, screenSize);
+    return AddVisibleInstance(&batches[*current], frustum, transform);
+}
+
+static unsigned short PackColor565(const unsigned char *color)
+{
+    return (unsigned short)(((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) | (color[2] >> 3));
+}
+
+static void UnpackColor565(unsigned short packed, int *color)
+{
+    color[0] = ((packed >> 11) & 31)*255/31;
+    color[1] = ((packed >> 5) & 63)*255/63;
+    color[2] = (packed & 31)*255/31;
+}
+
+//one 4x4 block of RGBA pixels to 8 bytes of DXT1, the endpoints are the color bounding box pulled in by a sixteenth
+static void EncodeBlockDXT1(const unsigned char pixels[16][4], unsigned char *block)
+{
+    unsigned char minColor[3] = { 255, 255, 255 };
+    unsigned char maxColor[3] = { 0, 0, 0 };
+    for(int p = 0; p < 16; p++){
+        for(int c = 0; c < 3; c++){
+            if(pixels[p][c] < minColor[c]) minColor[c] = pixels[p][c];
+            if(pixels[p][c] > maxColor[c]) maxColor[c] = pixels[p][c];
+        }
+    }
+    for(int c = 0; c < 3; c++){
+        int inset = (maxColor[c] - minColor[c]) >> 4;
+        minColor[c] += inset;
+        maxColor[c] -= inset;
+    }
+    
+    //the box corners only follow the colors when every channel rises together, flip channels that fall against the widest one
+    int axis = 0;
+    for(int c = 1; c < 3; c++) if(maxColor[c] - minColor[c] > maxColor[axis] - minColor[axis]) axis = c;
+    for(int c = 0; c < 3; c++){
+        int covariance = 0;
+        for(int p = 0; p < 16 && c != axis; p++){
+            covariance += (2*pixels[p][axis] - minColor[axis] - maxColor[axis])*(2*pixels[p][c] - minColor[c] - maxColor[c]);
+        }
+        if(covariance < 0){
+            unsigned char swap = minColor[c];
+            minColor[c] = maxColor[c];
+            maxColor[c] = swap;
+        }
+    }
+    
+    unsigned short color0 = PackColor565(maxColor);
+    unsigned short color1 = PackColor565(minColor);
+    if(color0 < color1){
+        unsigned short swap = color0;
+        color0 = color1;
+        color1 = swap;
+    }
+    
+    int palette[4][3];
+    UnpackColor565(color0, palette[0]);
+    UnpackColor565(color1, palette[1]);
+    for(int c = 0; c < 3; c++){
+        palette[2][c] = (2*palette[0][c] + palette[1][c])/3;
+        palette[3][c] = (palette[0][c] + 2*palette[1][c])/3;
+    }
+    
+    //equal endpoints select the three color mode, index 0 everywhere is still exact
+    unsigned int indices = 0;
+    for(int p = 0; p < 16 && color0 != color1; p++){
+        int best = 0, bestDistance = 0x7fffffff;
+        for(int k = 0; k < 4; k++){
+            int dr = pixels[p][0] - palette[k][0], dg = pixels[p][1] - palette[k][1], db = pixels[p][2] - palette[k][2];
+            int distance = dr*dr + dg*dg + db*db;
+            if(distance < bestDistance){
+                bestDistance = distance;
+                best = k;
+            }
+        }
+        indices |= (unsigned int)best << (p*2);
+    }
+    
+    block[0] = color0 & 0xff;
+    block[1] = color0 >> 8;
+    block[2] = color1 & 0xff;
+    block[3] = color1 >> 8;
+    for(int b = 0; b < 4; b++) block[4 + b] = (indices >> (b*8)) & 0xff;
+}
+
+//replaces an RGBA8 image and all its mipmaps with DXT1 blocks, a sixth of the size and sampled by the GPU as is
+static void ImageCompressDXT1(Image *image)
+{
+    int dataSize = 0;
+    for(int level = 0, w = image->width, h = image->height; level < image->mipmaps; level++, w = (w > 1) ? w/2 : 1, h = (h > 1) ? h/2 : 1){
+        dataSize += GetPixelDataSize(w, h, PIXELFORMAT_COMPRESSED_DXT1_RGB);
+    }
+    unsigned char *compressed = (unsigned char *)MemAlloc(dataSize);
+    unsigned char *dst = compressed;
+    const unsigned char *src = (const unsigned char *)image->data;
+    
+    for(int level = 0, w = image->width, h = image->height; level < image->mipmaps; level++){
+        for(int by = 0; by < h; by += 4){
+            for(int bx = 0; bx < w; bx += 4){
+                unsigned char pixels[16][4];
+                for(int p = 0; p < 16; p++){
+                    int x = (bx + p%4 < w) ? bx + p%4 : w - 1;
+                    int y = (by + p/4 < h) ? by + p/4 : h - 1;
+                    memcpy(pixels[p], &src[(y*w + x)*4], 4);
+                }
+                EncodeBlockDXT1(pixels, dst);
+                dst += 8;
+            }
+        }
+        src += w*h*4;
+        w = (w > 1) ? w/2 : 1;
+        h = (h > 1) ? h/2 : 1;
+    }
+    
+    MemFree(image->data);
+    image->data = compressed;
+    image->format = PIXELFORMAT_COMPRESSED_DXT1_RGB;
+}
+
+//decodes the source image into the exact pixels the GPU gets, mipmapped and DXT1 compressed when asked and fully opaque
+static unsigned char *BuildTextureCache(const unsigned char *source, int sourceSize, const char *fileType, unsigned long long sourceHash,
+                                        bool useMipmaps, bool allowCompression, int *dataSize)
+{
+    Image image = LoadImageFromMemory(fileType, source, sourceSize);
+    if(image.data == NULL) return NULL;
+    
+    ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    bool IsOpaque = true;
+    for(int i = 0; IsOpaque && i < image.width*image.height; i++) IsOpaque = ((unsigned char *)image.data)[i*4 + 3] == 255;
+    
+    if(useMipmaps) ImageMipmaps(&image);
+    if(allowCompression && IsOpaque && image.width%4 == 0 && image.height%4 == 0) ImageCompressDXT1(&image);
+    
+    int pixelSize = 0;
+    for(int level = 0, w = image.width, h = image.height; level < image.mipmaps; level++, w = (w > 1) ? w/2 : 1, h = (h > 1) ? h/2 : 1){
+        pixelSize += GetPixelDataSize(w, h, image.format);
+    }
+    
+    TextureCacheHeader header = { 0 };
+    memcpy(header.magic, TEXTURE_CACHE_MAGIC, 4);
+    header.version = ASSET_CACHE_VERSION;
+    header.sourceHash = sourceHash;
+    header.width = image.width;
+    header.height = image.height;
+    header.mipmaps = image.mipmaps;
+    header.format = image.format;
+    header.dataSize = pixelSize;
+    
+    unsigned char *data = (unsigned char *)MemAlloc(sizeof(header) + pixelSize);
+    memcpy(data, &header, sizeof(header));
+    memcpy(data + sizeof(header), image.data, pixelSize);
+    UnloadImage(image);
+    
+    *dataSize = sizeof(header) + pixelSize;
+    return data;
+}
+
+//a texture's blob is named after the options it was built with, "HealthIcon.png" with mipmaps and compression caches to
+//"The Last Tank/cache/HealthIcon.png.mip.dxt.tex", so loading one image two ways keeps two blobs instead of sharing the first one written
+static void GetTextureCachePath(const char *fileName, bool useMipmaps, bool allowCompression, char *path, int pathSize)
+{
+    static const char *extensions[4] = { ".tex", ".mip.tex", ".dxt.tex", ".mip.dxt.tex" };
+    GetAssetCachePath(fileName, extensions[(useMipmaps ? 1 : 0) + (allowCompression ? 2 : 0)], path, pathSize);
+}
+
+//checks a texture cache blob's header against its source and its own size
+static bool IsTextureCacheValid(const unsigned char *data, int dataSize, unsigned long long sourceHash)
+{
+    TextureCacheHeader header;
+    return ReadCacheBytes(data, data + dataSize, &header, sizeof(header)) != NULL && memcmp(header.magic, TEXTURE_CACHE_MAGIC, 4) == 0 &&
+           header.version == ASSET_CACHE_VERSION && header.sourceHash == sourceHash && header.dataSize == dataSize - (int)sizeof(header);
+}
+
+//uploads a valid cache blob's pixels as they are, id 0 if the GPU refused the format
+static Texture2D LoadTextureFromCache(const unsigned char *data)
+{
+    TextureCacheHeader header;
+    memcpy(&header, data, sizeof(header));
+    Image image = { (void *)(data + sizeof(header)), header.width, header.height, header.mipmaps, header.format };
+    return LoadTextureFromImage(image);
+}
+
+//a blob read from disk is a mapping, a converted one was allocated by BuildTextureCache
+static void UnloadTextureBlob(unsigned char *data, int dataSize, bool IsConverted)
+{
+    if(IsConverted) MemFree(data);
+    else UnmapCacheFile(data, dataSize);
+}
+
+//CPU half of loading a texture through the cache, safe on a loader worker, returns the cache blob from disk or converts the source into a new one
+static unsigned char *DecodeCachedTexture(const char *fileName, bool useMipmaps, bool allowCompression, bool useCache, int *dataSize, bool *IsConverted,
+                                          unsigned long long *sourceHash)
+{
+    char cachePath[512];
+    GetTextureCachePath(fileName, useMipmaps, allowCompression, cachePath, sizeof(cachePath));
+    
+    int sourceSize = 0;
+    unsigned char *source = LoadFileData(fileName, &sourceSize);
+    if(source == NULL) return NULL;
+    *sourceHash = GetDataHash(source, sourceSize);
+    
+    unsigned char *cache = useCache ? MapCacheFile(cachePath, dataSize) : NULL;
+    if(cache != NULL && IsTextureCacheValid(cache, *dataSize, *sourceHash)){
+        UnloadFileData(source);
+        *IsConverted = false;
+        return cache;
+    }
+    UnmapCacheFile(cache, *dataSize);
+    
+    cache = BuildTextureCache(source, sourceSize, GetFileExtension(fileName), *sourceHash, useMipmaps, allowCompression, dataSize);
+    UnloadFileData(source);
+    *IsConverted = true;
+    return cache;
+}
+
+//GPU half, takes ownership of the blob, a converted blob is only written out once the GPU has accepted it
+//if the driver refuses DXT1 the texture is loaded again without compression, through that option's own blob
+static Texture2D UploadCachedTexture(const char *fileName, unsigned char *data, int dataSize, bool IsConverted, bool useMipmaps, bool allowCompression)
+{
+    Texture2D texture = (data != NULL) ? LoadTextureFromCache(data) : (Texture2D){ 0 };
+    if(data != NULL && texture.id == 0 && allowCompression){
+        UnloadTextureBlob(data, dataSize, IsConverted);
+        unsigned long long sourceHash = 0;
+        allowCompression = false;
+        data = DecodeCachedTexture(fileName, useMipmaps, allowCompression, true, &dataSize, &IsConverted, &sourceHash);
+        if(data != NULL) texture = LoadTextureFromCache(data);
+    }
+    
+    if(texture.id != 0 && IsConverted){
+        char cachePath[512];
+        GetTextureCachePath(fileName, useMipmaps, allowCompression, cachePath, sizeof(cachePath));
+        SaveAssetCache(cachePath, data, dataSize);
+        TraceLog(LOG_INFO, "CACHE: [%s] Converted to %s", fileName, cachePath);
+    }
+    UnloadTextureBlob(data, dataSize, IsConverted);
+    
+    //a missing source goes through LoadTexture so raylib reports it like before
+    if(texture.id == 0) return LoadTexture(fileName);
+    return texture;
+}
+
+//memory a loaded resource holds on the GPU or in the audio device
+static int GetResourceByteSize(const Resource *resource)
+{
+    int byteSize = 0;
+    switch(resource->type){
+        case ASSET_MODEL:
+            for(int m = 0; m < resource->model.meshCount; m++){
+                const Mesh *mesh = &resource->model.meshes[m];
+                byteSize += mesh->vertexCount*8*sizeof(float) + ((mesh->indices != NULL) ? mesh->triangleCount*3*sizeof(unsigned short) : 0);
+            }
+            break;
+        case ASSET_TEXTURE:
+            for(int level = 0, w = resource->texture.width, h = resource->texture.height; level < resource->texture.mipmaps; level++){
+                byteSize += GetPixelDataSize(w, h, resource->texture.format);
+                w = (w > 1) ? w/2 : 1;
+                h = (h > 1) ? h/2 : 1;
+            }
+            break;
+        case ASSET_SOUND: byteSize = resource->sound.frameCount*resource->sound.stream.channels*resource->sound.stream.sampleSize/8; break;
+        case ASSET_STREAM: break;
+    }
+    return byteSize;
+}
+
+//an earlier resource of the same kind loaded from identical bytes, -1 if there is none
+static int FindResourceByContent(const ResourceManager *resources, const Resource *resource)
+{
+    for(int i = 0; i < resources->resourceCount; i++){
+        const Resource *other = &resources->resources[i];
+        if(other != resource && other->refCount > 0 && other->owner == i && other->contentHash == resource->contentHash && other->type == resource->type &&
+           other->useMipmaps == resource->useMipmaps && other->allowCompression == resource->allowCompression) return i;
+    }
+    return -1;
+}
+
+//finds a loaded or queued resource by path and options and takes a reference, or reserves a new slot for it
+static ResourceHandle AcquireResource(ResourceManager *resources, AssetType type, const char *fileName, bool useMipmaps, bool allowCompression, bool *IsNew)
+{
+    *IsNew = false;
+    int freeSlot = -1;
+    for(int i = 0; i < resources->resourceCount; i++){
+        Resource *resource = &resources->resources[i];
+        if(resource->refCount == 0){
+            if(freeSlot < 0) freeSlot = i;
+            continue;
+        }
+        if(resource->type == type && resource->useMipmaps == useMipmaps && resource->allowCompression == allowCompression && strcmp(resource->fileName, fileName) == 0){
+            resource->refCount++;
+            return i;
+        }
+    }
+    
+    if(freeSlot < 0){
+        if(resources->resourceCount >= MaxResources){
+            TraceLog(LOG_WARNING, "RESOURCE: [%s] Too many resources, raise MaxResources", fileName);
+            return -1;
+        }
+        freeSlot = resources->resourceCount++;
+    }
+    
+    Resource *resource = &resources->resources[freeSlot];
+    *resource = (Resource){ .type = type, .useMipmaps = useMipmaps, .allowCompression = allowCompression, .refCount = 1, .owner = freeSlot };
+    snprintf(resource->fileName, sizeof(resource->fileName), "%s", fileName);
+    *IsNew = true;
+    return freeSlot;
+}
+
+//puts an uploaded asset into its resource, or frees it and shares an earlier resource's GPU object when the bytes matched
+static void StoreResource(ResourceManager *resources, ResourceHandle handle, Model model, Texture2D texture, Sound sound, Music stream)
+{
+    Resource *resource = &resources->resources[handle];
+    int owner = (resource->contentHash != 0) ? FindResourceByContent(resources, resource) : -1;
+    
+    if(owner < 0){
+        resource->model = model;
+        resource->texture = texture;
+        resource->sound = sound;
+        resource->stream = stream;
+        resource->byteSize = GetResourceByteSize(resource);
+        return;
+    }
+    
+    const Resource *shared = &resources->resources[owner];
+    switch(resource->type){
+        case ASSET_MODEL:
+            //meshes are shared, materials are not since callers assign their own textures
+            resource->model = shared->model;
+            resource->model.materials = (Material *)MemAlloc(model.materialCount*sizeof(Material));
+            resource->model.meshMaterial = (int *)MemAlloc(model.meshCount*sizeof(int));
+            for(int m = 0; m < model.materialCount; m++){
+                resource->model.materials[m] = LoadMaterialDefault();
+                memcpy(resource->model.materials[m].maps, model.materials[m].maps, (MATERIAL_MAP_BRDF + 1)*sizeof(MaterialMap));
+            }
+            memcpy(resource->model.meshMaterial, model.meshMaterial, model.meshCount*sizeof(int));
+            resource->model.materialCount = model.materialCount;
+            UnloadModel(model);
+            break;
+        case ASSET_TEXTURE:
+            resource->texture = shared->texture;
+            UnloadTexture(texture);
+            break;
+        case ASSET_SOUND:
+            resource->sound = shared->sound;
+            UnloadSound(sound);
+            break;
+        case ASSET_STREAM:
+            resource->stream = shared->stream;
+            UnloadMusicStream(stream);
+            break;
+    }
+    resource->owner = owner;
+    resources->resources[owner].refCount++;
+    TraceLog(LOG_INFO, "RESOURCE: [%s] Same contents as [%s], sharing it", resource->fileName, shared->fileName);
+}
+
+//drops a reference, the GPU or audio object goes away with the last one
+static void ReleaseResource(ResourceManager *resources, ResourceHandle handle)
+{
+    if(handle < 0 || handle >= resources->resourceCount || resources->resources[handle].refCount <= 0) return;
+    Resource *resource = &resources->resources[handle];
+    if(--resource->refCount > 0) return;
+    
+    if(resource->owner != handle){
+        if(resource->type == ASSET_MODEL){
+            for(int m = 0; m < resource->model.materialCount; m++) MemFree(resource->model.materials[m].maps);
+            MemFree(resource->model.materials);
+            MemFree(resource->model.meshMaterial);
+        }
+        ReleaseResource(resources, resource->owner);
+    }
+    else {
+        switch(resource->type){
+            case ASSET_MODEL: UnloadModel(resource->model); break;
+            case ASSET_TEXTURE: UnloadTexture(resource->texture); break;
+            case ASSET_SOUND: UnloadSound(resource->sound); break;
+            case ASSET_STREAM: UnloadMusicStream(resource->stream); break;
+        }
+    }
+    *resource = (Resource){ 0 };
+}
+
+//unloads everything still referenced, shared resources go first so their owners are released last
+static void UnloadResources(ResourceManager *resources)
+{
+    for(int pass = 0; pass < 2; pass++){
+        for(int i = 0; i < resources->resourceCount; i++){
+            Resource *resource = &resources->resources[i];
+            bool IsShared = resource->owner != i;
+            if(resource->refCount <= 0 || IsShared != (pass == 0)) continue;
+            resource->refCount = 1;
+            ReleaseResource(resources, i);
+        }
+    }
+    resources->resourceCount = 0;
+}
+
+static void TraceResources(const ResourceManager *resources)
+{
+    static const char *typeNames[] = { "model", "texture", "sound", "stream" };
+    int totalSize = 0, liveCount = 0;
+    
+    for(int i = 0; i < resources->resourceCount; i++){
+        const Resource *resource = &resources->resources[i];
+        if(resource->refCount <= 0) continue;
+        if(resource->owner != i){
+            TraceLog(LOG_INFO, "RESOURCE: %-7s %2d refs       shared %s -> %s", typeNames[resource->type], resource->refCount, resource->fileName,
+                     resources->resources[resource->owner].fileName);
+        }
+        else if(resource->type == ASSET_STREAM) TraceLog(LOG_INFO, "RESOURCE: %-7s %2d refs     streamed %s", typeNames[resource->type], resource->refCount, resource->fileName);
+        else TraceLog(LOG_INFO, "RESOURCE: %-7s %2d refs %9.1f KB %s", typeNames[resource->type], resource->refCount, resource->byteSize/1024.0f, resource->fileName);
+        totalSize += resource->byteSize;
+        liveCount++;
+    }
+    TraceLog(LOG_INFO, "RESOURCE: %.2f MB in %d resources", totalSize/(1024.0f*1024.0f), liveCount);
+}
+
+//takes a reference for target, the file is only decoded if no resource with this path and options exists yet
+static ResourceHandle QueueAsset(AssetLoader *loader, AssetType type, const char *fileName, bool useMipmaps, bool allowCompression, void *target)
+{
+    if(loader->targetCount >= MaxAssetRequests || loader->requestCount >= MaxAssetRequests){
+        TraceLog(LOG_WARNING, "LOADER: [%s] Too many requests, raise MaxAssetRequests", fileName);
+        return -1;
+    }
+    
+    bool IsNew = false;
+    ResourceHandle handle = AcquireResource(loader->resources, type, fileName, useMipmaps, allowCompression, &IsNew);
+    if(handle < 0) return -1;
+    loader->targets[loader->targetCount++] = (AssetTarget){ handle, target };
+    if(IsNew){
+        loader->requests[loader->requestCount++] = (AssetRequest){ .type = type, .fileName = loader->resources->resources[handle].fileName, .handle = handle,
+                                                                   .useMipmaps = useMipmaps, .allowCompression = allowCompression };
+    }
+    return handle;
+}
+
+static ResourceHandle QueueModel(AssetLoader *loader, const char *fileName, Model *target)
+{
+    return QueueAsset(loader, ASSET_MODEL, fileName, false, false, target);
+}
+
+static ResourceHandle QueueTexture(AssetLoader *loader, const char *fileName, bool useMipmaps, bool allowCompression, Texture2D *target)
+{
+    return QueueAsset(loader, ASSET_TEXTURE, fileName, useMipmaps, allowCompression, target);
+}
+
+//any format raylib decodes works, short effects are decoded once and stay in memory
+static ResourceHandle QueueSound(AssetLoader *loader, const char *fileName, Sound *target)
+{
+    return QueueAsset(loader, ASSET_SOUND, fileName, false, false, target);
+}
+
+//long or rare sounds, opened as a music stream that decodes from disk in small chunks while it plays
+static ResourceHandle QueueSoundStream(AssetLoader *loader, const char *fileName, Music *target)
+{
+    return QueueAsset(loader, ASSET_STREAM, fileName, false, false, target);
+}
+
+//worker loop, takes the next queued file, does all the CPU work for it and hands it back for upload
+static void *AssetLoaderWorker(void *arg)
+{
+    AssetLoader *loader = (AssetLoader *)arg;
+    
+    while(true){
+        pthread_mutex_lock(&loader->lock);
+        int index = (loader->nextDecode < loader->requestCount) ? loader->nextDecode++ : -1;
+        pthread_mutex_unlock(&loader->lock);
+        if(index < 0) break;
+        
+        AssetRequest *request = &loader->requests[index];
+        switch(request->type){
+            case ASSET_MODEL: request->IsModelDecoded = DecodeCachedModel(request->fileName, &request->model, &request->sourceHash); break;
+            case ASSET_TEXTURE: request->textureData = DecodeCachedTexture(request->fileName, request->useMipmaps, request->allowCompression, true,
+                                                                           &request->textureDataSize, &request->IsTextureConverted, &request->sourceHash); break;
+            case ASSET_SOUND: {
+                int sourceSize = 0;
+                unsigned char *source = LoadFileData(request->fileName, &sourceSize);
+                if(source == NULL) break;
+                request->sourceHash = GetDataHash(source, sourceSize);
+                request->wave = LoadWaveFromMemory(GetFileExtension(request->fileName), source, sourceSize);
+                UnloadFileData(source);
+            } break;
+            case ASSET_STREAM: {
+                //only hashed here so equal files share one stream, opening it needs the audio device
+                int sourceSize = 0;
+                unsigned char *source = LoadFileData(request->fileName, &sourceSize);
+                if(source == NULL) break;
+                request->sourceHash = GetDataHash(source, sourceSize);
+                UnloadFileData(source);
+            } break;
+        }
+        
+        pthread_mutex_lock(&loader->lock);
+        loader->decodedOrder[loader->decodedCount++] = index;
+        pthread_mutex_unlock(&loader->lock);
+    }
+    return NULL;
+}
+
+//queue everything first, then start, the workers exit on their own once the queue is empty
+static void StartAssetLoader(AssetLoader *loader, int workerCount)
+{
+    if(workerCount > MaxLoaderWorkers) workerCount = MaxLoaderWorkers;
+    if(workerCount > loader->requestCount) workerCount = loader->requestCount;
+    
+    pthread_mutex_init(&loader->lock, NULL);
+    for(int i = 0; i < workerCount; i++){
+        if(pthread_create(&loader->workers[loader->workerCount], NULL, AssetLoaderWorker, loader) == 0) loader->workerCount++;
+    }
+    
+    //no threads at all still loads, the main thread just decodes everything inside the first update
+    if(loader->workerCount == 0) AssetLoaderWorker(loader);
+}
+
+//uploads whatever the workers finished since the last call into the resource manager
+//true once every request is in place, the targets are filled and the workers are gone
+static bool UpdateAssetLoader(AssetLoader *loader)
+{
+    pthread_mutex_lock(&loader->lock);
+    int decodedCount = loader->decodedCount;
+    pthread_mutex_unlock(&loader->lock);
+    
+    for(; loader->uploadedCount < decodedCount; loader->uploadedCount++){
+        AssetRequest *request = &loader->requests[loader->decodedOrder[loader->uploadedCount]];
+        Model model = { 0 };
+        Texture2D texture = { 0 };
+        Sound sound = { 0 };
+        Music stream = { 0 };
+        switch(request->type){
+            case ASSET_MODEL: model = UploadCachedModel(request->fileName, request->model, request->IsModelDecoded); break;
+            case ASSET_TEXTURE: texture = UploadCachedTexture(request->fileName, request->textureData, request->textureDataSize,
+                                                              request->IsTextureConverted, request->useMipmaps, request->allowCompression); break;
+            case ASSET_SOUND:
+                if(request->wave.data != NULL) sound = LoadSoundFromWave(request->wave);
+                else TraceLog(LOG_WARNING, "SOUND: [%s] Failed to load", request->fileName);
+                UnloadWave(request->wave);
+                break;
+            case ASSET_STREAM:
+                stream = LoadMusicStream(request->fileName);
+                stream.looping = false;
+                break;
+        }
+        loader->resources->resources[request->handle].contentHash = request->sourceHash;
+        StoreResource(loader->resources, request->handle, model, texture, sound, stream);
+    }
+    
+    if(loader->uploadedCount < loader->requestCount) return false;
+    for(int i = 0; i < loader->workerCount; i++) pthread_join(loader->workers[i], NULL);
+    loader->workerCount = 0;
+    pthread_mutex_destroy(&loader->lock);
+    
+    for(int i = 0; i < loader->targetCount; i++){
+        const Resource *resource = &loader->resources->resources[loader->targets[i].handle];
+        switch(resource->type){
+            case ASSET_MODEL: *(Model *)loader->targets[i].target = resource->model; break;
+            case ASSET_TEXTURE: *(Texture2D *)loader->targets[i].target = resource->texture; break;
+            case ASSET_SOUND: *(Sound *)loader->targets[i].target = resource->sound; break;
+            case ASSET_STREAM: *(Music *)loader->targets[i].target = resource->stream; break;
+        }
+    }
+    return true;
+}
+
+static void DrawLoadingScreen(const AssetLoader *loader)
+{
+    float progress = (loader->requestCount > 0) ? (float)loader->uploadedCount/loader->requestCount : 1.0f;
+    
+    BeginDrawing();
+    ClearBackground(DARKGRAY);
+    DrawText("The Last Tank", (int)GetScreenWidth()/2 - 400, (int)GetScreenHeight()/2 - 200, 120, RAYWHITE);
+    DrawRectangle((int)GetScreenWidth()/2 - 400, (int)GetScreenHeight()/2, 800, 50, WHITE);
+    DrawRectangle((int)GetScreenWidth()/2 - 400, (int)GetScreenHeight()/2, (int)(progress*800), 50, RED);
+    DrawText(TextFormat("Loading %d/%d", loader->uploadedCount, loader->requestCount), (int)GetScreenWidth()/2 - 400, (int)GetScreenHeight()/2 + 75, 30, RAYWHITE);
+    EndDrawing();
+}
+
+//lets the other workers steal when there are jobs, called with the system lock held
+static void PushJob(JobSystem *system, int worker, Job job)
+{
+    JobDeque *deque = &system->deques[worker];
+    pthread_mutex_lock(&deque->lock);
+    deque->jobs[deque->tail%MaxQueuedJobs] = job;
+    deque->tail++;
+    pthread_mutex_unlock(&deque->lock);
+    system->queuedJobs++;
+}
+
+//newest job of the worker's own deque, or the oldest one of another worker's
+static bool TakeJob(JobSystem *system, int worker, Job *job)
+{
+    bool IsTaken = false;
+    for(int v = 0; v < system->workerCount && !IsTaken; v++){
+        JobDeque *deque = &system->deques[(worker + v)%system->workerCount];
+        pthread_mutex_lock(&deque->lock);
+        if(deque->tail > deque->head){
+            if(v == 0) *job = deque->jobs[--deque->tail%MaxQueuedJobs];
+            else *job = deque->jobs[deque->head++%MaxQueuedJobs];
+            IsTaken = true;
             
-            for(int j = 0; j < MaxNumberOfSpecialBullets; j++){
-                if(battleshipSpecialBullets[j].IsBulletFired){
-                    if(CheckCollisionBoxSphere(horizontalWalls[i], battleshipSpecialBullets[j].bulletPos, 1)){
-                        //play wall hit sound
-                        battleshipSpecialBullets[j].IsBulletFired = false;
-                    }
-                }
-            }
+            //back to the start whenever it drains so the counters never overflow in a long session
+            if(deque->head == deque->tail) deque->head = deque->tail = 0;
+        }
+        pthread_mutex_unlock(&deque->lock);
+    }
+    
+    if(IsTaken){
+        pthread_mutex_lock(&system->lock);
+        system->queuedJobs--;
+        pthread_mutex_unlock(&system->lock);
+    }
+    return IsTaken;
+}
+
+static void ReleaseJobTask(JobSystem *system, int worker, int task);
+
+//called with the system lock held once the last chunk of a task is done, readies the tasks waiting on it
+static void CompleteJobTask(JobSystem *system, int worker, int task)
+{
+    JobTask *node = &system->graph->tasks[task];
+    if(profiler.IsEnabled) profiler.current[node->phase] += (float)((GetProfilerTime() - node->readyTime)*1000.0);
+    
+    for(int d = 0; d < node->dependentCount; d++){
+        if(--system->graph->tasks[node->dependents[d]].pendingDependencies == 0) ReleaseJobTask(system, worker, node->dependents[d]);
+    }
+    if(--system->pendingTasks == 0) pthread_cond_broadcast(&system->wake);
+}
+
+//splits a ready task into chunks on the worker's deque, called with the system lock held
+static void ReleaseJobTask(JobSystem *system, int worker, int task)
+{
+    JobTask *node = &system->graph->tasks[task];
+    int count = (node->itemCount != NULL)? *node->itemCount : 1;
+    int chunkSize = count;
+    if(node->grainSize > 0 && count > node->grainSize){
+        chunkSize = node->grainSize;
+        if(count > chunkSize*MaxJobChunks) chunkSize = (count + MaxJobChunks - 1)/MaxJobChunks;
+    }
+    
+    if(profiler.IsEnabled) node->readyTime = GetProfilerTime();
+    node->pendingChunks = (count > 0)? (count + chunkSize - 1)/chunkSize : 0;
+    if(node->pendingChunks == 0){
+        CompleteJobTask(system, worker, task);
+        return;
+    }
+    for(int first = 0; first < count; first += chunkSize){
+        PushJob(system, worker, (Job){ task, first, (first + chunkSize < count)? first + chunkSize : count });
+    }
+    pthread_cond_broadcast(&system->wake);
+}
+
+static void RunJob(JobSystem *system, int worker, Job job)
+{
+    JobTask *node = &system->graph->tasks[job.task];
+    node->function(node->data, job.first, job.last);
+    
+    pthread_mutex_lock(&system->lock);
+    if(--node->pendingChunks == 0) CompleteJobTask(system, worker, job.task);
+    pthread_mutex_unlock(&system->lock);
+}
+
+static void *JobWorkerThread(void *arg)
+{
+    JobWorker *worker = (JobWorker *)arg;
+    JobSystem *system = worker->system;
+    
+    while(true){
+        Job job;
+        if(TakeJob(system, worker->index, &job)){
+            RunJob(system, worker->index, job);
+            continue;
         }
         
-        //checking if player and enemy bullets hit buildings
-        for(int i = 0; i < Building1Count; i++){
-            //checking for horizontal walls
-            for(int j = 0; j < MaxPlayerTankBullets; j++){
-                if(playerTankBullets[j].IsBulletFired){
-                    if(CheckCollisionBoxSphere(building1_BBs[i], playerTankBullets[j].bulletPos, 1)){
-                        //play wall hit sound
-                        playerTankBullets[j].IsBulletFired = false;
-                    }
-                }
+        pthread_mutex_lock(&system->lock);
+        while(!system->IsShuttingDown && system->queuedJobs == 0) pthread_cond_wait(&system->wake, &system->lock);
+        bool ToQuit = system->IsShuttingDown;
+        pthread_mutex_unlock(&system->lock);
+        if(ToQuit) return NULL;
+    }
+}
+
+//workerCount counts the thread that runs graphs, one or less keeps every task on it
+static void InitJobSystem(JobSystem *system, int workerCount)
+{
+    *system = (JobSystem){ 0 };
+    if(workerCount > MaxJobWorkers) workerCount = MaxJobWorkers;
+    if(workerCount < 1) workerCount = 1;
+    
+    pthread_mutex_init(&system->lock, NULL);
+    pthread_cond_init(&system->wake, NULL);
+    for(int w = 0; w < workerCount; w++) pthread_mutex_init(&system->deques[w].lock, NULL);
+    
+    //a worker whose thread fails to start just leaves an empty deque behind, the others still steal from each other
+    system->workerCount = workerCount;
+    for(int w = 1; w < workerCount; w++){
+        system->workers[w] = (JobWorker){ system, w };
+        if(pthread_create(&system->threads[system->threadCount], NULL, JobWorkerThread, &system->workers[w]) == 0) system->threadCount++;
+    }
+}
+
+static void ShutdownJobSystem(JobSystem *system)
+{
+    if(system->workerCount == 0) return;
+    
+    pthread_mutex_lock(&system->lock);
+    system->IsShuttingDown = true;
+    pthread_cond_broadcast(&system->wake);
+    pthread_mutex_unlock(&system->lock);
+    for(int t = 0; t < system->threadCount; t++) pthread_join(system->threads[t], NULL);
+    
+    for(int w = 0; w < system->workerCount; w++) pthread_mutex_destroy(&system->deques[w].lock);
+    pthread_cond_destroy(&system->wake);
+    pthread_mutex_destroy(&system->lock);
+    system->workerCount = 0;
+}
+
+static int AddJobTask(JobGraph *graph, JobFunction function, void *data, const int *itemCount, int grainSize, ProfilePhase phase)
+{
+    if(graph->taskCount >= MaxJobTasks) return -1;
+    graph->tasks[graph->taskCount] = (JobTask){ .function = function, .data = data, .itemCount = itemCount, .grainSize = grainSize, .phase = phase };
+    return graph->taskCount++;
+}
+
+static void AddJobDependency(JobGraph *graph, int task, int dependsOn)
+{
+    if(task < 0 || dependsOn < 0 || dependsOn >= task) return;
+    JobTask *node = &graph->tasks[dependsOn];
+    if(node->dependentCount >= MaxJobDependents) return;
+    node->dependents[node->dependentCount++] = task;
+    graph->tasks[task].pendingDependencies++;
+}
+
+//runs every task of the graph once and returns when all are done, the calling thread works as worker 0
+//results don't depend on the worker count as long as parallel tasks only write to their own items
+static void RunJobGraph(JobSystem *system, JobGraph *graph)
+{
+    //single threaded, tasks were added after what they depend on so adding order is a valid order
+    if(system->workerCount <= 1){
+        for(int t = 0; t < graph->taskCount; t++){
+            JobTask *node = &graph->tasks[t];
+            if(profiler.IsEnabled) node->readyTime = GetProfilerTime();
+            int count = (node->itemCount != NULL)? *node->itemCount : 1;
+            if(count > 0) node->function(node->data, 0, count);
+            if(profiler.IsEnabled) profiler.current[node->phase] += (float)((GetProfilerTime() - node->readyTime)*1000.0);
+        }
+        return;
+    }
+    
+    pthread_mutex_lock(&system->lock);
+    system->graph = graph;
+    system->pendingTasks = graph->taskCount;
+    for(int t = 0; t < graph->taskCount; t++){
+        if(graph->tasks[t].pendingDependencies == 0) ReleaseJobTask(system, 0, t);
+    }
+    pthread_mutex_unlock(&system->lock);
+    
+    while(true){
+        Job job;
+        if(TakeJob(system, 0, &job)){
+            RunJob(system, 0, job);
+            continue;
+        }
+        
+        pthread_mutex_lock(&system->lock);
+        while(system->pendingTasks > 0 && system->queuedJobs == 0) pthread_cond_wait(&system->wake, &system->lock);
+        bool IsDone = (system->pendingTasks == 0);
+        if(IsDone) system->graph = NULL;
+        pthread_mutex_unlock(&system->lock);
+        if(IsDone) return;
+    }
+}
+
+//skips blanks and copies the next word of a level line, stops at the end of the line or a comment
+static const char *ReadLevelWord(const char *cursor, char *word, int wordSize)
+{
+    int length = 0;
+    while(*cursor == ' ' || *cursor == '\t' || *cursor == '\r') cursor++;
+    while(*cursor != '\0' && *cursor != '\n' && *cursor != '#' && *cursor != ' ' && *cursor != '\t' && *cursor != '\r'){
+        if(length < wordSize - 1) word[length++] = *cursor;
+        cursor++;
+    }
+    word[length] = '\0';
+    return cursor;
+}
+
+//text form is one "keyword x y z" per line, "pickup health|maingun|mg x y z" for pickups
+//parsed twice, once to size every section and once to fill them, into the same layout as a compiled file
+static bool ParseLevelText(const char *text, unsigned char **data, int *dataSize)
+{
+    static const char *sectionKeywords[LEVEL_SECTION_COUNT] = {"wall_v", "wall_h", "building1", "tank", "apc", "pickup",
+                                                               "battleship_gun", "battleship_special_gun"};
+    static const char *pickupKeywords[] = {"health", "maingun", "mg"};
+    LevelFileHeader header = { 0 };
+    unsigned char *blob = NULL;
+    int blobSize = sizeof(LevelFileHeader);
+    
+    for(int pass = 0; pass < 2; pass++){
+        int filled[LEVEL_SECTION_COUNT] = { 0 };
+        int lineNumber = 0;
+        
+        for(const char *line = text; *line != '\0'; ){
+            const char *lineEnd = strchr(line, '\n');
+            if(lineEnd == NULL) lineEnd = line + strlen(line);
+            lineNumber++;
+            
+            char keyword[32];
+            const char *cursor = ReadLevelWord(line, keyword, sizeof(keyword));
+            line = (*lineEnd == '\n') ? lineEnd + 1 : lineEnd;
+            if(keyword[0] == '\0') continue;      //blank or comment line
+            
+            int section = -1;
+            for(int k = 0; k < LEVEL_SECTION_COUNT; k++){
+                if(strcmp(keyword, sectionKeywords[k]) == 0) section = k;
             }
-            for(int j = 0; j < MaxPlayerMGBullets; j++){
-                if(playerMGBullets[j].IsBulletFired){
-                    if(CheckCollisionBoxSphere(building1_BBs[i], playerMGBullets[j].bulletPos, 1)){
-                        //play wall hit sound
-                        playerMGBullets[j].IsBulletFired = false;
-                    }
+            
+            PickupData pickup = { 0 };
+            if(section == LEVEL_PICKUPS){
+                char pickupName[32];
+                cursor = ReadLevelWord(cursor, pickupName, sizeof(pickupName));
+                pickup.type = (PickupType)-1;
+                for(int t = 0; t < (int)(sizeof(pickupKeywords)/sizeof(pickupKeywords[0])); t++){
+                    if(strcmp(pickupName, pickupKeywords[t]) == 0) pickup.type = (PickupType)t;
+                }
+                if(pickup.type == (PickupType)-1){
+                    TraceLog(LOG_WARNING, "LEVEL: Line %d: unknown pickup type '%s'", lineNumber, pickupName);
+                    MemFree(blob);
+                    return false;
                 }
             }
             
-            for(int j = 0; j < MaxEnemyTankBullets; j++){
-                if(enemyTankBullets[j].IsBulletFired){
-                    if(CheckCollisionBoxSphere(building1_BBs[i], enemyTankBullets[j].bulletPos, 1)){
-                        //play wall hit sound
-                        enemyTankBullets[j].IsBulletFired = false;
-                    }
-                }
+            //strtof skips newlines too, so a short line would read into the next one, only a comment may follow z
+            Vector3 pos = { 0 };
+            float *components[3] = { &pos.x, &pos.y, &pos.z };
+            bool IsValid = true;
+            for(int c = 0; c < 3 && IsValid; c++){
+                char *end = NULL;
+                *components[c] = strtof(cursor, &end);
+                IsValid = (end != cursor && end <= lineEnd);
+                cursor = end;
+            }
+            while(IsValid && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r')) cursor++;
+            if(!IsValid || (cursor != lineEnd && *cursor != '#')){
+                TraceLog(LOG_WARNING, "LEVEL: Line %d: expected x y z after '%s'", lineNumber, keyword);
+                MemFree(blob);
+                return false;
             }
             
-            for(int j = 0; j < MaxEnemyMGBullets; j++){
-                if(enemyMGBullets[j].IsBulletFired){
-                    if(CheckCollisionBoxSphere(building1_BBs[i], enemyMGBullets[j].bulletPos, 1)){
-                        //play wall hit sound
-                        enemyMGBullets[j].IsBulletFired = false;
-                    }
+            if(strcmp(keyword, "player") == 0) header.playerStart = pos;
+            else if(strcmp(keyword, "level_model") == 0) header.levelModelPos = pos;
+            else if(strcmp(keyword, "battleship") == 0) header.battleshipPos = pos;
+            else if(section < 0){
+                TraceLog(LOG_WARNING, "LEVEL: Line %d: unknown keyword '%s'", lineNumber, keyword);
+                MemFree(blob);
+                return false;
+            }
+            else if(pass == 1 && section == LEVEL_PICKUPS){
+                pickup.pos = pos;
+                memcpy(blob + header.sectionOffset[section] + filled[section]*sizeof(PickupData), &pickup, sizeof(PickupData));
+            }
+            else if(pass == 1) memcpy(blob + header.sectionOffset[section] + filled[section]*sizeof(Vector3), &pos, sizeof(Vector3));
+            if(section >= 0) filled[section]++;
+        }
+        
+        //first pass only lays out the sections
+        if(pass == 0){
+            for(int k = 0; k < LEVEL_SECTION_COUNT; k++){
+                header.sectionOffset[k] = blobSize;
+                header.sectionCount[k] = filled[k];
+                blobSize += filled[k]*((k == LEVEL_PICKUPS) ? sizeof(PickupData) : sizeof(Vector3));
+            }
+            blob = (unsigned char *)MemAlloc(blobSize);
+        }
+    }
+    
+    memcpy(header.magic, LEVEL_MAGIC, 4);
+    header.version = LEVEL_VERSION;
+    header.vectorSize = sizeof(Vector3);
+    header.pickupSize = sizeof(PickupData);
+    memcpy(blob, &header, sizeof(LevelFileHeader));
+    
+    *data = blob;
+    *dataSize = blobSize;
+    return true;
+}
+
+//points the level's arrays straight into a compiled file, no per entity work, takes ownership of data
+static Level LoadLevelFromData(unsigned char *data, int dataSize)
+{
+    Level level = { 0 };
+    LevelFileHeader header;
+    bool IsValid = dataSize >= (int)sizeof(LevelFileHeader);
+    
+    if(IsValid){
+        memcpy(&header, data, sizeof(LevelFileHeader));
+        IsValid = memcmp(header.magic, LEVEL_MAGIC, 4) == 0 && header.version == LEVEL_VERSION &&
+                  header.vectorSize == sizeof(Vector3) && header.pickupSize == sizeof(PickupData);
+    }
+    for(int k = 0; IsValid && k < LEVEL_SECTION_COUNT; k++){
+        unsigned int recordSize = (k == LEVEL_PICKUPS) ? sizeof(PickupData) : sizeof(Vector3);
+        IsValid = header.sectionOffset[k]%4 == 0 && header.sectionOffset[k] <= (unsigned int)dataSize &&
+                  header.sectionCount[k] <= ((unsigned int)dataSize - header.sectionOffset[k])/recordSize;
+    }
+    if(!IsValid){
+        TraceLog(LOG_WARNING, "LEVEL: Not a level file, unsupported version or truncated");
+        MemFree(data);
+        return level;
+    }
+    
+    level.data = data;
+    level.dataSize = dataSize;
+    level.playerStart = header.playerStart;
+    level.levelModelPos = header.levelModelPos;
+    level.battleshipPos = header.battleshipPos;
+    level.verticalWalls = (const Vector3 *)(data + header.sectionOffset[LEVEL_VERTICAL_WALLS]);
+    level.horizontalWalls = (const Vector3 *)(data + header.sectionOffset[LEVEL_HORIZONTAL_WALLS]);
+    level.buildings = (const Vector3 *)(data + header.sectionOffset[LEVEL_BUILDINGS]);
+    level.enemyTanks = (const Vector3 *)(data + header.sectionOffset[LEVEL_ENEMY_TANKS]);
+    level.enemyAPCs = (const Vector3 *)(data + header.sectionOffset[LEVEL_ENEMY_APCS]);
+    level.pickups = (const PickupData *)(data + header.sectionOffset[LEVEL_PICKUPS]);
+    level.battleshipGuns = (const Vector3 *)(data + header.sectionOffset[LEVEL_BATTLESHIP_GUNS]);
+    level.battleshipSpecialGuns = (const Vector3 *)(data + header.sectionOffset[LEVEL_BATTLESHIP_SPECIAL_GUNS]);
+    level.verticalWallCount = header.sectionCount[LEVEL_VERTICAL_WALLS];
+    level.horizontalWallCount = header.sectionCount[LEVEL_HORIZONTAL_WALLS];
+    level.buildingCount = header.sectionCount[LEVEL_BUILDINGS];
+    level.enemyTankCount = header.sectionCount[LEVEL_ENEMY_TANKS];
+    level.enemyAPCCount = header.sectionCount[LEVEL_ENEMY_APCS];
+    level.pickupCount = header.sectionCount[LEVEL_PICKUPS];
+    level.battleshipGunCount = header.sectionCount[LEVEL_BATTLESHIP_GUNS];
+    level.battleshipSpecialGunCount = header.sectionCount[LEVEL_BATTLESHIP_SPECIAL_GUNS];
+    return level;
+}
+
+//loads a compiled .lvl in one read, or parses the text form when the file doesn't start with the magic
+static Level LoadLevel(const char *fileName)
+{
+    int dataSize = 0;
+    unsigned char *data = LoadFileData(fileName, &dataSize);
+    if(data == NULL) return (Level){ 0 };
+    
+    if(dataSize < 4 || memcmp(data, LEVEL_MAGIC, 4) != 0){
+        char *text = (char *)MemAlloc(dataSize + 1);
+        memcpy(text, data, dataSize);
+        text[dataSize] = '\0';
+        UnloadFileData(data);
+        
+        bool IsParsed = ParseLevelText(text, &data, &dataSize);
+        MemFree(text);
+        if(!IsParsed){
+            TraceLog(LOG_WARNING, "LEVEL: [%s] Failed to parse level text", fileName);
+            return (Level){ 0 };
+        }
+    }
+    
+    Level level = LoadLevelFromData(data, dataSize);
+    if(level.data != NULL){
+        TraceLog(LOG_INFO, "LEVEL: [%s] Loaded %d walls, %d buildings, %d enemies, %d pickups", fileName,
+                 level.verticalWallCount + level.horizontalWallCount, level.buildingCount, level.enemyTankCount + level.enemyAPCCount, level.pickupCount);
+    }
+    return level;
+}
+
+static void UnloadLevel(Level level)
+{
+    MemFree(level.data);
+}
+
+//a loaded level already holds the compiled layout, exporting is a single write
+static bool ExportLevel(Level level, const char *fileName)
+{
+    return SaveFileData(fileName, level.data, level.dataSize);
+}
+
+//places the wall, building and battleship boxes and builds the static collision grid
+static void InitWorld(World *world, const Level *level, BoundingBox verticalWallBounds, BoundingBox horizontalWallBounds, BoundingBox building1Bounds, const TriangleBvh *battleshipBvh)
+{
+    BoundingBox *staticBoxes = (BoundingBox *)malloc((level->verticalWallCount + level->horizontalWallCount + level->buildingCount + 1)*sizeof(BoundingBox));
+    int staticBoxCount = 0;
+    
+    //setting position of vertical wall pieces
+    for(int i = 0; i < level->verticalWallCount; i++){
+        staticBoxes[staticBoxCount++] = (BoundingBox){Vector3Add(verticalWallBounds.min, level->verticalWalls[i]), Vector3Add(verticalWallBounds.max, level->verticalWalls[i])};
+    }
+    
+    //setting position of horizontal wall pieces
+    for(int i = 0; i < level->horizontalWallCount; i++){
+        staticBoxes[staticBoxCount++] = (BoundingBox){Vector3Add(horizontalWallBounds.min, level->horizontalWalls[i]), Vector3Add(horizontalWallBounds.max, level->horizontalWalls[i])};
+    }
+    
+    //setting up bounding boxes for buildings
+    for(int i = 0; i < level->buildingCount; i++){
+        staticBoxes[staticBoxCount++] = (BoundingBox){Vector3Add(building1Bounds.min, level->buildings[i]), Vector3Add(building1Bounds.max, level->buildings[i])};
+    }
+    
+    world->level = level;
+    world->staticGrid = LoadStaticGrid(staticBoxes, staticBoxCount, 10.0f);
+    world->battleship_Pos = level->battleshipPos;
+    
+    //the hull's triangles stay in model space, queries are moved into it instead
+    Matrix battleshipTransform = MatrixMultiply(MatrixRotateY(DEG2RAD * BattleshipYaw), MatrixTranslate(level->battleshipPos.x, level->battleshipPos.y, level->battleshipPos.z));
+    world->battleshipBvh = battleshipBvh;
+    world->battleshipToModel = MatrixInvert(battleshipTransform);
+    if(battleshipBvh->nodeCount > 0) world->battleshipBox = GetTransformedBoundingBox(battleshipBvh->nodes[0].bounds, battleshipTransform);
+    else world->battleshipBox = (BoundingBox){level->battleshipPos, level->battleshipPos};
+    
+    //enemies steer around the static boxes and the battleship in 2 unit cells
+    staticBoxes[staticBoxCount] = world->battleshipBox;
+    world->navGrid = LoadNavGrid(staticBoxes, staticBoxCount + 1, 2.0f, 1.5f);
+    world->flowFieldHeap = LoadFlowFieldHeap(&world->navGrid);
+    free(staticBoxes);
+}
+
+static void UnloadWorld(World *world)
+{
+    UnloadStaticGrid(world->staticGrid);
+    UnloadNavGrid(world->navGrid);
+    free(world->flowFieldHeap);
+}
+
+//earliest fraction of start->end at which a sphere moving along it touches the battleship hull, -1 if it never does
+//the hull's bounds are tested first and only a path that gets past them walks the BVH
+static float GetBattleshipSweptHitTime(const World *world, Vector3 start, Vector3 end, float radius)
+{
+    if(GetSweptBoxHitTime(start, end, radius, world->battleshipBox) < 0.0f) return -1.0f;
+    return GetTriangleBvhSweptHitTime(world->battleshipBvh, Vector3Transform(start, world->battleshipToModel), Vector3Transform(end, world->battleshipToModel), radius);
+}
+
+static bool CheckCollisionBattleshipSphere(const World *world, Vector3 center, float radius)
+{
+    if(!CheckCollisionBoxSphere(world->battleshipBox, center, radius)) return false;
+    return CheckCollisionTriangleBvhSphere(world->battleshipBvh, Vector3Transform(center, world->battleshipToModel), radius);
+}
+
+//bytes for an array of the game state's block, zeroed and 16 byte aligned, NULL while only measuring
+static void *PushGameMemory(GameMemory *memory, int size)
+{
+    int offset = (memory->used + 15) & ~15;
+    memory->used = offset + size;
+    if(memory->base == NULL) return NULL;
+    return memory->base + offset;
+}
+
+//lays a GameState and every array it points into out in memory and sets them up for the start of a match
+//a measuring memory only adds up the sizes and gets NULL back
+static GameState *InitGameState(GameMemory *memory, const World *world)
+{
+    static const int projectileCapacities[PROJECTILE_TYPE_COUNT] = {MaxPlayerTankBullets, MaxPlayerMGBullets, MaxEnemyTankBullets,
+                                                                    MaxEnemyMGBullets, MaxNumberOfBattleShipTankBullets, MaxNumberOfSpecialBullets};
+    static const float projectileSpeeds[PROJECTILE_TYPE_COUNT] = {60, 60, 60, 60, 60, 60};      //world units per second
+    static const float projectileRanges[PROJECTILE_TYPE_COUNT] = {100, 100, 20, 100, 20, 20};
+    
+    const Level *level = world->level;
+    
+    GameState *state = (GameState *)PushGameMemory(memory, sizeof(GameState));
+    EnemyTank *enemyTanks = (EnemyTank *)PushGameMemory(memory, (level->enemyTankCount + 1)*sizeof(EnemyTank));
+    EnemyTank *enemyAPCs = (EnemyTank *)PushGameMemory(memory, (level->enemyAPCCount + 1)*sizeof(EnemyTank));
+    Pickup *pickups = (Pickup *)PushGameMemory(memory, (level->pickupCount + 1)*sizeof(Pickup));
+    
+    //list of all bullets fired by the player, enemies and the battleship
+    Projectiles projectiles = LoadProjectiles(memory, projectileCapacities, projectileSpeeds, projectileRanges);
+    
+    //everything the hit tests look up by position, bullets join it once they move
+    int dynamicCapacities[DYNAMIC_KIND_COUNT] = {level->enemyTankCount, level->enemyAPCCount, level->pickupCount, projectiles.capacity};
+    DynamicGrid dynamicGrid = LoadDynamicGrid(memory, dynamicCapacities, 8.0f);
+    FlowField flowField = LoadFlowField(memory, &world->navGrid);
+    if(memory->base == NULL) return NULL;
+    
+    state->world = world;
+    state->memorySize = memory->size;
+    state->enemyTankCount = level->enemyTankCount;
+    state->enemyAPCCount = level->enemyAPCCount;
+    state->pickupCount = level->pickupCount;
+    state->enemyTanks = enemyTanks;
+    state->enemyAPCs = enemyAPCs;
+    state->AllPickups = pickups;
+    state->projectiles = projectiles;
+    state->dynamicGrid = dynamicGrid;
+    state->flowField = flowField;
+    
+    //initializing list of enemy tanks
+    for(int i = 0; i < state->enemyTankCount; i++){
+        state->enemyTanks[i].enemyType = TANK;
+        state->enemyTanks[i].enemyModelYaw = 0;
+        state->enemyTanks[i].enemyPrevModelYaw = 0;
+        state->enemyTanks[i].enemyPos = level->enemyTanks[i];
+        state->enemyTanks[i].enemyPrevPos = level->enemyTanks[i];
+        state->enemyTanks[i].enemyDir = (Vector3){0.0f, 0.0f, 0.0f};
+        state->enemyTanks[i].enemyHealth = 60;
+        state->enemyTanks[i].enemyRange = 25;
+        state->enemyTanks[i].enemyMoveSpeed = 6;
+        state->enemyTanks[i].enemyYaw = 180;
+        state->enemyTanks[i].IsEnemyAlive = true;
+        state->enemyTanks[i].enemyToPlayerAngle = 0;
+        state->enemyTanks[i].enemyDamage = EnemyTankDamage;
+        state->enemyTanks[i].CanTankFire = true;
+        state->enemyTanks[i].enemyTankFireRate = 2;
+        state->enemyTanks[i].enemyTimeTillLastShot = 0;
+        state->enemyTanks[i].sightEnemyCell = -2;
+        state->enemyTanks[i].sightPlayerCell = -2;
+    }
+    
+    //initializing list of enemy APCs
+    for(int i = 0; i < state->enemyAPCCount; i++){
+        state->enemyAPCs[i].enemyType = APC;
+        state->enemyAPCs[i].enemyModelYaw = 0;
+        state->enemyAPCs[i].enemyPrevModelYaw = 0;
+        state->enemyAPCs[i].enemyPos = level->enemyAPCs[i];
+        state->enemyAPCs[i].enemyPrevPos = level->enemyAPCs[i];
+        state->enemyAPCs[i].enemyDir = (Vector3){0.0f, 0.0f, 0.0f};
+        state->enemyAPCs[i].enemyHealth = 30;
+        state->enemyAPCs[i].enemyRange = 15;
+        state->enemyAPCs[i].enemyMoveSpeed = 9;
+        state->enemyAPCs[i].enemyYaw = 180;
+        state->enemyAPCs[i].IsEnemyAlive = true;
+        state->enemyAPCs[i].enemyToPlayerAngle = 0;
+        state->enemyAPCs[i].enemyDamage = 1;
+        state->enemyAPCs[i].CanTankFire = true;
+        state->enemyAPCs[i].enemyTankFireRate = 0.125f;
+        state->enemyAPCs[i].enemyTimeTillLastShot = 0;
+        state->enemyAPCs[i].sightEnemyCell = -2;
+        state->enemyAPCs[i].sightPlayerCell = -2;
+    }
+    
+    //initializing pickups
+    for(int i = 0; i < state->pickupCount; i++){
+        state->AllPickups[i].pickupType = level->pickups[i].type;
+        state->AllPickups[i].pickupPos = level->pickups[i].pos;
+        state->AllPickups[i].pickupYaw = 0;
+        state->AllPickups[i].pickupPrevYaw = 0;
+        state->AllPickups[i].IsPickedUp = false;
+        state->AllPickups[i].pickupRotSpeed = 60;
+    }
+    
+    //player attributes
+    state->playerPos = level->playerStart;
+    state->playerYaw = 180;
+    state->prevPlayerPos = state->playerPos;
+    state->prevPlayerYaw = state->playerYaw;
+    state->CurrentPlayerHealth = 100;
+    state->CurrentMainGunAmmo = 20;
+    state->CurrentMGAmmo = 150;
+    state->CanPlayerFireTank = true;
+    state->CanPlayerFireMG = true;
+    
+    state->CurrentBattleshipHealth = MaxBattleshipHealth;
+    state->CanBattleshipFire = true;
+    
+    for(int i = 0; i < state->enemyTankCount; i++) UpdateDynamicGridItem(&state->dynamicGrid, DYNAMIC_ENEMY_TANK, i, state->enemyTanks[i].enemyPos, 3);
+    for(int i = 0; i < state->enemyAPCCount; i++) UpdateDynamicGridItem(&state->dynamicGrid, DYNAMIC_ENEMY_APC, i, state->enemyAPCs[i].enemyPos, 3);
+    for(int i = 0; i < state->pickupCount; i++) UpdateDynamicGridItem(&state->dynamicGrid, DYNAMIC_PICKUP, i, state->AllPickups[i].pickupPos, 1);
+    
+    return state;
+}
+
+//a new game state in one block, sized by a measuring pass over the same layout
+//the match start snapshot lives right behind the block in the same allocation
+static GameState *LoadGameState(const World *world)
+{
+    GameMemory memory = { 0 };
+    InitGameState(&memory, world);
+    int size = memory.used;
+    memory = (GameMemory){ (unsigned char *)calloc(2, size), size, 0 };
+    
+    GameState *state = InitGameState(&memory, world);
+    state->matchStart = memory.base + size;
+    TakeGameSnapshot(state, memory.base + size);
+    return state;
+}
+
+static void UnloadGameState(GameState *state)
+{
+    free(state);
+}
+
+//copies the whole block in one go, the snapshot keeps the block's own addresses so it can only go back into the state it came from
+static void TakeGameSnapshot(const GameState *state, unsigned char *snapshot)
+{
+    memcpy(snapshot, state, state->memorySize);
+}
+
+static void RestoreGameSnapshot(GameState *state, const unsigned char *snapshot)
+{
+    memcpy(state, snapshot, state->memorySize);
+}
+
+static SnapshotRing LoadSnapshotRing(const GameState *state, int capacity)
+{
+    SnapshotRing ring = { 0 };
+    ring.snapshotSize = state->memorySize;
+    ring.capacity = capacity;
+    ring.newest = -1;
+    ring.snapshots = (unsigned char *)malloc((size_t)capacity*ring.snapshotSize);
+    return ring;
+}
+
+static void UnloadSnapshotRing(SnapshotRing ring)
+{
+    free(ring.snapshots);
+}
+
+static void PushSnapshotRing(SnapshotRing *ring, const GameState *state)
+{
+    ring->newest = (ring->newest + 1)%ring->capacity;
+    if(ring->count < ring->capacity) ring->count++;
+    TakeGameSnapshot(state, ring->snapshots + (size_t)ring->newest*ring->snapshotSize);
+}
+
+//puts the state back to the newest snapshot and drops it, so every call goes further back, false once the ring is empty
+static bool PopSnapshotRing(SnapshotRing *ring, GameState *state)
+{
+    if(ring->count == 0) return false;
+    RestoreGameSnapshot(state, ring->snapshots + (size_t)ring->newest*ring->snapshotSize);
+    ring->newest = (ring->newest + ring->capacity - 1)%ring->capacity;
+    ring->count--;
+    return true;
+}
+
+//queues a sound for whoever is presenting the simulation, extra sounds past the per step budget are dropped
+static void PushSoundEvent(GameState *state, SoundType sound, Vector3 pos)
+{
+    if(state->soundEventCount < MaxSoundEventsPerStep) state->soundEvents[state->soundEventCount++] = (SoundEvent){sound, pos};
+}
+//gives every sound type its own slice of aliases, they share the loaded sound's samples
+//streamed types take streams[type] instead and get one voice, a music stream can't overlap itself
+static void InitVoiceManager(VoiceManager *voices, const Sound *sounds, const Music *streams)
+{
+    *voices = (VoiceManager){ 0 };
+    for(int t = 0; t < SOUND_TYPE_COUNT; t++){
+        voices->firstVoice[t] = voices->voiceCount;
+        if(soundSettings[t].IsStreamed){
+            voices->streams[t] = streams[t];
+            if(voices->voiceCount < MaxVoices) voices->voiceType[voices->voiceCount++] = (SoundType)t;
+            continue;
+        }
+        for(int v = 0; v < soundSettings[t].maxVoices && voices->voiceCount < MaxVoices; v++){
+            voices->voices[voices->voiceCount] = LoadSoundAlias(sounds[t]);
+            voices->voiceType[voices->voiceCount] = (SoundType)t;
+            voices->voiceCount++;
+        }
+    }
+}
+
+static void UnloadVoiceManager(VoiceManager *voices)
+{
+    for(int v = 0; v < voices->voiceCount; v++){
+        if(!soundSettings[voices->voiceType[v]].IsStreamed) UnloadSoundAlias(voices->voices[v]);
+    }
+    voices->voiceCount = 0;
+}
+
+static bool IsVoicePlaying(const VoiceManager *voices, int voice)
+{
+    SoundType type = voices->voiceType[voice];
+    if(soundSettings[type].IsStreamed) return IsMusicStreamPlaying(voices->streams[type]);
+    return IsSoundPlaying(voices->voices[voice]);
+}
+
+static void StopVoice(VoiceManager *voices, int voice)
+{
+    SoundType type = voices->voiceType[voice];
+    if(soundSettings[type].IsStreamed) StopMusicStream(voices->streams[type]);
+    else StopSound(voices->voices[voice]);
+}
+
+//restarts from the beginning when the voice is still playing
+static void StartVoice(VoiceManager *voices, int voice, float gain)
+{
+    SoundType type = voices->voiceType[voice];
+    if(soundSettings[type].IsStreamed){
+        StopMusicStream(voices->streams[type]);
+        SetMusicVolume(voices->streams[type], gain);
+        PlayMusicStream(voices->streams[type]);
+    }
+    else {
+        SetSoundVolume(voices->voices[voice], gain);
+        PlaySound(voices->voices[voice]);
+    }
+}
+
+//refills the buffers of streamed voices, once a frame
+static void UpdateVoiceManager(VoiceManager *voices)
+{
+    for(int t = 0; t < SOUND_TYPE_COUNT; t++){
+        if(soundSettings[t].IsStreamed && IsMusicStreamPlaying(voices->streams[t])) UpdateMusicStream(voices->streams[t]);
+    }
+}
+
+//plays one step's sound events through the pool
+//events of one type are coalesced into a single trigger at the closest event's volume, so a step costs at most one PlaySound per type
+//overlapping triggers take a free voice of their type, or restart its oldest one past maxVoices
+//once MaxActiveVoices are playing, a new sound only plays by stopping a quieter voice of lower priority
+static void PlaySoundEvents(VoiceManager *voices, const SoundEvent *events, int eventCount, Vector3 listenerPos)
+{
+    float gain[SOUND_TYPE_COUNT] = { 0 };
+    bool IsRequested[SOUND_TYPE_COUNT] = { 0 };
+    for(int i = 0; i < eventCount; i++){
+        SoundType type = events[i].sound;
+        float eventGain = 1.0f - Vector3Distance(events[i].pos, listenerPos)/soundSettings[type].audibleRange;
+        if(eventGain > gain[type]) gain[type] = eventGain;
+        IsRequested[type] = true;
+    }
+    
+    //requests by priority, louder first within one priority
+    int order[SOUND_TYPE_COUNT];
+    int requestCount = 0;
+    for(int t = 0; t < SOUND_TYPE_COUNT; t++){
+        if(!IsRequested[t]) continue;
+        if(gain[t] < MinVoiceGain){
+            voices->droppedCount++;
+            continue;
+        }
+        int k = requestCount++;
+        while(k > 0 && (soundSettings[order[k - 1]].priority < soundSettings[t].priority ||
+                        (soundSettings[order[k - 1]].priority == soundSettings[t].priority && gain[order[k - 1]] < gain[t]))){
+            order[k] = order[k - 1];
+            k--;
+        }
+        order[k] = t;
+    }
+    if(requestCount == 0) return;
+    
+    bool IsPlaying[MaxVoices];
+    int activeCount = 0;
+    for(int v = 0; v < voices->voiceCount; v++){
+        IsPlaying[v] = IsVoicePlaying(voices, v);
+        activeCount += IsPlaying[v];
+    }
+    
+    for(int r = 0; r < requestCount; r++){
+        SoundType type = (SoundType)order[r];
+        int first = voices->firstVoice[type];
+        int last = first + (soundSettings[type].IsStreamed ? 1 : soundSettings[type].maxVoices);
+        if(last > voices->voiceCount) last = voices->voiceCount;
+        if(first >= last) continue;
+        
+        int freeVoice = -1, oldestVoice = first;
+        for(int v = first; v < last; v++){
+            if(!IsPlaying[v] && freeVoice < 0) freeVoice = v;
+            if(voices->voiceStartTime[v] < voices->voiceStartTime[oldestVoice]) oldestVoice = v;
+        }
+        
+        if(freeVoice >= 0 && activeCount >= MaxActiveVoices){
+            int victim = -1;
+            for(int v = 0; v < voices->voiceCount; v++){
+                if(!IsPlaying[v] || soundSettings[voices->voiceType[v]].priority >= soundSettings[type].priority) continue;
+                if(victim < 0 || voices->voiceGain[v] < voices->voiceGain[victim]) victim = v;
+            }
+            if(victim < 0){
+                voices->droppedCount++;
+                continue;
+            }
+            StopVoice(voices, victim);
+            IsPlaying[victim] = false;
+            activeCount--;
+        }
+        
+        int voice = (freeVoice >= 0) ? freeVoice : oldestVoice;
+        if(!IsPlaying[voice]) activeCount++;
+        IsPlaying[voice] = true;
+        StartVoice(voices, voice, gain[type]);
+        voices->voiceStartTime[voice] = GetTime();
+        voices->voiceGain[voice] = gain[type];
+        voices->playedCount++;
+    }
+}
+
+//offline conversion for sound assets, QOA keeps effects at about a fifth of 16 bit PCM and loads like any other sound
+static bool CompressAudio(const char *fileName, const char *outputFileName)
+{
+    Wave wave = LoadWave(fileName);
+    if(wave.data == NULL) return false;
+    
+    //the QOA encoder takes 16 bit samples only
+    if(wave.sampleSize != 16) WaveFormat(&wave, wave.sampleRate, 16, wave.channels);
+    bool IsExported = ExportWave(wave, outputFileName);
+    if(IsExported) TraceLog(LOG_INFO, "AUDIO: [%s] Compressed to %s", fileName, outputFileName);
+    UnloadWave(wave);
+    return IsExported;
+}
+
+
+//pointing the flow field at the player's cell before any enemy reads it, rebuilt only when the player changed cell
+static void UpdateFlowFieldJob(void *data, int first, int last)
+{
+    (void)first; (void)last;
+    GameState *state = ((SimJobData *)data)->state;
+    UpdateFlowField(&state->flowField, &state->world->navGrid, state->world->flowFieldHeap, state->playerPos);
+}
+
+//whether an enemy can see the player, the ray is only cast again once the enemy or the player has entered another nav cell
+static bool UpdateEnemyLineOfSight(const GameState *state, EnemyTank *enemy)
+{
+    const World *world = state->world;
+    int enemyCell = GetNavCell(&world->navGrid, enemy->enemyPos);
+    int playerCell = GetNavCell(&world->navGrid, state->playerPos);
+    if(enemyCell != enemy->sightEnemyCell || playerCell != enemy->sightPlayerCell){
+        Vector3 eye = (Vector3){enemy->enemyPos.x, enemy->enemyPos.y + 0.5f, enemy->enemyPos.z};
+        Vector3 target = (Vector3){state->playerPos.x, state->playerPos.y + 0.5f, state->playerPos.z};
+        enemy->IsPlayerInSight = IsStaticGridSegmentClear(&world->staticGrid, eye, target) && GetBattleshipSweptHitTime(world, eye, target, 0.0f) < 0.0f;
+        enemy->sightEnemyCell = enemyCell;
+        enemy->sightPlayerCell = playerCell;
+    }
+    return enemy->IsPlayerInSight;
+}
+
+//signed turn in degrees from yaw to targetYaw the short way round, in [-180, 180)
+static float GetYawError(float targetYaw, float yaw)
+{
+    float error = fmodf(targetYaw - yaw + 180.0f, 360.0f);
+    if(error < 0.0f) error += 360.0f;
+    return error - 180.0f;
+}
+
+//turning enemy tanks [first, last) that can see the player in range towards it, a tank lined up with a loaded gun only asks to fire
+//and one out of range or sight but inside the pursuit range drives towards the player, turning to face the way it drives
+static void UpdateEnemyTanksJob(void *data, int first, int last)
+{
+    GameState *state = ((SimJobData *)data)->state;
+    float dt = ((SimJobData *)data)->dt;
+    float turnStep = EnemyTurnSpeed*dt;
+    for(int i = first; i < last; i++){
+        state->enemyTanks[i].WantsToFire = false;
+        state->enemyTanks[i].enemyPrevModelYaw = state->enemyTanks[i].enemyModelYaw;
+        state->enemyTanks[i].enemyPrevPos = state->enemyTanks[i].enemyPos;
+        if(state->enemyTanks[i].IsEnemyAlive){
+            if(Vector3Distance(state->enemyTanks[i].enemyPos, state->playerPos) <= state->enemyTanks[i].enemyRange && UpdateEnemyLineOfSight(state, &state->enemyTanks[i])){
+                state->enemyTanks[i].enemyDir = (Vector3){cos(DEG2RAD * state->enemyTanks[i].enemyYaw), 0.0f, sin(DEG2RAD * state->enemyTanks[i].enemyYaw)};
+                Vector3 enemyToPlayerDir = (Vector3){state->playerPos.x - state->enemyTanks[i].enemyPos.x,
+                                                    state->playerPos.y - state->enemyTanks[i].enemyPos.y,
+                                                    state->playerPos.z - state->enemyTanks[i].enemyPos.z};
+                float angleToRotate = -(atan2(enemyToPlayerDir.z,enemyToPlayerDir.x)) * 180.0f/3.14f + 90.0f;
+                state->enemyTanks[i].enemyToPlayerAngle = angleToRotate;
+                float angleError = GetYawError(angleToRotate, state->enemyTanks[i].enemyYaw);
+                
+                if(fabs(angleError) > 1){
+                    //never turning past the player, a big step at a low tick rate would swing back and forth
+                    float step = fminf(turnStep, fabsf(angleError));
+                    if(angleError > 1) state->enemyTanks[i].enemyYaw += step;
+                    else if(angleError < 1) state->enemyTanks[i].enemyYaw -= step;
+                }else{
+                    //shoot at player tank
+                    if(state->enemyTanks[i].CanTankFire) state->enemyTanks[i].WantsToFire = true;
+                }
+                
+                state->enemyTanks[i].enemyModelYaw = state->enemyTanks[i].enemyYaw * 3.0f;
+            }else if(Vector3Distance(state->enemyTanks[i].enemyPos, state->playerPos) <= EnemyPursuitRange){
+                //out of gun range or sight, closing in along the shared flow field and turning to face the way it drives
+                Vector3 flow = GetFlowFieldDirection(&state->flowField, &state->world->navGrid, state->enemyTanks[i].enemyPos);
+                if(flow.x != 0.0f || flow.z != 0.0f){
+                    float angleError = GetYawError(-(atan2(flow.z, flow.x)) * 180.0f/3.14f + 90.0f, state->enemyTanks[i].enemyYaw);
+                    float step = fminf(turnStep, fabsf(angleError));
+                    state->enemyTanks[i].enemyYaw += (angleError > 0)? step : -step;
+                    state->enemyTanks[i].enemyModelYaw = state->enemyTanks[i].enemyYaw * 3.0f;
                 }
+                state->enemyTanks[i].enemyPos = Vector3Add(state->enemyTanks[i].enemyPos, Vector3Scale(flow, state->enemyTanks[i].enemyMoveSpeed*dt));
             }
-            
-            //checking for battleship bullets hitting buildings
-            for(int j = 0; j < MaxNumberOfBattleShipTankBullets; j++){
-                if(battleshipTankBullets[j].IsBulletFired){
-                    if(CheckCollisionBoxSphere(horizontalWalls[i], battleshipTankBullets[j].bulletPos, 1)){
-                        //play wall hit sound
-                        battleshipTankBullets[j].IsBulletFired = false;
-                    }
+            if(state->enemyTanks[i].enemyHealth <= 0){
+                state->enemyTanks[i].IsEnemyAlive = false;
+            }    
+        }
+    }
+}
+
+//same for enemy APCs [first, last)
+static void UpdateEnemyAPCsJob(void *data, int first, int last)
+{
+    GameState *state = ((SimJobData *)data)->state;
+    float dt = ((SimJobData *)data)->dt;
+    float turnStep = EnemyTurnSpeed*dt;
+    for(int i = first; i < last; i++){
+        state->enemyAPCs[i].WantsToFire = false;
+        state->enemyAPCs[i].enemyPrevModelYaw = state->enemyAPCs[i].enemyModelYaw;
+        state->enemyAPCs[i].enemyPrevPos = state->enemyAPCs[i].enemyPos;
+        if(state->enemyAPCs[i].IsEnemyAlive){
+            if(Vector3Distance(state->enemyAPCs[i].enemyPos, state->playerPos) <= state->enemyAPCs[i].enemyRange && UpdateEnemyLineOfSight(state, &state->enemyAPCs[i])){
+                state->enemyAPCs[i].enemyDir = (Vector3){cos(DEG2RAD * state->enemyAPCs[i].enemyYaw), 0.0f, sin(DEG2RAD * state->enemyAPCs[i].enemyYaw)};
+                Vector3 enemyToPlayerDir = (Vector3){state->playerPos.x - state->enemyAPCs[i].enemyPos.x,
+                                                    state->playerPos.y - state->enemyAPCs[i].enemyPos.y,
+                                                    state->playerPos.z - state->enemyAPCs[i].enemyPos.z};
+                float angleToRotate = -(atan2(enemyToPlayerDir.z,enemyToPlayerDir.x)) * 180.0f/3.14f + 90.0f;
+                state->enemyAPCs[i].enemyToPlayerAngle = angleToRotate;
+                float angleError = GetYawError(angleToRotate, state->enemyAPCs[i].enemyYaw);
+                
+                if(fabs(angleError) > 1){
+                    //never turning past the player, a big step at a low tick rate would swing back and forth
+                    float step = fminf(turnStep, fabsf(angleError));
+                    if(angleError > 1) state->enemyAPCs[i].enemyYaw += step;
+                    else if(angleError < 1) state->enemyAPCs[i].enemyYaw -= step;
+                }else{
+                    //shoot machine gun at player tank 
+                    if(state->enemyAPCs[i].CanTankFire) state->enemyAPCs[i].WantsToFire = true;
+                }
+                
+                state->enemyAPCs[i].enemyModelYaw = state->enemyAPCs[i].enemyYaw;
+            }else if(Vector3Distance(state->enemyAPCs[i].enemyPos, state->playerPos) <= EnemyPursuitRange){
+                //out of gun range or sight, closing in along the shared flow field and turning to face the way it drives
+                Vector3 flow = GetFlowFieldDirection(&state->flowField, &state->world->navGrid, state->enemyAPCs[i].enemyPos);
+                if(flow.x != 0.0f || flow.z != 0.0f){
+                    float angleError = GetYawError(-(atan2(flow.z, flow.x)) * 180.0f/3.14f + 90.0f, state->enemyAPCs[i].enemyYaw);
+                    float step = fminf(turnStep, fabsf(angleError));
+                    state->enemyAPCs[i].enemyYaw += (angleError > 0)? step : -step;
+                    state->enemyAPCs[i].enemyModelYaw = state->enemyAPCs[i].enemyYaw;
+                }
+                state->enemyAPCs[i].enemyPos = Vector3Add(state->enemyAPCs[i].enemyPos, Vector3Scale(flow, state->enemyAPCs[i].enemyMoveSpeed*dt));
+            }
+            if(state->enemyAPCs[i].enemyHealth <= 0){
+                state->enemyAPCs[i].IsEnemyAlive = false;
+            }    
+        }
+    }
+}
+
+//spawning the shots the AI jobs asked for, tanks then APCs in index order so bullet slots and sounds don't depend on the job split
+static void FireEnemyWeaponsJob(void *data, int first, int last)
+{
+    (void)first; (void)last;
+    GameState *state = ((SimJobData *)data)->state;
+    for(int i = 0; i < state->enemyTankCount; i++){
+        if(state->enemyTanks[i].WantsToFire){
+            Vector3 muzzlePos = (Vector3){state->enemyTanks[i].enemyPos.x, state->enemyTanks[i].enemyPos.y + 0.5f, state->enemyTanks[i].enemyPos.z};
+            if(SpawnProjectile(&state->projectiles, ENEMY_TANK_BULLET, muzzlePos, state->enemyTanks[i].enemyYaw, state->enemyTanks[i].enemyDamage, i) >= 0){
+                state->enemyTanks[i].CanTankFire = false;
+                PushSoundEvent(state, ENEMY_TANK_GUN_SOUND, state->enemyTanks[i].enemyPos);
+            }
+        }
+    }
+    for(int i = 0; i < state->enemyAPCCount; i++){
+        if(state->enemyAPCs[i].WantsToFire){
+            Vector3 muzzlePos = (Vector3){state->enemyAPCs[i].enemyPos.x, state->enemyAPCs[i].enemyPos.y + 0.5f, state->enemyAPCs[i].enemyPos.z};
+            if(SpawnProjectile(&state->projectiles, ENEMY_MG_BULLET, muzzlePos, state->enemyAPCs[i].enemyYaw, state->enemyAPCs[i].enemyDamage, i) >= 0){
+                state->enemyAPCs[i].CanTankFire = false;
+                PushSoundEvent(state, PLAYER_MG_SOUND, state->enemyAPCs[i].enemyPos);
+            }
+        }
+    }
+}
+
+static void UpdateBattleshipJob(void *data, int first, int last)
+{
+    (void)first; (void)last;
+    GameState *state = ((SimJobData *)data)->state;
+    float dt = ((SimJobData *)data)->dt;
+    const World *world = state->world;
+    
+    //checking if battleship can fire
+    if(state->CurrentBattleshipHealth > 0){
+        //checking if player is close enough
+        if(Vector3Distance(state->playerPos, world->battleship_Pos) <= 60){
+            //display battleship health bar
+            //fire battleship's guns
+            if(state->CanBattleshipFire){
+                for(int i = 0; i < world->level->battleshipGunCount; i++){
+                    SpawnProjectile(&state->projectiles, BATTLESHIP_TANK_BULLET, Vector3Add(world->level->battleshipGuns[i], world->battleship_Pos), 0, EnemyTankDamage, -1);
                 }
+                for(int i = 0; i < world->level->battleshipSpecialGunCount; i++){
+                    SpawnProjectile(&state->projectiles, BATTLESHIP_SPECIAL_BULLET, Vector3Add(world->level->battleshipSpecialGuns[i], world->battleship_Pos), 0, SpecialBulletDamage, -1);
+                }
+                
+                state->CanBattleshipFire = false;
             }
             
-            for(int j = 0; j < MaxNumberOfSpecialBullets; j++){
-                if(battleshipSpecialBullets[j].IsBulletFired){
-                    if(CheckCollisionBoxSphere(horizontalWalls[i], battleshipSpecialBullets[j].bulletPos, 1)){
-                        //play wall hit sound
-                        battleshipSpecialBullets[j].IsBulletFired = false;
-                    }
+            if(!state->CanBattleshipFire){
+                state->battleshipFireTime += dt;
+                
+                if(state->battleshipFireTime >= BattleshipFireRate){
+                    state->battleshipFireTime = 0;
+                    state->CanBattleshipFire = true;
                 }
             }
         }
+    }
+}
+
+//also clears the entries' hit records for the sweeps, expiring only reorders entries that are all cleared
+static void MoveProjectilesJob(void *data, int first, int last)
+{
+    GameState *state = ((SimJobData *)data)->state;
+    MoveProjectiles(&state->projectiles, first, last, state->playerPos, ((SimJobData *)data)->dt);
+    for(int k = first; k < last; k++){
+        state->projectiles.liveHitTime[k] = 2.0f;
+        state->projectiles.liveHitKind[k] = PROJECTILE_HIT_NONE;
+    }
+}
+
+static void ExpireProjectilesJob(void *data, int first, int last)
+{
+    (void)first; (void)last;
+    GameState *state = ((SimJobData *)data)->state;
+    for(int k = 0; k < state->projectiles.liveCount; k++){
+        if(state->projectiles.liveHits[k]) RemoveDynamicGridItem(&state->dynamicGrid, DYNAMIC_PROJECTILE, state->projectiles.live[k]);
+    }
+    ExpireProjectiles(&state->projectiles);
+}
+
+//moving enemies and bullets to the grid cells of their new positions (for bullets the sphere around their path this tick),
+//done here since the AI and move jobs run in parallel
+static void UpdateDynamicGridJob(void *data, int first, int last)
+{
+    (void)first; (void)last;
+    GameState *state = ((SimJobData *)data)->state;
+    Projectiles *projectiles = &state->projectiles;
+    for(int i = 0; i < state->enemyTankCount; i++){
+        if(state->enemyTanks[i].IsEnemyAlive) UpdateDynamicGridItem(&state->dynamicGrid, DYNAMIC_ENEMY_TANK, i, state->enemyTanks[i].enemyPos, 3);
+    }
+    for(int i = 0; i < state->enemyAPCCount; i++){
+        if(state->enemyAPCs[i].IsEnemyAlive) UpdateDynamicGridItem(&state->dynamicGrid, DYNAMIC_ENEMY_APC, i, state->enemyAPCs[i].enemyPos, 3);
+    }
+    for(int k = 0; k < projectiles->liveCount; k++){
+        UpdateDynamicGridItem(&state->dynamicGrid, DYNAMIC_PROJECTILE, projectiles->live[k], (Vector3){projectiles->liveX[k], projectiles->liveY[k], projectiles->liveZ[k]}, projectiles->liveRadius[k]);
+    }
+}
+
+//the sweep jobs below record each bullet's earliest impact along its path this tick, for live list entries [first, last)
+//so fast bullets can't skip over thin walls or enemies and never hit something behind a wall
+//the batch tests against the sphere around each path pick the candidates for the swept tests, every job writes its own entries only
+
+//player bullets (main gun and MG) against the enemy tanks and APCs near their path, and the battleship
+static void SweepProjectilesVsEnemiesJob(void *data, int first, int last)
+{
+    GameState *state = ((SimJobData *)data)->state;
+    const World *world = state->world;
+    Projectiles *projectiles = &state->projectiles;
+    int count = last - first;
+    
+    for(int k = first; k < last; k++){
+        int j = projectiles->live[k];
+        if(projectiles->faction[j] != PLAYER_FACTION) continue;
+        Vector3 pathCenter = (Vector3){projectiles->liveX[k], projectiles->liveY[k], projectiles->liveZ[k]};
+        int i;
         
-        //checking if enemy bullets hit the player
-        for(int i = 0; i < MaxEnemyTankBullets; i++){
-            if(enemyTankBullets[i].IsBulletFired){
-                if(CheckCollisionSpheres(enemyTankBullets[i].bulletPos, 1, playerPos, 2)){
-                    CurrentPlayerHealth -= enemyTanks[0].enemyDamage;
-                    enemyTankBullets[i].IsBulletFired = false;
-                }
+        DynamicGridQuery query = QueryDynamicGrid(&state->dynamicGrid, DYNAMIC_ENEMY_TANK, pathCenter, projectiles->liveRadius[k]);
+        while(NextDynamicGridItem(&query, &i)){
+            if(state->enemyTanks[i].IsEnemyAlive && CheckCollisionSpheres(pathCenter, projectiles->liveRadius[k], state->enemyTanks[i].enemyPos, 3)){
+                float t = GetSweptSphereHitTime(GetProjectileStartPosition(projectiles, j), GetProjectilePosition(projectiles, j), ProjectileRadius, state->enemyTanks[i].enemyPos, 3);
+                RecordProjectileHit(projectiles, k, t, PROJECTILE_HIT_ENEMY_TANK, i);
             }
         }
         
-        //checking if enemy MG bullets hit the player
-        for(int i = 0; i < MaxEnemyMGBullets; i++){
-            if(enemyMGBullets[i].IsBulletFired){
-                if(CheckCollisionSpheres(enemyMGBullets[i].bulletPos, 1, playerPos, 2)){
-                    CurrentPlayerHealth -= enemyAPCs[0].enemyDamage;
-                    enemyMGBullets[i].IsBulletFired = false;
-                }
+        query = QueryDynamicGrid(&state->dynamicGrid, DYNAMIC_ENEMY_APC, pathCenter, projectiles->liveRadius[k]);
+        while(NextDynamicGridItem(&query, &i)){
+            if(state->enemyAPCs[i].IsEnemyAlive && CheckCollisionSpheres(pathCenter, projectiles->liveRadius[k], state->enemyAPCs[i].enemyPos, 3)){
+                float t = GetSweptSphereHitTime(GetProjectileStartPosition(projectiles, j), GetProjectilePosition(projectiles, j), ProjectileRadius, state->enemyAPCs[i].enemyPos, 3);
+                RecordProjectileHit(projectiles, k, t, PROJECTILE_HIT_ENEMY_APC, i);
             }
         }
-        
-        //checking if player fires bullet
-        if(CanPlayerFireTank && !IsPlayerDead){
-            if(IsKeyPressed(KEY_SPACE) && CurrentMainGunAmmo > 0){
-                for(int i = 0; i < MaxPlayerTankBullets; i++){
-                    if(!playerTankBullets[i].IsBulletFired){
-                        playerTankBullets[i].bulletPos = (Vector3){playerPos.x, playerPos.y + 0.6f, playerPos.z + 0.2f};
-                        playerTankBullets[i].bulletYaw = playerYaw;
-                        playerTankBullets[i].bulletDir = (Vector3){sin(DEG2RAD * playerYaw), 0, cos(DEG2RAD * playerYaw)};
-                        playerTankBullets[i].IsBulletFired = true;
-                        CurrentMainGunAmmo--;
-                        break;
-                    }
-                }
-                PlaySound(PlayerTankGunSound);
-                CanPlayerFireTank = false;
-            }
-        }
-        
-        //check if player fires machine gun
-        if(CanPlayerFireMG){
-            if(IsKeyDown(KEY_RIGHT_ALT) && CurrentMGAmmo > 0){
-                for(int i = 0; i < MaxPlayerMGBullets; i++){
-                    if(!playerMGBullets[i].IsBulletFired){
-                        playerMGBullets[i].bulletPos = Vector3Add(playerPos, (Vector3){-0.1f, 0.9f, 0.1f});
-                        playerMGBullets[i].bulletYaw = playerYaw;
-                        playerMGBullets[i].bulletDir = (Vector3){sin(DEG2RAD * playerYaw), 0, cos(DEG2RAD * playerYaw)};
-                        playerMGBullets[i].IsBulletFired = true;
-                        CurrentMGAmmo--;
-                        break;
-                    }
-                }
-                PlaySound(PlayerMGSound);
-                CanPlayerFireMG = false;
-            }
-        }
-        
-        //check if player has picked up any pickup
-        for(int i = 0; i < MaxNumberOfPickups; i++){
-            if(!AllPickups[i].IsPickedUp){
-                if(CheckCollisionSpheres(AllPickups[i].pickupPos,1, playerPos, 3)){
-                    if(AllPickups[i].pickupType == HEALTH){
-                        if(CurrentPlayerHealth < PlayerHealth){
-                            int healthDif = PlayerHealth - CurrentPlayerHealth;
-                            if(healthDif >= HealthBoost) CurrentPlayerHealth += HealthBoost;
-                            else CurrentPlayerHealth = PlayerHealth;
-                            AllPickups[i].IsPickedUp = true;
-                            PlaySound(HealthPickupSound);
-                        }
-                    }
-                    if(AllPickups[i].pickupType == MAINGUN){
-                        if(CurrentMainGunAmmo < MaxPlayerMainGunAmmo){
-                            int ammoDif = MaxPlayerMainGunAmmo - CurrentMainGunAmmo;
-                            if(ammoDif >= MainGunAmmoBoost) CurrentMainGunAmmo += MainGunAmmoBoost;
-                            else CurrentMainGunAmmo = MaxPlayerMainGunAmmo;
-                            AllPickups[i].IsPickedUp = true;
-                            PlaySound(HealthPickupSound);
-                        }
-                    }
-                    if(AllPickups[i].pickupType == MG){
-                        if(CurrentMGAmmo < MaxPlayerMGAmmo){
-                            int ammoDif = MaxPlayerMGAmmo - CurrentMGAmmo;
-                            if(ammoDif >= MGAmmoBoost) CurrentMGAmmo += MGAmmoBoost;
-                            else CurrentMGAmmo = MaxPlayerMGAmmo;
-                            AllPickups[i].IsPickedUp = true;
-                            PlaySound(HealthPickupSound);
-                        }
-                    }    
-                }
-            }
+    }
+    
+    CheckCollisionBoxSpheresBatch(world->battleshipBox, projectiles->liveX + first, projectiles->liveY + first, projectiles->liveZ + first, projectiles->liveRadius + first, count, projectiles->liveHits + first);
+    for(int k = first; k < last; k++){
+        int i = projectiles->live[k];
+        if(projectiles->liveHits[k] && projectiles->faction[i] == PLAYER_FACTION){
+            float t = GetBattleshipSweptHitTime(world, GetProjectileStartPosition(projectiles, i), GetProjectilePosition(projectiles, i), ProjectileRadius);
+            RecordProjectileHit(projectiles, k, t, PROJECTILE_HIT_BATTLESHIP, 0);
         }
-        
-        //checking if player can fire main gun again
-        if(!CanPlayerFireTank) {
-            playerTankGunTime += dt;
-            if(playerTankGunTime > PlayerTankDelay) {
-                playerTankGunTime = 0;
-                CanPlayerFireTank = true;
-            }
+    }
+}
+
+//enemy and battleship bullets near the player against the player
+//the grid's candidates are packed a few at a time so their path spheres go through the batch test together
+static void SweepProjectilesVsPlayerJob(void *data, int first, int last)
+{
+    (void)first; (void)last;
+    GameState *state = ((SimJobData *)data)->state;
+    Projectiles *projectiles = &state->projectiles;
+    
+    float x[MaxBatchCandidates], y[MaxBatchCandidates], z[MaxBatchCandidates], radius[MaxBatchCandidates];
+    int candidates[MaxBatchCandidates];
+    unsigned char hits[MaxBatchCandidates];
+    int count = 0;
+    int i;
+    bool HasMore = true;
+    DynamicGridQuery query = QueryDynamicGrid(&state->dynamicGrid, DYNAMIC_PROJECTILE, state->playerPos, 2);
+    while(HasMore){
+        HasMore = NextDynamicGridItem(&query, &i);
+        if(HasMore && projectiles->faction[i] == ENEMY_FACTION){
+            int k = projectiles->livePos[i];
+            x[count] = projectiles->liveX[k];
+            y[count] = projectiles->liveY[k];
+            z[count] = projectiles->liveZ[k];
+            radius[count] = projectiles->liveRadius[k];
+            candidates[count++] = i;
         }
-        
-        //check if player can fire machine gun again
-        if(!CanPlayerFireMG){
-            playerMGTime += dt;
-            if(playerMGTime > PlayerMGDelay) {
-                playerMGTime = 0;
-                CanPlayerFireMG = true;
+        if(count == MaxBatchCandidates || (!HasMore && count > 0)){
+            CheckCollisionSpheresBatch(x, y, z, radius, count, state->playerPos, 2, hits);
+            for(int c = 0; c < count; c++){
+                if(!hits[c]) continue;
+                int j = candidates[c];
+                float t = GetSweptSphereHitTime(GetProjectileStartPosition(projectiles, j), GetProjectilePosition(projectiles, j), ProjectileRadius, state->playerPos, 2);
+                RecordProjectileHit(projectiles, projectiles->livePos[j], t, PROJECTILE_HIT_PLAYER, 0);
             }
+            count = 0;
         }
-        
-        //checking if enemy tanks can fire bullet
-        for(int i = 0; i < MaxNumberOfEnemyTanks; i++){
-            if(!enemyTanks[i].CanTankFire){
-                enemyTanks[i].enemyTimeTillLastShot += dt;
+    }
+}
+
+//every bullet against walls and buildings, only the grid cells around its path are tested
+static void SweepProjectilesVsStaticJob(void *data, int first, int last)
+{
+    GameState *state = ((SimJobData *)data)->state;
+    Projectiles *projectiles = &state->projectiles;
+    
+    for(int k = first; k < last; k++){
+        int i = projectiles->live[k];
+        float t = GetStaticGridSweptHitTime(&state->world->staticGrid, GetProjectileStartPosition(projectiles, i), GetProjectilePosition(projectiles, i), ProjectileRadius);
+        RecordProjectileHit(projectiles, k, t, PROJECTILE_HIT_STATIC, 0);
+    }
+}
+
+//applying each bullet's earliest hit, the live list is walked backwards so killing a bullet never skips one
+//a bullet whose target was already destroyed this tick or a second bullet of a type reaching the battleship keeps flying
+static void ApplyProjectileHitsJob(void *data, int first, int last)
+{
+    (void)first; (void)last;
+    GameState *state = ((SimJobData *)data)->state;
+    
+    bool battleshipHitByType[PROJECTILE_TYPE_COUNT] = {false};
+    for(int k = state->projectiles.liveCount - 1; k >= 0; k--){
+        int i = state->projectiles.live[k];
+        int target = state->projectiles.liveHitIndex[k];
+        switch(state->projectiles.liveHitKind[k]){
+            case PROJECTILE_HIT_ENEMY_TANK:
+            case PROJECTILE_HIT_ENEMY_APC: {
+                EnemyTank *enemy = (state->projectiles.liveHitKind[k] == PROJECTILE_HIT_ENEMY_TANK)? &state->enemyTanks[target] : &state->enemyAPCs[target];
+                if(!enemy->IsEnemyAlive) break;
+                PushSoundEvent(state, ENEMY_HIT_SOUND, enemy->enemyPos);
+                enemy->enemyHealth -= state->projectiles.damage[i];
+                KillProjectile(&state->projectiles, i);
                 
-                if(enemyTanks[i].enemyTimeTillLastShot >= enemyTanks[i].enemyTankFireRate){
-                    enemyTanks[i].CanTankFire = true;
-                    enemyTanks[i].enemyTimeTillLastShot = 0;
+                if(enemy->enemyHealth <= 0){
+                    enemy->IsEnemyAlive = false;
+                    RemoveDynamicGridItem(&state->dynamicGrid, (state->projectiles.liveHitKind[k] == PROJECTILE_HIT_ENEMY_TANK)? DYNAMIC_ENEMY_TANK : DYNAMIC_ENEMY_APC, target);
+                    PushSoundEvent(state, ENEMY_DIE_SOUND, enemy->enemyPos);
                 }
+            } break;
+            case PROJECTILE_HIT_BATTLESHIP: {
+                //at most one bullet of each type hits the battleship per tick
+                if(battleshipHitByType[state->projectiles.type[i]]) break;
+                Vector3 hitPos = Vector3Lerp(GetProjectileStartPosition(&state->projectiles, i), GetProjectilePosition(&state->projectiles, i), state->projectiles.liveHitTime[k]);
+                PushSoundEvent(state, ENEMY_HIT_SOUND, hitPos);
+                state->CurrentBattleshipHealth -= state->projectiles.damage[i];
+                battleshipHitByType[state->projectiles.type[i]] = true;
+                KillProjectile(&state->projectiles, i);
+            } break;
+            case PROJECTILE_HIT_PLAYER:
+                state->CurrentPlayerHealth -= state->projectiles.damage[i];
+                KillProjectile(&state->projectiles, i);
+                break;
+            case PROJECTILE_HIT_STATIC:
+                //play wall hit sound
+                KillProjectile(&state->projectiles, i);
+                break;
+            default: break;
+        }
+        if(!state->projectiles.IsFired[i]) RemoveDynamicGridItem(&state->dynamicGrid, DYNAMIC_PROJECTILE, i);
+    }
+}
+
+//advances the game by one update, everything that used to live between the input and draw phases of the main loop
+static void SimStep(GameState *state, const InputFrame *input, float dt)
+{
+    const World *world = state->world;
+    state->soundEventCount = 0;
+    state->prevPlayerPos = state->playerPos;
+    state->prevPlayerYaw = state->playerYaw;
+    BeginProfilePhase(PROFILE_UPDATE);
+    
+    BeginProfilePhase(PROFILE_INPUT);
+    //detect input and move player character if player isn't dead, speeds are per second
+    float moveStep = PlayerMoveSpeed * dt;
+    if(!state->IsPlayerDead){
+        if(input->buttons & INPUT_TURN_RIGHT) state->playerYaw -= PlayerTurnSpeed * dt;
+        if(input->buttons & INPUT_TURN_LEFT) state->playerYaw += PlayerTurnSpeed * dt;
+        if(input->buttons & INPUT_FORWARD) {
+            bool CanMove = true;
+            Vector3 checkingSphereDist = (Vector3){state->playerPos.x + sin(DEG2RAD * state->playerYaw) * 1, 0.0f, state->playerPos.z + cos(DEG2RAD * state->playerYaw) * 1};
+            if(CheckCollisionStaticGridSphere(&world->staticGrid, checkingSphereDist, 1)) CanMove = false;
+            if(CheckCollisionBattleshipSphere(world, checkingSphereDist, 1)) CanMove = false;
+            if(CanMove){
+                state->playerPos.z += cos(DEG2RAD * state->playerYaw) * moveStep;
+                state->playerPos.x += sin(DEG2RAD * state->playerYaw) * moveStep; 
             }
         }
-        
-        //checking if enemy APCs can fire bullet
-        for(int i = 0; i < MaxNumberOfEnemyAPCs; i++){
-            if(!enemyAPCs[i].CanTankFire){
-                enemyAPCs[i].enemyTimeTillLastShot += dt;
-                
-                if(enemyAPCs[i].enemyTimeTillLastShot >= enemyAPCs[i].enemyTankFireRate){
-                    enemyAPCs[i].CanTankFire = true;
-                    enemyAPCs[i].enemyTimeTillLastShot = 0;
-                }
+        if(input->buttons & INPUT_BACKWARD) {
+            bool CanMove = true;
+            Vector3 checkingSphereDist = (Vector3){state->playerPos.x - sin(DEG2RAD * state->playerYaw) * 2, 0.0f, state->playerPos.z - cos(DEG2RAD * state->playerYaw) * 2};
+            if(CheckCollisionStaticGridSphere(&world->staticGrid, checkingSphereDist, 1)) CanMove = false;
+            if(CanMove){
+                state->playerPos.z -= cos(DEG2RAD * state->playerYaw) * moveStep;
+                state->playerPos.x -= sin(DEG2RAD * state->playerYaw) * moveStep;  
+            }  
+        }
+    }
+    EndProfilePhase(PROFILE_INPUT);
+    
+    BeginProfilePhase(PROFILE_PICKUPS);
+    //updating rotation of all pickup items not picked up by player
+    for(int i = 0; i < state->pickupCount; i++){
+        state->AllPickups[i].pickupPrevYaw = state->AllPickups[i].pickupYaw;
+        if(!state->AllPickups[i].IsPickedUp) state->AllPickups[i].pickupYaw += state->AllPickups[i].pickupRotSpeed * dt;
+    }
+    EndProfilePhase(PROFILE_PICKUPS);
+    
+    //enemy AI, bullet movement and bullet collision run as one job graph spread over the worker threads
+    //parallel tasks only write to their own enemies or bullets, shared state is only changed by the serial ones in a fixed order
+    SimJobData jobData = { state, dt };
+    JobGraph graph = { 0 };
+    int flowTask = AddJobTask(&graph, UpdateFlowFieldJob, &jobData, NULL, 0, PROFILE_ENEMY_AI);
+    int tanksTask = AddJobTask(&graph, UpdateEnemyTanksJob, &jobData, &state->enemyTankCount, 16, PROFILE_ENEMY_AI);
+    int apcsTask = AddJobTask(&graph, UpdateEnemyAPCsJob, &jobData, &state->enemyAPCCount, 16, PROFILE_ENEMY_AI);
+    int fireTask = AddJobTask(&graph, FireEnemyWeaponsJob, &jobData, NULL, 0, PROFILE_ENEMY_AI);
+    int battleshipTask = AddJobTask(&graph, UpdateBattleshipJob, &jobData, NULL, 0, PROFILE_BATTLESHIP);
+    int moveTask = AddJobTask(&graph, MoveProjectilesJob, &jobData, &state->projectiles.liveCount, 64, PROFILE_BULLET_MOVE);
+    int expireTask = AddJobTask(&graph, ExpireProjectilesJob, &jobData, NULL, 0, PROFILE_BULLET_MOVE);
+    int hashTask = AddJobTask(&graph, UpdateDynamicGridJob, &jobData, NULL, 0, PROFILE_BULLET_MOVE);
+    int enemySweepTask = AddJobTask(&graph, SweepProjectilesVsEnemiesJob, &jobData, &state->projectiles.liveCount, 32, PROFILE_BULLET_VS_ENEMY);
+    int playerSweepTask = AddJobTask(&graph, SweepProjectilesVsPlayerJob, &jobData, NULL, 0, PROFILE_BULLET_VS_PLAYER);
+    int staticSweepTask = AddJobTask(&graph, SweepProjectilesVsStaticJob, &jobData, &state->projectiles.liveCount, 32, PROFILE_BULLET_VS_STATIC);
+    int applyTask = AddJobTask(&graph, ApplyProjectileHitsJob, &jobData, NULL, 0, PROFILE_BULLET_VS_ENEMY);
+    
+    //the flow field, AI of both enemy kinds, then their shots, the battleship's, moving every bullet, hashing everything by position, then the sweeps in a fixed order
+    //(they share the scratch hit mask and ties go to the earlier sweep), then the hits
+    AddJobDependency(&graph, tanksTask, flowTask);
+    AddJobDependency(&graph, apcsTask, flowTask);
+    AddJobDependency(&graph, fireTask, tanksTask);
+    AddJobDependency(&graph, fireTask, apcsTask);
+    AddJobDependency(&graph, battleshipTask, fireTask);
+    AddJobDependency(&graph, moveTask, battleshipTask);
+    AddJobDependency(&graph, expireTask, moveTask);
+    AddJobDependency(&graph, hashTask, expireTask);
+    AddJobDependency(&graph, enemySweepTask, hashTask);
+    AddJobDependency(&graph, playerSweepTask, enemySweepTask);
+    AddJobDependency(&graph, staticSweepTask, playerSweepTask);
+    AddJobDependency(&graph, applyTask, staticSweepTask);
+    RunJobGraph(&jobs, &graph);
+    
+    BeginProfilePhase(PROFILE_INPUT);
+    //checking if player fires bullet
+    if(state->CanPlayerFireTank && !state->IsPlayerDead){
+        if((input->buttons & INPUT_FIRE_TANK) && state->CurrentMainGunAmmo > 0){
+            Vector3 muzzlePos = (Vector3){state->playerPos.x, state->playerPos.y + 0.6f, state->playerPos.z + 0.2f};
+            if(SpawnProjectile(&state->projectiles, PLAYER_TANK_BULLET, muzzlePos, state->playerYaw, PlayerDamage, -1) >= 0){
+                state->CurrentMainGunAmmo--;
+                state->CanPlayerFireTank = false;
+                PushSoundEvent(state, PLAYER_TANK_GUN_SOUND, state->playerPos);
             }
         }
-        
-        //check if player is dead
-        if(CurrentPlayerHealth <= 0){
-            CurrentPlayerHealth = 0;
-            IsPlayerDead = true;
+    }
+    
+    //check if player fires machine gun
+    if(state->CanPlayerFireMG){
+        if((input->buttons & INPUT_FIRE_MG) && state->CurrentMGAmmo > 0){
+            Vector3 muzzlePos = Vector3Add(state->playerPos, (Vector3){-0.1f, 0.9f, 0.1f});
+            if(SpawnProjectile(&state->projectiles, PLAYER_MG_BULLET, muzzlePos, state->playerYaw, PlayerMGDamage, -1) >= 0){
+                state->CurrentMGAmmo--;
+                state->CanPlayerFireMG = false;
+                PushSoundEvent(state, PLAYER_MG_SOUND, state->playerPos);
+            }
         }
-        
-        //check if game finished
-        bool AreAllEnemiesDead = true;
-        for(int i = 0; i < MaxNumberOfEnemyTanks; i++){
-            if(enemyTanks[i].IsEnemyAlive) AreAllEnemiesDead = false;
+    }
+    EndProfilePhase(PROFILE_INPUT);
+    
+    BeginProfilePhase(PROFILE_PICKUPS);
+    //check if player has picked up any of the pickups around it
+    int i;
+    DynamicGridQuery pickupQuery = QueryDynamicGrid(&state->dynamicGrid, DYNAMIC_PICKUP, state->playerPos, 3);
+    while(NextDynamicGridItem(&pickupQuery, &i)){
+        if(!state->AllPickups[i].IsPickedUp){
+            if(CheckCollisionSpheres(state->AllPickups[i].pickupPos,1, state->playerPos, 3)){
+                if(state->AllPickups[i].pickupType == HEALTH){
+                    if(state->CurrentPlayerHealth < PlayerHealth){
+                        int healthDif = PlayerHealth - state->CurrentPlayerHealth;
+                        if(healthDif >= HealthBoost) state->CurrentPlayerHealth += HealthBoost;
+                        else state->CurrentPlayerHealth = PlayerHealth;
+                        state->AllPickups[i].IsPickedUp = true;
+                        PushSoundEvent(state, HEALTH_PICKUP_SOUND, state->playerPos);
+                    }
+                }
+                if(state->AllPickups[i].pickupType == MAINGUN){
+                    if(state->CurrentMainGunAmmo < MaxPlayerMainGunAmmo){
+                        int ammoDif = MaxPlayerMainGunAmmo - state->CurrentMainGunAmmo;
+                        if(ammoDif >= MainGunAmmoBoost) state->CurrentMainGunAmmo += MainGunAmmoBoost;
+                        else state->CurrentMainGunAmmo = MaxPlayerMainGunAmmo;
+                        state->AllPickups[i].IsPickedUp = true;
+                        PushSoundEvent(state, HEALTH_PICKUP_SOUND, state->playerPos);
+                    }
+                }
+                if(state->AllPickups[i].pickupType == MG){
+                    if(state->CurrentMGAmmo < MaxPlayerMGAmmo){
+                        int ammoDif = MaxPlayerMGAmmo - state->CurrentMGAmmo;
+                        if(ammoDif >= MGAmmoBoost) state->CurrentMGAmmo += MGAmmoBoost;
+                        else state->CurrentMGAmmo = MaxPlayerMGAmmo;
+                        state->AllPickups[i].IsPickedUp = true;
+                        PushSoundEvent(state, HEALTH_PICKUP_SOUND, state->playerPos);
+                    }
+                }    
+                if(state->AllPickups[i].IsPickedUp) RemoveDynamicGridItem(&state->dynamicGrid, DYNAMIC_PICKUP, i);
+            }
         }
-        for(int i = 0; i < MaxNumberOfEnemyAPCs; i++){
-            if(enemyAPCs[i].IsEnemyAlive) AreAllEnemiesDead = false;
+    }
+    EndProfilePhase(PROFILE_PICKUPS);
+    
+    BeginProfilePhase(PROFILE_RULES);
+    //checking if player can fire main gun again
+    if(!state->CanPlayerFireTank) {
+        state->playerTankGunTime += dt;
+        if(state->playerTankGunTime > PlayerTankDelay) {
+            state->playerTankGunTime = 0;
+            state->CanPlayerFireTank = true;
         }
-        if(CurrentBattleshipHealth > 0) AreAllEnemiesDead = false;
-        
-        if(AreAllEnemiesDead) IsGameFinished = true;
-        
-        //check if player wants to restart game, and if yes, then restart game
-        if(IsKeyPressed(KEY_R)){
-            if(!ToRestartGame)ToRestartGame = true;
+    }
+    
+    //check if player can fire machine gun again
+    if(!state->CanPlayerFireMG){
+        state->playerMGTime += dt;
+        if(state->playerMGTime > PlayerMGDelay) {
+            state->playerMGTime = 0;
+            state->CanPlayerFireMG = true;
         }
-        if(ToRestartGame){
-            //reset pickups
-            for(int i = 0; i < MaxNumberOfPickups; i++){
-                AllPickups[i].IsPickedUp = false;
-            }
+    }
+    
+    //checking if enemy tanks can fire bullet
+    for(int i = 0; i < state->enemyTankCount; i++){
+        if(!state->enemyTanks[i].CanTankFire){
+            state->enemyTanks[i].enemyTimeTillLastShot += dt;
             
-            //resetting enemy tanks
-            for(int i = 0; i < MaxNumberOfEnemyTanks; i++){
-                enemyTanks[i].enemyHealth = 60;
-                enemyTanks[i].IsEnemyAlive = true;
-                enemyTanks[i].enemyYaw = 180;
+            if(state->enemyTanks[i].enemyTimeTillLastShot >= state->enemyTanks[i].enemyTankFireRate){
+                state->enemyTanks[i].CanTankFire = true;
+                state->enemyTanks[i].enemyTimeTillLastShot = 0;
             }
+        }
+    }
+    
+    //checking if enemy APCs can fire bullet
+    for(int i = 0; i < state->enemyAPCCount; i++){
+        if(!state->enemyAPCs[i].CanTankFire){
+            state->enemyAPCs[i].enemyTimeTillLastShot += dt;
             
-            //resetting enemy APCs
-            for(int i = 0; i < MaxNumberOfEnemyAPCs; i++){
-                enemyAPCs[i].enemyHealth = 45;
-                enemyAPCs[i].IsEnemyAlive = true;
-                enemyAPCs[i].enemyYaw = 180;
+            if(state->enemyAPCs[i].enemyTimeTillLastShot >= state->enemyAPCs[i].enemyTankFireRate){
+                state->enemyAPCs[i].CanTankFire = true;
+                state->enemyAPCs[i].enemyTimeTillLastShot = 0;
             }
-            
-            //resetting enemy boss
-            int CurrentBattleshipHealth = MaxBattleshipHealth;
-            bool CanBattleshipFire = true;
-            float battleshipFireTime = 0.0f;
-            
-            //resetting player
-            playerPos = (Vector3){0.0f, 0.0f, 0.0f};
-            CurrentPlayerHealth = PlayerHealth;
-            CurrentMainGunAmmo = MaxPlayerMainGunAmmo;
-            CurrentMGAmmo = MaxPlayerMGAmmo;
-            playerYaw = 180;
-            CanPlayerFireMG = true;
-            CanPlayerFireTank = true;
-            playerTankGunTime = 0;
-            playerMGTime = 0;
-            
-            IsPlayerDead = false;
-            ToRestartGame = false;
-            IsGameFinished = false;
-            
         }
-        //----------------------------------------------------------------------------------
+    }
+    
+    //check if player is dead
+    if(state->CurrentPlayerHealth <= 0){
+        state->CurrentPlayerHealth = 0;
+        state->IsPlayerDead = true;
+    }
+    
+    //check if game finished
+    bool AreAllEnemiesDead = true;
+    for(int i = 0; i < state->enemyTankCount; i++){
+        if(state->enemyTanks[i].IsEnemyAlive) AreAllEnemiesDead = false;
+    }
+    for(int i = 0; i < state->enemyAPCCount; i++){
+        if(state->enemyAPCs[i].IsEnemyAlive) AreAllEnemiesDead = false;
+    }
+    if(state->CurrentBattleshipHealth > 0) AreAllEnemiesDead = false;
+    
+    if(AreAllEnemiesDead) state->IsGameFinished = true;
+    
+    //check if player wants to restart game, and if yes, then restart game
+    if(input->buttons & INPUT_RESTART){
+        if(!state->ToRestartGame)state->ToRestartGame = true;
+    }
+    if(state->ToRestartGame){
+        //the match start snapshot holds every enemy, pickup, bullet, the boss and the player, only the step count carries on
+        unsigned int tick = state->tick;
+        RestoreGameSnapshot(state, state->matchStart);
+        state->tick = tick;
+    }
+    EndProfilePhase(PROFILE_RULES);
+    
+    EndProfilePhase(PROFILE_UPDATE);
+    state->tick++;
+}
 
-        // Draw
-        //----------------------------------------------------------------------------------
-        BeginDrawing();
+//reads this frame's keyboard state into the buttons SimStep understands
+static InputFrame GetInputFrame(void)
+{
+    InputFrame input = { 0 };
+    
+    if(IsKeyDown(KEY_RIGHT)) input.buttons |= INPUT_TURN_RIGHT;
+    if(IsKeyDown(KEY_LEFT)) input.buttons |= INPUT_TURN_LEFT;
+    if(IsKeyDown(KEY_UP)) input.buttons |= INPUT_FORWARD;
+    if(IsKeyDown(KEY_DOWN)) input.buttons |= INPUT_BACKWARD;
+    if(IsKeyPressed(KEY_SPACE)) input.buttons |= INPUT_FIRE_TANK;
+    if(IsKeyDown(KEY_RIGHT_ALT)) input.buttons |= INPUT_FIRE_MG;
+    if(IsKeyPressed(KEY_R)) input.buttons |= INPUT_RESTART;
+    
+    return input;
+}
 
-        ClearBackground(DARKGRAY);
+//FNV-1a over the parts of the state a balance or logic change would move, used to compare runs
+static unsigned int GetGameStateChecksum(const GameState *state)
+{
+    unsigned int hash = 2166136261u;
+    #define HASH_VALUE(value) do { const unsigned char *bytes = (const unsigned char *)&(value); \
+        for(size_t b = 0; b < sizeof(value); b++) hash = (hash ^ bytes[b])*16777619u; } while(0)
+    
+    HASH_VALUE(state->playerPos);
+    HASH_VALUE(state->playerYaw);
+    HASH_VALUE(state->CurrentPlayerHealth);
+    HASH_VALUE(state->CurrentMainGunAmmo);
+    HASH_VALUE(state->CurrentMGAmmo);
+    HASH_VALUE(state->CurrentBattleshipHealth);
+    for(int i = 0; i < state->enemyTankCount; i++){
+        HASH_VALUE(state->enemyTanks[i].enemyHealth);
+        HASH_VALUE(state->enemyTanks[i].enemyYaw);
+        HASH_VALUE(state->enemyTanks[i].enemyPos);
+    }
+    for(int i = 0; i < state->enemyAPCCount; i++){
+        HASH_VALUE(state->enemyAPCs[i].enemyHealth);
+        HASH_VALUE(state->enemyAPCs[i].enemyYaw);
+        HASH_VALUE(state->enemyAPCs[i].enemyPos);
+    }
+    for(int i = 0; i < state->pickupCount; i++) HASH_VALUE(state->AllPickups[i].IsPickedUp);
+    for(int k = 0; k < state->projectiles.liveCount; k++){
+        Vector3 bulletPos = GetProjectilePosition(&state->projectiles, state->projectiles.live[k]);
+        HASH_VALUE(bulletPos);
+    }
+    
+    #undef HASH_VALUE
+    return hash;
+}
 
-        BeginMode3D(cam);
-        //DrawGrid(32, 1);
+//a cheap stand in for a player that keeps matches moving, re-rolls its movement every half second and fires at random
+static void UpdateBotInput(const GameState *state, unsigned int *rng, InputFrame *input)
+{
+    static const unsigned int moves[] = {INPUT_FORWARD, INPUT_FORWARD, INPUT_FORWARD | INPUT_TURN_LEFT,
+                                         INPUT_FORWARD | INPUT_TURN_RIGHT, INPUT_BACKWARD, INPUT_TURN_LEFT, INPUT_TURN_RIGHT};
+    const unsigned int moveBits = INPUT_TURN_RIGHT | INPUT_TURN_LEFT | INPUT_FORWARD | INPUT_BACKWARD;
+    
+    *rng = *rng*1664525u + 1013904223u;
+    if(state->tick%(SIM_TICK_RATE/2) == 0) input->buttons = moves[(*rng >> 16)%(sizeof(moves)/sizeof(moves[0]))];
+    input->buttons &= moveBits;
+    if(((*rng >> 8) & 15) == 0) input->buttons |= INPUT_FIRE_TANK;
+    if(((*rng >> 12) & 1) == 0) input->buttons |= INPUT_FIRE_MG;
+}
+
+//parses "<ticks> BUTTON..." lines, '#' starts a comment, returns the number of lines read
+static int LoadInputScript(const char *fileName, ScriptLine **lines)
+{
+    static const char *buttonNames[] = {"RIGHT", "LEFT", "FORWARD", "BACKWARD", "FIRE", "MG", "RESTART"};
+    char *text = LoadFileText(fileName);
+    int count = 0;
+    int capacity = 0;
+    
+    *lines = NULL;
+    if(text == NULL) return 0;
+    
+    for(char *line = strtok(text, "\r\n"); line != NULL; line = strtok(NULL, "\r\n")){
+        char *comment = strchr(line, '#');
+        if(comment != NULL) *comment = '\0';
         
-        //drawing player tank
-        DrawModel(playerTank, playerPos, 1.0f, WHITE);
+        ScriptLine scriptLine = { 0 };
+        int consumed = 0;
+        if(sscanf(line, "%d%n", &scriptLine.ticks, &consumed) != 1 || scriptLine.ticks <= 0) continue;
         
-        //drawing player all gun bullets
-        for(int i = 0; i < MaxPlayerTankBullets; i++){
-            if(playerTankBullets[i].IsBulletFired) DrawModel(playerTankBullets[i].bulletModel, playerTankBullets[i].bulletPos, 1.0f, WHITE);
-        }
-        for(int i = 0; i < MaxPlayerMGBullets; i++){
-            if(playerMGBullets[i].IsBulletFired) DrawModel(playerMGBullets[i].bulletModel, playerMGBullets[i].bulletPos, 1.0f, WHITE);
+        char name[32];
+        int nameLength = 0;
+        for(char *cursor = line + consumed; sscanf(cursor, "%31s%n", name, &nameLength) == 1; cursor += nameLength){
+            for(int b = 0; b < (int)(sizeof(buttonNames)/sizeof(buttonNames[0])); b++){
+                if(strcmp(name, buttonNames[b]) == 0) scriptLine.buttons |= 1u << b;
+            }
         }
         
-        //drawing enemy tank bullets
-        for(int i = 0; i < MaxEnemyTankBullets; i++){
-            if(enemyTankBullets[i].IsBulletFired) DrawModel(enemyTankBullets[i].bulletModel, enemyTankBullets[i].bulletPos, 1.0f, WHITE);
+        if(count == capacity){
+            capacity = capacity ? capacity*2 : 64;
+            *lines = realloc(*lines, capacity*sizeof(ScriptLine));
         }
-        
-        //drawing enemy machine gun bullets
-        for(int i = 0; i < MaxEnemyMGBullets; i++){
-            if(enemyMGBullets[i].IsBulletFired) DrawModel(enemyMGBullets[i].bulletModel, enemyMGBullets[i].bulletPos, 1.0f, WHITE);
+        (*lines)[count++] = scriptLine;
+    }
+    
+    UnloadFileText(text);
+    return count;
+}
+
+//seconds from raylib's high resolution timer once a window exists, from clock() when headless
+static double GetProfilerTime(void)
+{
+    if(IsWindowReady()) return GetTime();
+    return (double)clock()/CLOCKS_PER_SEC;
+}
+
+static void BeginProfilePhase(ProfilePhase phase)
+{
+    if(profiler.IsEnabled) profiler.phaseStart[phase] = GetProfilerTime();
+}
+
+static void EndProfilePhase(ProfilePhase phase)
+{
+    if(profiler.IsEnabled) profiler.current[phase] += (float)((GetProfilerTime() - profiler.phaseStart[phase])*1000.0);
+}
+
+//moves this frame's times into the rolling history and the CSV, then starts a new frame
+static void EndProfilerFrame(void)
+{
+    if(!profiler.IsEnabled) return;
+    
+    for(int p = 0; p < PROFILE_PHASE_COUNT; p++) profiler.history[p][profiler.historyNext] = profiler.current[p];
+    profiler.historyNext = (profiler.historyNext + 1)%PROFILER_HISTORY;
+    if(profiler.historyCount < PROFILER_HISTORY) profiler.historyCount++;
+    
+    if(profiler.csv != NULL){
+        fprintf(profiler.csv, "%d", profiler.frame);
+        for(int p = 0; p < PROFILE_PHASE_COUNT; p++) fprintf(profiler.csv, ",%.4f", profiler.current[p]);
+        fprintf(profiler.csv, "\n");
+    }
+    
+    memset(profiler.current, 0, sizeof(profiler.current));
+    profiler.frame++;
+}
+
+//starts a per frame timing dump, columns are the frame number and each phase in milliseconds
+static bool OpenProfilerCsv(const char *fileName)
+{
+    profiler.csv = fopen(fileName, "w");
+    if(profiler.csv == NULL){
+        TraceLog(LOG_WARNING, "PROFILER: [%s] Failed to open CSV file", fileName);
+        return false;
+    }
+    
+    fprintf(profiler.csv, "frame");
+    for(int p = 0; p < PROFILE_PHASE_COUNT; p++){
+        fprintf(profiler.csv, ",");
+        for(const char *c = profilePhaseNames[p]; *c != '\0'; c++) fputc((*c == ' ') ? '_' : *c, profiler.csv);
+        fprintf(profiler.csv, "_ms");
+    }
+    fprintf(profiler.csv, "\n");
+    return true;
+}
+
+static void CloseProfilerCsv(void)
+{
+    if(profiler.csv != NULL) fclose(profiler.csv);
+    profiler.csv = NULL;
+}
+
+static int CompareFloats(const void *a, const void *b)
+{
+    float fa = *(const float *)a;
+    float fb = *(const float *)b;
+    return (fa > fb) - (fa < fb);
+}
+
+//min, average and 99th percentile of every phase over the recorded history
+static void DrawProfilerOverlay(int posX, int posY)
+{
+    const int lineHeight = 20;
+    float sorted[PROFILER_HISTORY];
+    int count = profiler.historyCount;
+    
+    DrawRectangle(posX - 10, posY - 10, 460, (PROFILE_PHASE_COUNT + 1)*lineHeight + 20, Fade(BLACK, 0.6f));
+    DrawText(TextFormat("%-18s %7s %7s %7s", "phase (ms)", "min", "avg", "p99"), posX, posY, 20, LIME);
+    if(count == 0) return;
+    
+    for(int p = 0; p < PROFILE_PHASE_COUNT; p++){
+        float sum = 0.0f;
+        for(int i = 0; i < count; i++){
+            sorted[i] = profiler.history[p][i];
+            sum += sorted[i];
         }
+        qsort(sorted, count, sizeof(float), CompareFloats);
         
-        //drawing battleship tank bullets
-        for(int i = 0; i < MaxNumberOfBattleShipTankBullets; i++){
-            if(battleshipTankBullets[i].IsBulletFired) DrawModel(battleshipTankBullets[i].bulletModel, battleshipTankBullets[i].bulletPos, 1.0f, WHITE);
-        }
+        DrawText(TextFormat("%-18s %7.3f %7.3f %7.3f", profilePhaseNames[p], sorted[0], sum/count, sorted[(count*99)/100]),
+                 posX, posY + (p + 1)*lineHeight, 20, RAYWHITE);
+    }
+}
+
+//appends one simulation step to the recording
+static void RecordReplayTick(Replay *replay, const InputFrame *input, float dt)
+{
+    if(replay->tickCount == replay->capacity){
+        replay->capacity = replay->capacity ? replay->capacity*2 : 4096;
+        replay->buttons = realloc(replay->buttons, replay->capacity*sizeof(unsigned char));
+        replay->dt = realloc(replay->dt, replay->capacity*sizeof(float));
+    }
+    
+    replay->buttons[replay->tickCount] = (unsigned char)input->buttons;
+    replay->dt[replay->tickCount] = dt;
+    replay->tickCount++;
+}
+
+static void WriteReplayU32(unsigned char *bytes, unsigned int value)
+{
+    for(int b = 0; b < 4; b++) bytes[b] = (unsigned char)(value >> (8*b));
+}
+
+static unsigned int ReadReplayU32(const unsigned char *bytes)
+{
+    return (unsigned int)bytes[0] | (unsigned int)bytes[1] << 8 | (unsigned int)bytes[2] << 16 | (unsigned int)bytes[3] << 24;
+}
+
+//little endian file: header, then one run per stretch of up to 255 ticks sharing the same buttons and bit-identical dt
+static bool SaveReplay(const Replay *replay, const char *fileName)
+{
+    unsigned char *data = malloc(REPLAY_HEADER_SIZE + replay->tickCount*REPLAY_RUN_SIZE);
+    int size = REPLAY_HEADER_SIZE;
+    int runCount = 0;
+    
+    for(int i = 0; i < replay->tickCount; ){
+        int length = 1;
+        while(i + length < replay->tickCount && length < 255 && replay->buttons[i + length] == replay->buttons[i] &&
+              memcmp(&replay->dt[i + length], &replay->dt[i], sizeof(float)) == 0) length++;
         
-        //drawing battleship special bullets
-        for(int i = 0; i < MaxNumberOfSpecialBullets; i++){
-            if(battleshipSpecialBullets[i].IsBulletFired) DrawModel(battleshipSpecialBullets[i].bulletModel, battleshipSpecialBullets[i].bulletPos, 1.0f, WHITE);
+        unsigned int dtBits;
+        memcpy(&dtBits, &replay->dt[i], sizeof(float));
+        data[size] = replay->buttons[i];
+        data[size + 1] = (unsigned char)length;
+        WriteReplayU32(data + size + 2, dtBits);
+        size += REPLAY_RUN_SIZE;
+        runCount++;
+        i += length;
+    }
+    
+    memcpy(data, REPLAY_MAGIC, 4);
+    WriteReplayU32(data + 4, REPLAY_VERSION);
+    WriteReplayU32(data + 8, (unsigned int)replay->tickCount);
+    WriteReplayU32(data + 12, (unsigned int)runCount);
+    
+    bool IsSaved = SaveFileData(fileName, data, size);
+    free(data);
+    return IsSaved;
+}
+
+//returns an empty replay when the file is missing, truncated or from another version
+static Replay LoadReplay(const char *fileName)
+{
+    Replay replay = { 0 };
+    int size = 0;
+    unsigned char *data = LoadFileData(fileName, &size);
+    if(data == NULL) return replay;
+    
+    if(size < REPLAY_HEADER_SIZE || memcmp(data, REPLAY_MAGIC, 4) != 0 || ReadReplayU32(data + 4) != REPLAY_VERSION){
+        TraceLog(LOG_WARNING, "REPLAY: [%s] Not a replay file or unsupported version", fileName);
+        UnloadFileData(data);
+        return replay;
+    }
+    
+    int tickCount = (int)ReadReplayU32(data + 8);
+    int runCount = (int)ReadReplayU32(data + 12);
+    if(runCount < 0 || (size - REPLAY_HEADER_SIZE)/REPLAY_RUN_SIZE < runCount){
+        TraceLog(LOG_WARNING, "REPLAY: [%s] File is truncated", fileName);
+        UnloadFileData(data);
+        return replay;
+    }
+    
+    for(int r = 0; r < runCount; r++){
+        const unsigned char *run = data + REPLAY_HEADER_SIZE + r*REPLAY_RUN_SIZE;
+        unsigned int dtBits = ReadReplayU32(run + 2);
+        InputFrame input = { run[0] };
+        float dt;
+        memcpy(&dt, &dtBits, sizeof(float));
+        for(int t = 0; t < run[1]; t++) RecordReplayTick(&replay, &input, dt);
+    }
+    if(replay.tickCount != tickCount) TraceLog(LOG_WARNING, "REPLAY: [%s] Expected %d ticks, found %d", fileName, tickCount, replay.tickCount);
+    
+    UnloadFileData(data);
+    return replay;
+}
+
+static void UnloadReplay(Replay replay)
+{
+    free(replay.buttons);
+    free(replay.dt);
+}
+
+//runs matches at a fixed tick rate with no window or audio device, driven by an input script or a seeded bot
+//usage: --headless [--level file] [--matches N] [--ticks N] [--script file | --replay file] [--seed S] [--profile-csv file]
+static int RunHeadless(int argc, char *argv[])
+{
+    int matchCount = 1;
+    int maxTicks = 5*60*SIM_TICK_RATE;
+    unsigned int seed = 1;
+    bool HasTickLimit = false;
+    const char *scriptFileName = NULL;
+    const char *replayFileName = NULL;
+    const char *levelFileName = DEFAULT_LEVEL_FILE;
+    int workerCount = GetCpuCount();
+    int tickRate = SIM_TICK_RATE;
+    
+    for(int i = 1; i < argc; i++){
+        if(strcmp(argv[i], "--matches") == 0 && i + 1 < argc) matchCount = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc) tickRate = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) workerCount = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--level") == 0 && i + 1 < argc) levelFileName = argv[++i];
+        else if(strcmp(argv[i], "--ticks") == 0 && i + 1 < argc){
+            maxTicks = atoi(argv[++i]);
+            HasTickLimit = true;
         }
-        
-        //drawing enemy tanks
-        for(int i = 0; i < MaxNumberOfEnemyTanks; i++){
-            if(enemyTanks[i].IsEnemyAlive) if(Vector3Distance(playerPos, enemyTanks[i].enemyPos) <= 50)DrawModel(enemyTanks[i].enemyModel, enemyTanks[i].enemyPos, 1, WHITE);
+        else if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc) replayFileName = argv[++i];
+        else if(strcmp(argv[i], "--profile-csv") == 0 && i + 1 < argc) profiler.IsEnabled = OpenProfilerCsv(argv[++i]);
+        else if(strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+        else if(strcmp(argv[i], "--script") == 0 && i + 1 < argc) scriptFileName = argv[++i];
+    }
+    if(tickRate <= 0) tickRate = SIM_TICK_RATE;
+    if(!HasTickLimit) maxTicks = 5*60*tickRate;
+    
+    SetTraceLogLevel(LOG_WARNING);
+    
+    ScriptLine *script = NULL;
+    int scriptLineCount = 0;
+    if(scriptFileName != NULL){
+        scriptLineCount = LoadInputScript(scriptFileName, &script);
+        if(scriptLineCount == 0){
+            fprintf(stderr, "headless: no input in script %s\n", scriptFileName);
+            return 1;
         }
-        
-        //drawing enemy APCs
-        for(int i = 0; i < MaxNumberOfEnemyAPCs; i++){
-            if(enemyAPCs[i].IsEnemyAlive) if(Vector3Distance(playerPos, enemyAPCs[i].enemyPos) <= 50) DrawModel(enemyAPCs[i].enemyModel, enemyAPCs[i].enemyPos, 1, WHITE);
+    }
+    
+    //a replay brings its own timestep for every tick and runs to its end unless a tick limit is given
+    Replay replay = { 0 };
+    if(replayFileName != NULL){
+        replay = LoadReplay(replayFileName);
+        if(replay.tickCount == 0){
+            fprintf(stderr, "headless: no input in replay %s\n", replayFileName);
+            free(script);
+            return 1;
         }
+        if(!HasTickLimit) maxTicks = replay.tickCount;
+    }
+    
+    Level level = LoadLevel(levelFileName);
+    if(level.data == NULL){
+        fprintf(stderr, "headless: could not load level %s\n", levelFileName);
+        free(script);
+        UnloadReplay(replay);
+        return 1;
+    }
+    
+    TriangleBvh battleshipBvh = LoadTriangleBvh("The Last Tank/LandBattleship.obj");
+    World world = { 0 };
+    InitWorld(&world, &level, LoadObjBounds("The Last Tank/VerticalWallSegment.obj"), LoadObjBounds("The Last Tank/HorizontalWallSegment.obj"),
+              LoadObjBounds("The Last Tank/Building1.obj"), &battleshipBvh);
+    
+    //results are the same for any worker count
+    InitJobSystem(&jobs, workerCount);
+    
+    GameState *state = LoadGameState(&world);
+    const float dt = 1.0f/(float)tickRate;
+    long totalTicks = 0;
+    int wins = 0;
+    int losses = 0;
+    clock_t startTime = clock();
+    
+    for(int match = 0; match < matchCount; match++){
+        unsigned int rng = seed + (unsigned int)match;
+        InputFrame botInput = { 0 };
+        int scriptLine = 0;
+        int scriptTick = 0;
         
-        //drawing pickups
-        for(int i =0; i < MaxNumberOfPickups; i++){
-            if(!AllPickups[i].IsPickedUp) {
-                if(Vector3Distance(playerPos, AllPickups[i].pickupPos) <= 50)DrawModel(AllPickups[i].pickupModel, AllPickups[i].pickupPos, 2, WHITE);
-                Vector3 spherePos = Vector3Add(AllPickups[i].pickupPos, (Vector3){0.0f, 0.5f, 0.0f});
-                if(AllPickups[i].pickupType == HEALTH) DrawSphere(spherePos, 1.0f, (Color){255, 0, 0, 50});
-                else if(AllPickups[i].pickupType == MG) DrawSphere(spherePos, 1.0f, (Color){255, 203, 0, 50});
-                else DrawSphere(spherePos, 1.0f, (Color){255, 255, 255, 50});
-            }
-        }
+        RestoreGameSnapshot(state, state->matchStart);
         
-        /*//boundary test
-        for(int i = 0; i < VerticalWallCount; i++){
-            DrawBoundingBox(verticalWalls[i], DARKGRAY);
-        }
-        for(int i = 0; i < HorizontalWallCount; i++){
-            DrawBoundingBox(horizontalWalls[i], DARKGRAY);
+        while((int)state->tick < maxTicks){
+            InputFrame input = { 0 };
+            float stepDt = dt;
+            
+            if(replayFileName != NULL){
+                if((int)state->tick >= replay.tickCount) break;
+                input.buttons = replay.buttons[state->tick];
+                stepDt = replay.dt[state->tick];
+            }
+            else if(script != NULL){
+                if(scriptLine >= scriptLineCount) break;
+                input.buttons = script[scriptLine].buttons;
+                if(scriptTick > 0) input.buttons &= ~(INPUT_FIRE_TANK | INPUT_RESTART);
+                if(++scriptTick >= script[scriptLine].ticks){
+                    scriptLine++;
+                    scriptTick = 0;
+                }
+            }
+            else {
+                //a bot match ends the first time the player dies or wins
+                if(state->IsPlayerDead || state->IsGameFinished) break;
+                UpdateBotInput(state, &rng, &botInput);
+                input = botInput;
+            }
+            
+            BeginProfilePhase(PROFILE_FRAME);
+            SimStep(state, &input, stepDt);
+            EndProfilePhase(PROFILE_FRAME);
+            EndProfilerFrame();
         }
-        for(int i = 0; i < Building1Count; i++){
-            DrawBoundingBox(building1_BBs[i], DARKGRAY);
-        }*/
         
-        //drawing bulding 1
-        for(int i = 0; i < Building1Count; i++){
-            if(Vector3Distance(playerPos, Building1_Positions[i]) <= 50) DrawModel(Building1, Building1_Positions[i], 1, WHITE);
-        }
+        int enemiesLeft = 0;
+        for(int i = 0; i < state->enemyTankCount; i++) if(state->enemyTanks[i].IsEnemyAlive) enemiesLeft++;
+        for(int i = 0; i < state->enemyAPCCount; i++) if(state->enemyAPCs[i].IsEnemyAlive) enemiesLeft++;
+        if(state->IsGameFinished) wins++;
+        if(state->IsPlayerDead) losses++;
         
-        //drawing level
-        DrawModel(LevelModel, Level_Pos, 1.0f, WHITE);
-        DrawModel(BattleShipModel, battleship_Pos, 1, WHITE);
+        printf("match %d: ticks %u %s health %d enemies %d battleship %d checksum %08x\n", match, state->tick,
+               state->IsGameFinished ? "won" : state->IsPlayerDead ? "lost" : "unfinished",
+               state->CurrentPlayerHealth, enemiesLeft, state->CurrentBattleshipHealth, GetGameStateChecksum(state));
         
-        EndMode3D();
-        DrawTextureEx(healthIcon_tex, (Vector2){25, GetScreenHeight()-100}, 0, 0.1375f, WHITE);
-        DrawTextureEx(MainGunIcon_tex, (Vector2){25, GetScreenHeight()-230}, 0, 0.1375f, WHITE);
-        DrawTextureEx(MGIcon_tex, (Vector2){25, GetScreenHeight()-360}, 0, 0.1375f, WHITE);
-        DrawText(TextFormat("%d", CurrentPlayerHealth), 200, GetScreenHeight() - 100, 100, RAYWHITE);
-        DrawText(TextFormat("%d", CurrentMainGunAmmo), 200, GetScreenHeight() - 230, 100, RAYWHITE);
-        DrawText(TextFormat("%d", CurrentMGAmmo), 200, GetScreenHeight() - 360, 100, RAYWHITE);
+        totalTicks += state->tick;
+    }
+    UnloadGameState(state);
+    
+    double seconds = (double)(clock() - startTime)/CLOCKS_PER_SEC;
+    printf("%d matches, %d won, %d lost, %ld ticks in %.3fs (%.0f ticks/s)\n", matchCount, wins, losses, totalTicks, seconds,
+           seconds > 0 ? totalTicks/seconds : 0.0);
+    
+    ShutdownJobSystem(&jobs);
+    free(script);
+    UnloadReplay(replay);
+    CloseProfilerCsv();
+    UnloadWorld(&world);
+    UnloadTriangleBvh(battleshipBvh);
+    UnloadLevel(level);
+    return 0;
+}
+
+//checks the batch collision kernels against raylib's CheckCollisionSpheres and CheckCollisionBoxSphere bit for bit, returns the number of mismatches
+//every case goes through the kernels at each count from 1 to 17 starting at each index, so it lands in every AVX, SSE2 and scalar loop compiled in
+static int RunCollisionSelfTest(void)
+{
+    enum { CaseCount = 96, MaxWindow = 17, EdgeCaseCount = 10 };
+    Vector3 sphereCenters[2] = { {0.0f, 0.0f, 0.0f}, {10.5f, -3.0f, 7.25f} };
+    float sphereRadii[2] = { 2.0f, 0.0f };
+    BoundingBox boxes[2] = { {{-1.0f, -2.0f, -3.0f}, {4.0f, 5.0f, 6.0f}}, {{2.0f, 0.0f, 2.0f}, {2.0f, 1.0f, 5.0f}} };    //the second one is flat
+    float x[CaseCount], y[CaseCount], z[CaseCount], radius[CaseCount];
+    float minX[CaseCount], minY[CaseCount], minZ[CaseCount], maxX[CaseCount], maxY[CaseCount], maxZ[CaseCount];
+    unsigned char hits[MaxWindow];
+    unsigned int rng = 1;
+    int checks = 0;
+    int mismatches = 0;
+    
+    //two spheres and two boxes to test against, the same cases are built around each
+    for(int target = 0; target < 4; target++){
+        bool IsBox = (target >= 2);
+        BoundingBox box = boxes[target%2];
+        Vector3 center = sphereCenters[target%2];
+        float centerRadius = sphereRadii[target%2];
+        Vector3 mid = IsBox ? Vector3Scale(Vector3Add(box.min, box.max), 0.5f) : center;
+        float face = IsBox ? box.max.x : center.x + centerRadius;         //where the target's surface crosses +x from mid
+        Vector3 corner = IsBox ? (Vector3){box.max.x, box.max.y, mid.z} : center;
+        float slack = IsBox ? 0.0f : centerRadius;
         
-        if(IsPlayerDead){
-            DrawText("Game Over!", (int)GetScreenWidth()/2 - 400, (int)GetScreenHeight()/2 - 300, 200, RAYWHITE);
-            DrawText("Press R to restart game", (int)GetScreenWidth()/2 - 300, (int)GetScreenHeight()/2, 50, RAYWHITE);
-            DrawText("Press ESC to quit game", (int)GetScreenWidth()/2 - 300, (int)GetScreenHeight()/2 + 100, 50, RAYWHITE);
-        }
-        if(!IsPlayerDead && !IsGameFinished){
-            DrawText("Destroy All Enemies", (int)GetScreenWidth()/2 - 300, 100, 50, RAYWHITE);
-            
-            if(Vector3Distance(playerPos, battleship_Pos) <= 100){
-                DrawText("STRANDED LAND BATTLESHIP",(int)GetScreenWidth()/2 - 400, 200, 50, WHITE);
-                DrawRectangle((int)GetScreenWidth()/2 - 400, 275, 800, 50, WHITE);
-                DrawRectangle((int)GetScreenWidth()/2 - 400, 275, (CurrentBattleshipHealth/MaxBattleshipHealth * 800), 50, RED);
+        //edge cases first: touching exactly, one float either side of touching, zero radius on and off the surface, a 3-4-5 diagonal touch
+        Vector3 edgePos[EdgeCaseCount] = {
+            {face + 1.0f, mid.y, mid.z}, {nextafterf(face + 1.0f, INFINITY), mid.y, mid.z}, {nextafterf(face + 1.0f, -INFINITY), mid.y, mid.z},
+            {face, mid.y, mid.z}, {nextafterf(face, INFINITY), mid.y, mid.z}, mid,
+            {corner.x + 3.0f, corner.y + 4.0f, corner.z}, {corner.x + 3.0f, corner.y + 4.0f, corner.z},
+            {face - 0.5f, mid.y, mid.z}, {mid.x - 100.0f, mid.y, mid.z}
+        };
+        float edgeRadius[EdgeCaseCount] = { 1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 5.0f - slack, nextafterf(5.0f - slack, 0.0f), 0.0f, 0.0f };
+        for(int i = 0; i < CaseCount; i++){
+            if(i < EdgeCaseCount){
+                x[i] = edgePos[i].x;
+                y[i] = edgePos[i].y;
+                z[i] = edgePos[i].z;
+                radius[i] = edgeRadius[i];
             }
-            
-            DrawText("Controls:", 25, 10, 20, RAYWHITE);
-            DrawText("Arrow Up/Arrow Down - Move Forward/Backward", 25, 40, 20, RAYWHITE);
-            DrawText("Arrow Right/Arrow Left - Turn Right/Left", 25, 60, 20, RAYWHITE);
-            DrawText("Spacebar - Fire Tank Gun", 25, 80, 20, RAYWHITE);
-            DrawText("Left Alt - Fire Machine Gun", 25, 100, 20, RAYWHITE);
+            else {
+                //random cases on a 1/8 lattice around the target, so many of them touch exactly too
+                rng = rng*1664525u + 1013904223u;
+                x[i] = mid.x + (float)((int)((rng >> 8)%129) - 64)*0.125f;
+                rng = rng*1664525u + 1013904223u;
+                y[i] = mid.y + (float)((int)((rng >> 8)%129) - 64)*0.125f;
+                rng = rng*1664525u + 1013904223u;
+                z[i] = mid.z + (float)((int)((rng >> 8)%129) - 64)*0.125f;
+                rng = rng*1664525u + 1013904223u;
+                radius[i] = (float)((rng >> 8)%33)*0.125f;
+            }
+            //the cases as boxes too, cubes around each sphere that are points where the radius is zero
+            minX[i] = x[i] - radius[i];
+            minY[i] = y[i] - radius[i];
+            minZ[i] = z[i] - radius[i];
+            maxX[i] = x[i] + radius[i];
+            maxY[i] = y[i] + radius[i];
+            maxZ[i] = z[i] + radius[i];
         }
         
-        //draw game finish screen
-        if(IsGameFinished){
-            DrawText("You won!", (int)GetScreenWidth()/2 - 400, (int)GetScreenHeight()/2 - 300, 200, RAYWHITE);
-            DrawText("Press R to restart game", (int)GetScreenWidth()/2 - 300, (int)GetScreenHeight()/2, 50, RAYWHITE);
-            DrawText("Press ESC to quit game", (int)GetScreenWidth()/2 - 300, (int)GetScreenHeight()/2 + 100, 50, RAYWHITE);
+        for(int s = 0; s < CaseCount; s++){
+            for(int count = 1; count <= MaxWindow && s + count <= CaseCount; count++){
+                //packed spheres against the target
+                int hitCount = IsBox ? CheckCollisionBoxSpheresBatch(box, x + s, y + s, z + s, radius + s, count, hits)
+                                     : CheckCollisionSpheresBatch(x + s, y + s, z + s, radius + s, count, center, centerRadius, hits);
+                int expectedCount = 0;
+                for(int i = 0; i < count; i++){
+                    Vector3 pos = { x[s + i], y[s + i], z[s + i] };
+                    bool IsExpected = IsBox ? CheckCollisionBoxSphere(box, pos, radius[s + i]) : CheckCollisionSpheres(pos, radius[s + i], center, centerRadius);
+                    expectedCount += IsExpected;
+                    checks++;
+                    if(hits[i] != IsExpected){
+                        fprintf(stderr, "selftest: %s target %d case %d (start %d count %d) gave %d, raylib gives %d\n",
+                                IsBox ? "CheckCollisionBoxSpheresBatch" : "CheckCollisionSpheresBatch", target, s + i, s, count, hits[i], IsExpected);
+                        mismatches++;
+                    }
+                }
+                if(hitCount != expectedCount){
+                    fprintf(stderr, "selftest: target %d (start %d count %d) counted %d hits, expected %d\n", target, s, count, hitCount, expectedCount);
+                    mismatches++;
+                }
+                
+                //one edge case sphere against the packed boxes, the first box it touches
+                for(int e = 0; e < EdgeCaseCount; e++){
+                    Vector3 pos = { x[e], y[e], z[e] };
+                    int first = CheckCollisionBoxesSphereBatch(minX + s, minY + s, minZ + s, maxX + s, maxY + s, maxZ + s, count, pos, radius[e]);
+                    int expected = -1;
+                    for(int i = 0; i < count && expected < 0; i++){
+                        BoundingBox cube = { {minX[s + i], minY[s + i], minZ[s + i]}, {maxX[s + i], maxY[s + i], maxZ[s + i]} };
+                        if(CheckCollisionBoxSphere(cube, pos, radius[e])) expected = i;
+                    }
+                    checks++;
+                    if(first != expected){
+                        fprintf(stderr, "selftest: CheckCollisionBoxesSphereBatch target %d case %d (start %d count %d) gave %d, raylib gives %d\n",
+                                target, e, s, count, first, expected);
+                        mismatches++;
+                    }
+                }
+            }
         }
-        
-        DrawFPS(10, 10);
-        EndDrawing();
-        //----------------------------------------------------------------------------------
     }
-
-    // De-Initialization
-    //--------------------------------------------------------------------------------------
-    UnloadModel(playerTank);
-    UnloadModel(EnemyTankModel);
-    UnloadModel(tankBullet);
-    UnloadModel(MGBullet);
-    UnloadModel(HealthPickup);
-    UnloadModel(MainGunPickup);
-    UnloadModel(MGPickup);
-    UnloadModel(EnemyAPCModel);
-    UnloadModel(Wall_Vertical);
-    UnloadModel(Wall_Horizontal);
-    UnloadModel(Building1);
-    UnloadModel(LevelModel);
-    UnloadModel(BattleShipModel);
-    UnloadModel(BigBullet);
-    
-    UnloadTexture(enemyAPC_tex);
-    UnloadTexture(pickupTexture);
-    UnloadTexture(enemyTank_tex);
-    UnloadTexture(bulletTexture);
-    UnloadTexture(playerTank_tex);
-    UnloadTexture(building1_tex);
-    UnloadTexture(level_tex);
-    UnloadTexture(battleship_tex);
-    UnloadTexture(healthIcon_tex);
-    UnloadTexture(MainGunIcon_tex);
-    UnloadTexture(MGIcon_tex);
-    UnloadTexture(explosionFlipBookTexture);
-    
-    UnloadImage(GameIcon);
     
-    UnloadSound(PlayerMGSound);
-    UnloadSound(EnemyHitSound);
-    UnloadSound(PlayerTankGunSound);
-    UnloadSound(EnemyDieSound);
-    UnloadSound(EnemyTankGunSound);
-    UnloadSound(HealthPickupSound);
-    CloseAudioDevice();
-    CloseWindow();        // Close window and OpenGL context
-    //--------------------------------------------------------------------------------------
-
-    return 0;
+#if defined(COLLISION_AVX)
+    const char *paths = "AVX, SSE2 and scalar";
+#elif defined(COLLISION_SSE2)
+    const char *paths = "SSE2 and scalar";
+#else
+    const char *paths = "scalar";
+#endif
+    printf("selftest: %d checks through the %s paths, %d mismatches\n", checks, paths, mismatches);
+    return mismatches;
 }
\ No newline at end of file